@@ -4,6 +4,7 @@ endif()
 
 # Look for some dependencies using CMake scripts
 find_package(ZLIB REQUIRED)
+find_package(Threads REQUIRED)
 
 set(OpenGL_GL_PREFERENCE GLVND)
 
@@ -15,6 +15,8 @@ endif()
 
 option(ENABLE_SDL "Build the SDL port" ${ENABLE_SDL_DEFAULT})
 option(ENABLE_WX "Build the wxWidgets port" ${BUILD_DEFAULT})
+option(ENABLE_BENCH "Build the headless vbam-bench benchmark" ${BUILD_DEFAULT})
+option(ENABLE_BATCH "Build the headless vbam-batch job runner" ${BUILD_DEFAULT})
 option(ENABLE_DEBUGGER "Enable the debugger" ON)
 option(ENABLE_ASAN "Enable -fsanitize=address by default. Requires debug build with GCC/Clang" OFF)
 
@@ -85,6 +87,8 @@ else()
     endif()
 endif()
 option(ENABLE_LINK "Enable GBA linking functionality" ${ENABLE_LINK_DEFAULT})
+# The rollback netplay link cable is experimental
+cmake_dependent_option(ENABLE_NETPLAY "Enable the rollback netplay link cable" OFF "ENABLE_LINK" OFF)
 
 # FFMpeg
 set(FFMPEG_DEFAULT OFF)
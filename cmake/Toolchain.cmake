@@ -50,6 +50,10 @@ if(ENABLE_DEBUGGER)
     add_compile_definitions(VBAM_ENABLE_DEBUGGER)
 endif()
 
+if(ENABLE_NETPLAY)
+    add_compile_definitions(VBAM_ENABLE_NETPLAY)
+endif()
+
 # The ASM core is disabled by default because we don't know on which platform we are
 if(NOT ENABLE_ASM_CORE)
     add_compile_definitions(C_CORE)
@@ -0,0 +1,693 @@
+// vbam-batch: headless runner for lists of emulation jobs.
+//
+// Reads a job list and runs every job in its own worker process, as many at a
+// time as there are CPUs. A job loads a ROM, optionally replays a recorded
+// input stream and emulates a number of frames. It then reports a CRC32 of
+// the emulated memory and the emulation speed, and optionally writes a
+// screenshot. One result line is printed per job as they complete, followed
+// by a summary.
+//
+// The cores keep their state in globals, so only one of them can run in a
+// process. The jobs are spread over worker processes rather than threads, and
+// a new worker is forked for every job, so that a ROM that crashes or hangs
+// the core only fails its own job. The workers pick the next job as soon as
+// they are done, so a few long jobs do not hold the others back. On Windows,
+// where there is no fork(), the jobs run one after the other in the process.
+//
+// The job list has one job per line, with tab-separated fields:
+//
+//   <rom> <frames> [<input>] [<png>]
+//
+// The input is a raw file of little-endian 32-bit joypad masks, one per frame,
+// as used by vbam-bench. When it is shorter than the number of frames, the
+// last value is held. The input can also be a movie, played back from its
+// start. Empty fields are ignored, as are empty lines and lines starting with
+// '#'.
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cinttypes>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif  // !defined(_WIN32)
+
+#include <zlib.h>
+
+#include "core/base/file_util.h"
+#include "core/base/message.h"
+#include "core/base/movie.h"
+#include "core/base/run_ahead.h"
+#include "core/base/sizes.h"
+#include "core/base/sound_driver.h"
+#include "core/base/system.h"
+#include "core/gb/gb.h"
+#include "core/gb/gbGlobals.h"
+#include "core/gb/gbSound.h"
+#include "core/gba/gba.h"
+#include "core/gba/gbaFlash.h"
+#include "core/gba/gbaGlobals.h"
+#include "core/gba/gbaSound.h"
+
+namespace {
+
+// Sound driver that drops all the samples.
+class NullSoundDriver final : public SoundDriver {
+public:
+    NullSoundDriver() = default;
+    ~NullSoundDriver() override = default;
+
+    // SoundDriver implementation.
+    bool init(long) override { return true; }
+    void pause() override {}
+    void reset() override {}
+    void resume() override {}
+    void write(uint16_t*, int) override {}
+    void setThrottle(unsigned short) override {}
+};
+
+struct BatchConfig {
+    std::string jobs_path;
+    std::string bios_path;
+    int workers = 0;
+    int timeout = 0;
+};
+
+struct Job {
+    std::string rom_path;
+    std::string input_path;
+    std::string png_path;
+    int frames = 0;
+};
+
+enum class JobStatus : int {
+    kOk,
+    kUnknownType,
+    kLoadFailed,
+    kInputFailed,
+    kScreenshotFailed,
+    kCrashed,
+    kTimedOut,
+};
+
+// Sent as is from the worker to the runner.
+struct JobResult {
+    JobStatus status = JobStatus::kCrashed;
+    int frames = 0;
+    int64_t ns = 0;
+    uint32_t crc32 = 0;
+};
+
+// Recorded input of the current job, one joypad mask per frame.
+std::vector<uint32_t> g_input;
+size_t g_input_frame = 0;
+// The movie of the current job, if its input is one.
+Movie g_movie;
+
+void Usage(const char* argv0) {
+    fprintf(stderr,
+            "Usage: %s [options] <jobs>\n"
+            "\n"
+            "Runs the jobs listed in the <jobs> file, or on the standard input if\n"
+            "<jobs> is '-'. Every line is a job, with tab-separated fields:\n"
+            "  <rom> <frames> [<input>] [<png>]\n"
+            "\n"
+            "Options:\n"
+            "  -j, --jobs N     Number of jobs to run at once (default: CPU count)\n"
+            "  -t, --timeout S  Fail the jobs that take more than S seconds\n"
+            "  -b, --bios F     Use the BIOS image at F\n",
+            argv0);
+}
+
+bool ParseInt(const char* value, int* out) {
+    char* end = nullptr;
+    const long parsed = strtol(value, &end, 10);
+    if (!value[0] || *end || parsed < 0 || parsed > 0x7fffffff) {
+        return false;
+    }
+    *out = static_cast<int>(parsed);
+    return true;
+}
+
+bool ParseArgs(int argc, char** argv, BatchConfig* config) {
+    for (int i = 1; i < argc; i++) {
+        const std::string arg(argv[i]);
+        const bool has_value = i + 1 < argc;
+
+        if ((arg == "-j" || arg == "--jobs") && has_value) {
+            if (!ParseInt(argv[++i], &config->workers) || config->workers == 0) {
+                return false;
+            }
+        } else if ((arg == "-t" || arg == "--timeout") && has_value) {
+            if (!ParseInt(argv[++i], &config->timeout)) {
+                return false;
+            }
+        } else if ((arg == "-b" || arg == "--bios") && has_value) {
+            config->bios_path = argv[++i];
+        } else if ((arg == "-" || arg[0] != '-') && config->jobs_path.empty()) {
+            config->jobs_path = arg;
+        } else {
+            return false;
+        }
+    }
+
+    return !config->jobs_path.empty();
+}
+
+// Splits `line` on tabs, dropping the line ending.
+std::vector<std::string> SplitFields(const std::string& line) {
+    std::vector<std::string> fields;
+    size_t start = 0;
+    for (;;) {
+        const size_t end = line.find('\t', start);
+        fields.push_back(line.substr(start, end - start));
+        if (end == std::string::npos) {
+            break;
+        }
+        start = end + 1;
+    }
+
+    std::string& last = fields.back();
+    while (!last.empty() && (last.back() == '\n' || last.back() == '\r')) {
+        last.pop_back();
+    }
+    return fields;
+}
+
+bool ReadJobs(const std::string& path, std::vector<Job>* jobs) {
+    FILE* f = path == "-" ? stdin : utilOpenFile(path.c_str(), "r");
+    if (!f) {
+        fprintf(stderr, "Failed to open %s\n", path.c_str());
+        return false;
+    }
+
+    bool ok = true;
+    int line_number = 0;
+    char buffer[4096];
+    while (fgets(buffer, sizeof(buffer), f)) {
+        line_number++;
+        const std::vector<std::string> fields = SplitFields(buffer);
+        if (fields[0].empty() || fields[0][0] == '#') {
+            continue;
+        }
+
+        Job job;
+        job.rom_path = fields[0];
+        if (fields.size() < 2 || fields.size() > 4 ||
+            !ParseInt(fields[1].c_str(), &job.frames)) {
+            fprintf(stderr, "%s:%d: Invalid job\n", path.c_str(), line_number);
+            ok = false;
+            continue;
+        }
+        if (fields.size() > 2) {
+            job.input_path = fields[2];
+        }
+        if (fields.size() > 3) {
+            job.png_path = fields[3];
+        }
+        jobs->push_back(std::move(job));
+    }
+
+    if (f != stdin) {
+        fclose(f);
+    }
+    return ok;
+}
+
+bool LoadInput(const std::string& path) {
+    FILE* f = utilOpenFile(path.c_str(), "rb");
+    if (!f) {
+        return false;
+    }
+
+    g_input.clear();
+    uint8_t p[4];
+    while (fread(p, 1, sizeof(p), f) == sizeof(p)) {
+        g_input.push_back(p[0] | (p[1] << 8) | (p[2] << 16) | (uint32_t(p[3]) << 24));
+    }
+    fclose(f);
+    return true;
+}
+
+void InitColorMaps() {
+    systemColorDepth = 32;
+    systemRedShift = 19;
+    systemGreenShift = 11;
+    systemBlueShift = 3;
+
+    for (int i = 0; i < 0x10000; i++) {
+        systemColorMap32[i] = ((i & 0x1f) << systemRedShift) |
+                              (((i & 0x3e0) >> 5) << systemGreenShift) |
+                              (((i & 0x7c00) >> 10) << systemBlueShift);
+        systemColorMap16[i] = ((i & 0x1f) << 11) | (((i & 0x3e0) >> 5) << 6) |
+                              ((i & 0x7c00) >> 10);
+    }
+}
+
+bool LoadGBA(const Job& job, const BatchConfig& config) {
+    const int size = CPULoadRom(job.rom_path.c_str());
+    if (size == 0) {
+        return false;
+    }
+
+    flashDetectSaveType(size);
+    doMirroring(coreOptions.mirroringEnable);
+    soundSetSampleRate(48000);
+    CPUInit(config.bios_path.c_str(), !config.bios_path.empty());
+    CPUReset();
+    return true;
+}
+
+bool LoadGB(const Job& job, const BatchConfig& config) {
+    if (!gbLoadRom(job.rom_path.c_str())) {
+        return false;
+    }
+
+    gbGetHardwareType();
+    if (!config.bios_path.empty()) {
+        gbCPUInit(config.bios_path.c_str(), true);
+    }
+    gbSoundSetSampleRate(48000);
+    gbReset();
+    return true;
+}
+
+// Same as the vbam-bench checksum: the emulated RAM and the screen.
+uint32_t StateChecksum(IMAGE_TYPE type) {
+    uLong crc = crc32(0L, Z_NULL, 0);
+    if (type == IMAGE_GBA) {
+        crc = crc32(crc, g_workRAM, SIZE_WRAM);
+        crc = crc32(crc, g_internalRAM, SIZE_IRAM);
+        crc = crc32(crc, g_paletteRAM, SIZE_PRAM);
+        crc = crc32(crc, g_vram, SIZE_VRAM);
+        crc = crc32(crc, g_oam, SIZE_OAM);
+        crc = crc32(crc, g_ioMem, SIZE_IOMEM);
+        crc = crc32(crc, g_pix, SIZE_PIX);
+    } else {
+        crc = crc32(crc, gbMemory, 0x10000);
+        if (gbWram) {
+            crc = crc32(crc, gbWram, kGBWRamSize);
+        }
+        if (gbVram) {
+            crc = crc32(crc, gbVram, kGBVRamSize);
+        }
+        crc = crc32(crc, g_pix, static_cast<uInt>(kGBPixSize));
+    }
+    return static_cast<uint32_t>(crc);
+}
+
+// Runs `job` with the core of this process.
+JobResult RunJob(const Job& job, const BatchConfig& config) {
+    JobResult result;
+
+    g_input.clear();
+    g_input_frame = 0;
+    g_movie.Stop();
+    // A movie that can not be loaded fails the job, rather than being played
+    // as raw joypad masks.
+    const bool movie = !job.input_path.empty() && Movie::IsMovieFile(job.input_path.c_str());
+    if (!job.input_path.empty() &&
+        !(movie ? g_movie.Load(job.input_path.c_str()) : LoadInput(job.input_path))) {
+        result.status = JobStatus::kInputFailed;
+        return result;
+    }
+
+    const IMAGE_TYPE type = utilFindType(job.rom_path.c_str());
+    if (type == IMAGE_UNKNOWN) {
+        result.status = JobStatus::kUnknownType;
+        return result;
+    }
+
+    coreOptions.cheatsEnabled = 0;
+    coreOptions.skipBios = true;
+    // The samples are dropped, don't synthesize them.
+    coreOptions.audioOff = true;
+    soundInit();
+
+    EmulatedSystem emulator;
+    bool loaded = false;
+    if (type == IMAGE_GBA) {
+        loaded = LoadGBA(job, config);
+        emulator = GBASystem;
+    } else {
+        loaded = LoadGB(job, config);
+        emulator = GBSystem;
+    }
+    if (!loaded) {
+        soundShutdown();
+        result.status = JobStatus::kLoadFailed;
+        return result;
+    }
+
+    if (movie && !g_movie.StartPlayback(emulator)) {
+        emulator.emuCleanUp();
+        soundShutdown();
+        result.status = JobStatus::kInputFailed;
+        return result;
+    }
+
+    emulating = 1;
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < job.frames; i++) {
+        MovieInput live;
+        if (!g_input.empty()) {
+            live.joypad = g_input[std::min(g_input_frame, g_input.size() - 1)];
+        }
+        g_movie.NextFrame(emulator, live);
+        g_input_frame++;
+
+        RunAhead::EmulateUntilFrameDone(emulator);
+    }
+    const auto end = std::chrono::steady_clock::now();
+
+    result.status = JobStatus::kOk;
+    result.frames = job.frames;
+    result.ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    result.crc32 = StateChecksum(type);
+
+    if (!job.png_path.empty() && !emulator.emuWritePNG(job.png_path.c_str())) {
+        result.status = JobStatus::kScreenshotFailed;
+    }
+
+    emulating = 0;
+    emulator.emuCleanUp();
+    soundShutdown();
+    return result;
+}
+
+const char* StatusName(JobStatus status) {
+    switch (status) {
+        case JobStatus::kOk:
+            return "ok";
+        case JobStatus::kUnknownType:
+            return "unknown-type";
+        case JobStatus::kLoadFailed:
+            return "load-failed";
+        case JobStatus::kInputFailed:
+            return "input-failed";
+        case JobStatus::kScreenshotFailed:
+            return "screenshot-failed";
+        case JobStatus::kCrashed:
+            return "crashed";
+        case JobStatus::kTimedOut:
+            return "timed-out";
+    }
+    return "unknown";
+}
+
+void PrintResult(size_t index, const Job& job, const JobResult& result) {
+    const double fps = result.ns > 0 ? result.frames / (result.ns / 1e9) : 0.0;
+    printf("job=%zu status=%s frames=%d ms=%.1f fps=%.2f crc32=%08x rom=%s\n", index,
+           StatusName(result.status), result.frames, result.ns / 1e6, fps, result.crc32,
+           job.rom_path.c_str());
+    fflush(stdout);
+}
+
+#if defined(_WIN32)
+
+void RunJobs(const std::vector<Job>& jobs,
+             const BatchConfig& config,
+             std::vector<JobResult>* results) {
+    for (size_t i = 0; i < jobs.size(); i++) {
+        (*results)[i] = RunJob(jobs[i], config);
+        PrintResult(i, jobs[i], (*results)[i]);
+    }
+}
+
+#else  // !defined(_WIN32)
+
+struct Worker {
+    pid_t pid;
+    // Read end of the pipe the result is sent on.
+    int fd;
+    size_t job;
+};
+
+bool StartWorker(size_t index,
+                 const Job& job,
+                 const BatchConfig& config,
+                 std::vector<Worker>* workers) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return false;
+    }
+
+    // The buffered output would be written again by the worker.
+    fflush(stdout);
+    fflush(stderr);
+
+    const pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+
+    if (pid == 0) {
+        close(fds[0]);
+        for (const Worker& worker : *workers) {
+            close(worker.fd);
+        }
+        if (config.timeout > 0) {
+            alarm(config.timeout);
+        }
+
+        const JobResult result = RunJob(job, config);
+        // Smaller than PIPE_BUF, the write is atomic and does not block.
+        const bool written = write(fds[1], &result, sizeof(result)) == sizeof(result);
+        _exit(written ? 0 : 1);
+    }
+
+    close(fds[1]);
+    workers->push_back({pid, fds[0], index});
+    return true;
+}
+
+// Waits for a worker to be done and returns its result.
+void WaitForWorker(std::vector<Worker>* workers, size_t* index, JobResult* result) {
+    int status = 0;
+    pid_t pid;
+    do {
+        pid = waitpid(-1, &status, 0);
+    } while (pid < 0 && errno == EINTR);
+
+    auto it = std::find_if(workers->begin(), workers->end(),
+                           [pid](const Worker& worker) { return worker.pid == pid; });
+    if (it == workers->end()) {
+        return;
+    }
+
+    *index = it->job;
+    *result = JobResult();
+    if (WIFSIGNALED(status)) {
+        result->status =
+            WTERMSIG(status) == SIGALRM ? JobStatus::kTimedOut : JobStatus::kCrashed;
+    } else if (read(it->fd, result, sizeof(*result)) != sizeof(*result)) {
+        *result = JobResult();
+    }
+
+    close(it->fd);
+    workers->erase(it);
+}
+
+void RunJobs(const std::vector<Job>& jobs,
+             const BatchConfig& config,
+             std::vector<JobResult>* results) {
+    std::vector<Worker> workers;
+    size_t next = 0;
+
+    while (next < jobs.size() || !workers.empty()) {
+        while (next < jobs.size() && (int)workers.size() < config.workers) {
+            if (!StartWorker(next, jobs[next], config, &workers)) {
+                fprintf(stderr, "Failed to start a worker: %s\n", strerror(errno));
+                if (workers.empty()) {
+                    // Nothing to wait for, run the job here.
+                    (*results)[next] = RunJob(jobs[next], config);
+                    PrintResult(next, jobs[next], (*results)[next]);
+                    next++;
+                    continue;
+                }
+                break;
+            }
+            next++;
+        }
+
+        size_t index = jobs.size();
+        JobResult result;
+        WaitForWorker(&workers, &index, &result);
+        if (index < jobs.size()) {
+            (*results)[index] = result;
+            PrintResult(index, jobs[index], result);
+        }
+    }
+}
+
+#endif  // defined(_WIN32)
+
+}  // namespace
+
+// Frontend interface implementation.
+
+struct CoreOptions coreOptions;
+
+uint16_t systemColorMap16[0x10000];
+uint32_t systemColorMap32[0x10000];
+uint16_t systemGbPalette[24];
+int systemRedShift = 0;
+int systemGreenShift = 0;
+int systemBlueShift = 0;
+int systemColorDepth = 0;
+int systemVerbose = 0;
+int systemFrameSkip = 0;
+int systemSaveUpdateCounter = SYSTEM_SAVE_NOT_UPDATED;
+int systemSpeed = 0;
+
+int emulating = 0;
+
+void (*dbgOutput)(const char* s, uint32_t addr);
+void (*dbgSignal)(int sig, int number);
+
+void systemMessage(int, const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+    fputc('\n', stderr);
+}
+
+void log(const char*, ...) {}
+
+bool systemPauseOnFrame() {
+    return false;
+}
+
+void systemGbPrint(uint8_t*, int, int, int, int, int) {}
+
+void systemScreenCapture(int) {}
+
+void systemDrawScreen() {}
+
+void systemSendScreen() {}
+
+bool systemReadJoypads() {
+    return true;
+}
+
+uint32_t systemReadJoypad(int) {
+    return g_movie.input().joypad;
+}
+
+uint32_t systemGetClock() {
+    using namespace std::chrono;
+    return static_cast<uint32_t>(
+        duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+void systemSetTitle(const char*) {}
+
+std::unique_ptr<SoundDriver> systemSoundInit() {
+    return std::make_unique<NullSoundDriver>();
+}
+
+void systemOnWriteDataToSoundBuffer(const uint16_t*, int) {}
+
+void systemOnSoundShutdown() {}
+
+void systemScreenMessage(const char*) {}
+
+void systemUpdateMotionSensor() {}
+
+int systemGetSensorX() {
+    return g_movie.input().sensor_x;
+}
+
+int systemGetSensorY() {
+    return g_movie.input().sensor_y;
+}
+
+int systemGetSensorZ() {
+    return g_movie.input().sensor_z;
+}
+
+uint8_t systemGetSensorDarkness() {
+    return g_movie.input().darkness;
+}
+
+void systemCartridgeRumble(bool) {}
+
+void systemPossibleCartridgeRumble(bool) {}
+
+void updateRumbleFrame() {}
+
+bool systemCanChangeSoundQuality() {
+    return false;
+}
+
+void systemShowSpeed(int) {}
+
+void system10Frames() {}
+
+void systemFrame() {}
+
+void systemGbBorderOn() {}
+
+int main(int argc, char** argv) {
+    BatchConfig config;
+    if (!ParseArgs(argc, argv, &config)) {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    if (config.workers == 0) {
+        config.workers = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    std::vector<Job> jobs;
+    if (!ReadJobs(config.jobs_path, &jobs)) {
+        return 1;
+    }
+
+    InitColorMaps();
+    // The workers running the same games share the ROM pages. The ROM files
+    // must not change while the jobs run.
+    utilSetMapImages(true);
+
+    std::vector<JobResult> results(jobs.size());
+    const auto start = std::chrono::steady_clock::now();
+    RunJobs(jobs, config, &results);
+    const auto end = std::chrono::steady_clock::now();
+
+    size_t failed = 0;
+    int64_t frames = 0;
+    int64_t emulation_ns = 0;
+    for (const JobResult& result : results) {
+        if (result.status != JobStatus::kOk) {
+            failed++;
+        }
+        frames += result.frames;
+        emulation_ns += result.ns;
+    }
+
+    const double seconds =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / 1e9;
+    printf("jobs=%zu failed=%zu workers=%d seconds=%.3f frames=%" PRId64
+           " fps=%.2f job_fps=%.2f\n",
+           jobs.size(), failed, config.workers, seconds, frames,
+           seconds > 0 ? frames / seconds : 0.0,
+           emulation_ns > 0 ? frames / (emulation_ns / 1e9) : 0.0);
+
+    return failed == 0 ? 0 : 2;
+}
@@ -0,0 +1,567 @@
+// vbam-bench: headless benchmark for the GBA and GB cores.
+//
+// Loads a ROM, optionally replays a recorded input stream and runs the core
+// for a fixed number of frames without any frontend attached. At the end, it
+// reports the emulation speed, the per-frame latency distribution and a CRC32
+// of the final emulated memory, so that optimizations can be checked for
+// both speed and behavioral changes.
+//
+// The input stream is a raw file of little-endian 32-bit joypad masks, one
+// per frame, in the format returned by systemReadJoypad(). When the stream is
+// shorter than the number of frames, the last value is held.
+//
+// A movie can be played back instead, the warmup frames are then skipped by
+// seeking in the movie. The run can also be recorded as a movie.
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+
+#include "core/base/color_convert.h"
+#include "core/base/file_util.h"
+#include "core/base/message.h"
+#include "core/base/movie.h"
+#include "core/base/run_ahead.h"
+#include "core/base/sizes.h"
+#include "core/base/sound_driver.h"
+#include "core/base/system.h"
+#include "core/gb/gb.h"
+#include "core/gb/gbGlobals.h"
+#include "core/gb/gbSound.h"
+#include "core/gba/gba.h"
+#include "core/gba/gbaCpu.h"
+#include "core/gba/gbaFlash.h"
+#include "core/gba/gbaGlobals.h"
+#include "core/gba/gbaSound.h"
+
+namespace {
+
+// Sound driver that only counts the samples it is given. This keeps the APU
+// and the resampler in the measured path, as they would be in a real frontend.
+class BenchSoundDriver final : public SoundDriver {
+public:
+    BenchSoundDriver() = default;
+    ~BenchSoundDriver() override = default;
+
+    // SoundDriver implementation.
+    bool init(long) override { return true; }
+    void pause() override {}
+    void reset() override {}
+    void resume() override {}
+    void write(uint16_t*, int length) override { bytes_written_ += length; }
+    void setThrottle(unsigned short) override {}
+
+    static uint64_t bytes_written() { return bytes_written_; }
+
+private:
+    static uint64_t bytes_written_;
+};
+
+uint64_t BenchSoundDriver::bytes_written_ = 0;
+
+struct BenchConfig {
+    std::string rom_path;
+    std::string bios_path;
+    std::string input_path;
+    std::string movie_path;
+    std::string record_path;
+    int frames = 3600;
+    int warmup = 0;
+    bool quiet = false;
+    bool skip_idle_loops = false;
+    bool threaded_render = false;
+    bool video_off = false;
+    bool audio_off = false;
+    ColorConvertMode color_mode = ColorConvertMode::kColorMap;
+};
+
+// Recorded input, one joypad mask per frame.
+std::vector<uint32_t> g_input;
+size_t g_input_frame = 0;
+
+// The movie played back or recorded, if any.
+Movie g_movie;
+
+// Latency histogram buckets, in microseconds. The last bucket collects
+// everything above the largest bound.
+constexpr int64_t kHistogramBoundsUs[] = {
+    125, 250, 500, 1000, 2000, 4000, 8000, 16667, 33333,
+};
+constexpr size_t kHistogramBuckets =
+    sizeof(kHistogramBoundsUs) / sizeof(kHistogramBoundsUs[0]) + 1;
+
+// Both the GBA and the GB refresh at 2^24 / 280896 Hz.
+constexpr double kRealTimeFps = 16777216.0 / 280896.0;
+
+void Usage(const char* argv0) {
+    fprintf(stderr,
+            "Usage: %s [options] <rom>\n"
+            "\n"
+            "Options:\n"
+            "  -f, --frames N   Number of frames to emulate (default: 3600)\n"
+            "  -w, --warmup N   Frames to emulate before measuring (default: 0)\n"
+            "  -i, --input F    Replay joypad input from F (raw LE32 per frame)\n"
+            "  -m, --movie F    Play back the movie F, seek to skip the warmup\n"
+            "  -r, --record F   Record the run to the movie F\n"
+            "  -b, --bios F     Use the BIOS image at F\n"
+            "  -s, --skip-idle  Fast-forward through detected GBA idle loops\n"
+            "  -t, --threaded-render\n"
+            "                   Draw GBA lines on a separate thread\n"
+            "  -n, --video-off  Skip all video output\n"
+            "  -a, --audio-off  Skip all audio output\n"
+            "  -c, --color M    Scanline color conversion: map (default), shift\n"
+            "                   or raw\n"
+            "  -q, --quiet      Only print the summary line\n",
+            argv0);
+}
+
+bool ParseInt(const char* value, int* out) {
+    char* end = nullptr;
+    const long parsed = strtol(value, &end, 10);
+    if (!value[0] || *end || parsed < 0 || parsed > 0x7fffffff) {
+        return false;
+    }
+    *out = static_cast<int>(parsed);
+    return true;
+}
+
+bool ParseArgs(int argc, char** argv, BenchConfig* config) {
+    for (int i = 1; i < argc; i++) {
+        const std::string arg(argv[i]);
+        const bool has_value = i + 1 < argc;
+
+        if ((arg == "-f" || arg == "--frames") && has_value) {
+            if (!ParseInt(argv[++i], &config->frames) || config->frames == 0) {
+                return false;
+            }
+        } else if ((arg == "-w" || arg == "--warmup") && has_value) {
+            if (!ParseInt(argv[++i], &config->warmup)) {
+                return false;
+            }
+        } else if ((arg == "-i" || arg == "--input") && has_value) {
+            config->input_path = argv[++i];
+        } else if ((arg == "-m" || arg == "--movie") && has_value) {
+            config->movie_path = argv[++i];
+        } else if ((arg == "-r" || arg == "--record") && has_value) {
+            config->record_path = argv[++i];
+        } else if ((arg == "-b" || arg == "--bios") && has_value) {
+            config->bios_path = argv[++i];
+        } else if ((arg == "-c" || arg == "--color") && has_value) {
+            const std::string mode(argv[++i]);
+            if (mode == "map") {
+                config->color_mode = ColorConvertMode::kColorMap;
+            } else if (mode == "shift") {
+                config->color_mode = ColorConvertMode::kShift;
+            } else if (mode == "raw") {
+                config->color_mode = ColorConvertMode::kRaw;
+            } else {
+                return false;
+            }
+        } else if (arg == "-s" || arg == "--skip-idle") {
+            config->skip_idle_loops = true;
+        } else if (arg == "-t" || arg == "--threaded-render") {
+            config->threaded_render = true;
+        } else if (arg == "-n" || arg == "--video-off") {
+            config->video_off = true;
+        } else if (arg == "-a" || arg == "--audio-off") {
+            config->audio_off = true;
+        } else if (arg == "-q" || arg == "--quiet") {
+            config->quiet = true;
+        } else if (arg[0] != '-' && config->rom_path.empty()) {
+            config->rom_path = arg;
+        } else {
+            return false;
+        }
+    }
+
+    return !config->rom_path.empty() &&
+           (config->movie_path.empty() || config->record_path.empty());
+}
+
+bool ReadFile(const std::string& path, std::vector<uint8_t>* data) {
+    FILE* f = utilOpenFile(path.c_str(), "rb");
+    if (!f) {
+        return false;
+    }
+
+    fseek(f, 0, SEEK_END);
+    const long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (size < 0) {
+        fclose(f);
+        return false;
+    }
+
+    data->resize(static_cast<size_t>(size));
+    const size_t read = fread(data->data(), 1, data->size(), f);
+    fclose(f);
+    return read == data->size();
+}
+
+bool LoadInput(const std::string& path) {
+    std::vector<uint8_t> data;
+    if (!ReadFile(path, &data)) {
+        return false;
+    }
+
+    g_input.resize(data.size() / 4);
+    for (size_t i = 0; i < g_input.size(); i++) {
+        const uint8_t* p = &data[i * 4];
+        g_input[i] = p[0] | (p[1] << 8) | (p[2] << 16) | (uint32_t(p[3]) << 24);
+    }
+    return true;
+}
+
+void InitColorMaps() {
+    systemColorDepth = 32;
+    systemRedShift = 19;
+    systemGreenShift = 11;
+    systemBlueShift = 3;
+
+    for (int i = 0; i < 0x10000; i++) {
+        systemColorMap32[i] = ((i & 0x1f) << systemRedShift) |
+                              (((i & 0x3e0) >> 5) << systemGreenShift) |
+                              (((i & 0x7c00) >> 10) << systemBlueShift);
+        systemColorMap16[i] = ((i & 0x1f) << 11) | (((i & 0x3e0) >> 5) << 6) |
+                              ((i & 0x7c00) >> 10);
+    }
+}
+
+bool LoadGBA(const std::vector<uint8_t>& rom, const BenchConfig& config) {
+    const int size = CPULoadRomData(reinterpret_cast<const char*>(rom.data()),
+                                    static_cast<int>(rom.size()));
+    if (size == 0) {
+        return false;
+    }
+
+    flashDetectSaveType(size);
+    doMirroring(coreOptions.mirroringEnable);
+    soundSetSampleRate(48000);
+    CPUInit(config.bios_path.c_str(), !config.bios_path.empty());
+    CPUReset();
+    return true;
+}
+
+bool LoadGB(const std::vector<uint8_t>& rom, const BenchConfig& config) {
+    if (!gbLoadRomData(reinterpret_cast<const char*>(rom.data()), rom.size())) {
+        return false;
+    }
+
+    gbGetHardwareType();
+    if (!config.bios_path.empty()) {
+        gbCPUInit(config.bios_path.c_str(), true);
+    }
+    gbSoundSetSampleRate(48000);
+    gbReset();
+    return true;
+}
+
+// Emulates one frame, with the input of the movie when there is one.
+void EmulateFrame(const EmulatedSystem& emulator) {
+    MovieInput live;
+    if (!g_input.empty()) {
+        live.joypad = g_input[std::min(g_input_frame, g_input.size() - 1)];
+    }
+    g_movie.NextFrame(emulator, live);
+    g_input_frame++;
+
+    RunAhead::EmulateUntilFrameDone(emulator);
+}
+
+uint32_t StateChecksum(IMAGE_TYPE type) {
+    uLong crc = crc32(0L, Z_NULL, 0);
+    if (type == IMAGE_GBA) {
+        crc = crc32(crc, g_workRAM, SIZE_WRAM);
+        crc = crc32(crc, g_internalRAM, SIZE_IRAM);
+        crc = crc32(crc, g_paletteRAM, SIZE_PRAM);
+        crc = crc32(crc, g_vram, SIZE_VRAM);
+        crc = crc32(crc, g_oam, SIZE_OAM);
+        crc = crc32(crc, g_ioMem, SIZE_IOMEM);
+        crc = crc32(crc, g_pix, SIZE_PIX);
+    } else {
+        crc = crc32(crc, gbMemory, 0x10000);
+        if (gbWram) {
+            crc = crc32(crc, gbWram, kGBWRamSize);
+        }
+        if (gbVram) {
+            crc = crc32(crc, gbVram, kGBVRamSize);
+        }
+        crc = crc32(crc, g_pix, static_cast<uInt>(kGBPixSize));
+    }
+    return static_cast<uint32_t>(crc);
+}
+
+}  // namespace
+
+// Frontend interface implementation.
+
+struct CoreOptions coreOptions;
+
+uint16_t systemColorMap16[0x10000];
+uint32_t systemColorMap32[0x10000];
+uint16_t systemGbPalette[24];
+int systemRedShift = 0;
+int systemGreenShift = 0;
+int systemBlueShift = 0;
+int systemColorDepth = 0;
+int systemVerbose = 0;
+int systemFrameSkip = 0;
+int systemSaveUpdateCounter = SYSTEM_SAVE_NOT_UPDATED;
+int systemSpeed = 0;
+
+int emulating = 0;
+
+void (*dbgOutput)(const char* s, uint32_t addr);
+void (*dbgSignal)(int sig, int number);
+
+void systemMessage(int, const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+    fputc('\n', stderr);
+}
+
+void log(const char*, ...) {}
+
+bool systemPauseOnFrame() {
+    return false;
+}
+
+void systemGbPrint(uint8_t*, int, int, int, int, int) {}
+
+void systemScreenCapture(int) {}
+
+void systemDrawScreen() {}
+
+void systemSendScreen() {}
+
+bool systemReadJoypads() {
+    return true;
+}
+
+uint32_t systemReadJoypad(int) {
+    return g_movie.input().joypad;
+}
+
+uint32_t systemGetClock() {
+    using namespace std::chrono;
+    return static_cast<uint32_t>(
+        duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+void systemSetTitle(const char*) {}
+
+std::unique_ptr<SoundDriver> systemSoundInit() {
+    return std::make_unique<BenchSoundDriver>();
+}
+
+void systemOnWriteDataToSoundBuffer(const uint16_t*, int) {}
+
+void systemOnSoundShutdown() {}
+
+void systemScreenMessage(const char*) {}
+
+void systemUpdateMotionSensor() {}
+
+int systemGetSensorX() {
+    return g_movie.input().sensor_x;
+}
+
+int systemGetSensorY() {
+    return g_movie.input().sensor_y;
+}
+
+int systemGetSensorZ() {
+    return g_movie.input().sensor_z;
+}
+
+uint8_t systemGetSensorDarkness() {
+    return g_movie.input().darkness;
+}
+
+void systemCartridgeRumble(bool) {}
+
+void systemPossibleCartridgeRumble(bool) {}
+
+void updateRumbleFrame() {}
+
+bool systemCanChangeSoundQuality() {
+    return false;
+}
+
+void systemShowSpeed(int) {}
+
+void system10Frames() {}
+
+void systemFrame() {}
+
+void systemGbBorderOn() {}
+
+int main(int argc, char** argv) {
+    BenchConfig config;
+    if (!ParseArgs(argc, argv, &config)) {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    if (!config.input_path.empty() && !LoadInput(config.input_path)) {
+        fprintf(stderr, "Failed to read input stream %s\n", config.input_path.c_str());
+        return 1;
+    }
+
+    if (!config.movie_path.empty() && !g_movie.Load(config.movie_path.c_str())) {
+        fprintf(stderr, "Failed to read movie %s\n", config.movie_path.c_str());
+        return 1;
+    }
+
+    const IMAGE_TYPE type = utilFindType(config.rom_path.c_str());
+    if (type == IMAGE_UNKNOWN) {
+        fprintf(stderr, "Unknown file type %s\n", config.rom_path.c_str());
+        return 1;
+    }
+
+    std::vector<uint8_t> rom;
+    if (!ReadFile(config.rom_path, &rom) || rom.empty()) {
+        fprintf(stderr, "Failed to read %s\n", config.rom_path.c_str());
+        return 1;
+    }
+
+    InitColorMaps();
+    colorConvertSetMode(config.color_mode);
+    coreOptions.cheatsEnabled = 0;
+    coreOptions.skipBios = true;
+    coreOptions.skipIdleLoops = config.skip_idle_loops;
+    coreOptions.threadedRender = config.threaded_render;
+    coreOptions.videoOff = config.video_off;
+    coreOptions.audioOff = config.audio_off;
+    soundInit();
+
+    EmulatedSystem emulator;
+    bool loaded = false;
+    if (type == IMAGE_GBA) {
+        loaded = LoadGBA(rom, config);
+        emulator = GBASystem;
+    } else {
+        loaded = LoadGB(rom, config);
+        emulator = GBSystem;
+    }
+    if (!loaded) {
+        fprintf(stderr, "Failed to load %s\n", config.rom_path.c_str());
+        return 1;
+    }
+
+    emulating = 1;
+
+    if (!config.movie_path.empty()) {
+        if (!g_movie.StartPlayback(emulator) || !g_movie.Seek(emulator, config.warmup)) {
+            fprintf(stderr, "Failed to play back movie %s\n", config.movie_path.c_str());
+            return 1;
+        }
+    } else {
+        if (!config.record_path.empty() && !g_movie.StartRecording(emulator)) {
+            fprintf(stderr, "Failed to start recording\n");
+            return 1;
+        }
+        for (int i = 0; i < config.warmup; i++) {
+            EmulateFrame(emulator);
+        }
+    }
+
+    armOpcodeCount = 0;
+    thumbOpcodeCount = 0;
+
+    std::vector<int64_t> frame_ns(config.frames);
+    const auto start = std::chrono::steady_clock::now();
+    auto frame_start = start;
+
+    for (int i = 0; i < config.frames; i++) {
+        EmulateFrame(emulator);
+
+        const auto frame_end = std::chrono::steady_clock::now();
+        frame_ns[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          frame_end - frame_start)
+                          .count();
+        frame_start = frame_end;
+    }
+
+    const int64_t total_ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(frame_start - start).count();
+    const uint32_t checksum = StateChecksum(type);
+
+    if (!config.record_path.empty()) {
+        g_movie.Stop();
+        if (!g_movie.Save(config.record_path.c_str())) {
+            fprintf(stderr, "Failed to write movie %s\n", config.record_path.c_str());
+            return 1;
+        }
+    }
+
+    emulating = 0;
+    emulator.emuCleanUp();
+    soundShutdown();
+
+    size_t histogram[kHistogramBuckets] = {};
+    for (const int64_t ns : frame_ns) {
+        size_t bucket = 0;
+        while (bucket < kHistogramBuckets - 1 && ns / 1000 >= kHistogramBoundsUs[bucket]) {
+            bucket++;
+        }
+        histogram[bucket]++;
+    }
+
+    std::vector<int64_t> sorted = frame_ns;
+    std::sort(sorted.begin(), sorted.end());
+    const auto percentile = [&sorted](double p) {
+        return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))];
+    };
+
+    const double seconds = total_ns / 1e9;
+    const double fps = config.frames / seconds;
+    const uint64_t opcodes = uint64_t(armOpcodeCount) + thumbOpcodeCount;
+
+    if (!config.quiet) {
+        printf("ROM:            %s (%s)\n", config.rom_path.c_str(),
+               type == IMAGE_GBA ? "GBA" : "GB");
+        printf("Frames:         %d (+%d warmup)\n", config.frames, config.warmup);
+        printf("Time:           %.3f s\n", seconds);
+        printf("Speed:          %.2f fps (%.1f%% of real time)\n", fps,
+               fps * 100.0 / kRealTimeFps);
+        printf("Frame time:     %.0f ns avg, %" PRId64 " ns p50, %" PRId64
+               " ns p99, %" PRId64 " ns max\n",
+               double(total_ns) / config.frames, percentile(0.5), percentile(0.99),
+               sorted.back());
+        if (type == IMAGE_GBA) {
+            printf("Opcodes:        %" PRIu64 " ARM, %" PRIu64 " Thumb (%.1f M/s)\n",
+                   uint64_t(armOpcodeCount), uint64_t(thumbOpcodeCount),
+                   opcodes / seconds / 1e6);
+        }
+        printf("Audio:          %" PRIu64 " bytes\n", BenchSoundDriver::bytes_written());
+        printf("Latency histogram:\n");
+        for (size_t i = 0; i < kHistogramBuckets; i++) {
+            char label[32];
+            if (i < kHistogramBuckets - 1) {
+                snprintf(label, sizeof(label), "< %" PRId64 " us", kHistogramBoundsUs[i]);
+            } else {
+                snprintf(label, sizeof(label), ">= %" PRId64 " us", kHistogramBoundsUs[i - 1]);
+            }
+            printf("  %-12s %8zu  %5.1f%%\n", label, histogram[i],
+                   histogram[i] * 100.0 / config.frames);
+        }
+    }
+
+    printf("frames=%d fps=%.2f ns_per_frame=%.0f opcodes=%" PRIu64 " crc32=%08x\n",
+           config.frames, fps, double(total_ns) / config.frames, opcodes, checksum);
+
+    return 0;
+}
@@ -648,12 +648,10 @@ recording::MediaRet recording::MediaRecorder::AddFrame(const uint16_t *aud, int
     posInAudioBuffer = 0;
     samplesInAudioBuffer = 0;
     memset(audioBuffer, 0, audioBufferSize);
+    // the rest may be longer than one audio frame, the writes have
+    // no fixed length
     if (isMissing)
-    {
-        memcpy(audioBuffer, aud, cp * 2);
-        posInAudioBuffer = cp;
-        samplesInAudioBuffer = (cp / 2);
-    }
+        return AddFrame(aud, cp * sizeof *aud);
     return MRET_OK;
 }
 
@@ -1,6 +1,7 @@
 // Blip_Buffer 0.4.1. http://www.slack.net/~ant/
 
 #include "core/apu/Blip_Buffer.h"
+#include "core/apu/Blip_Simd.h"
 
 #include <assert.h>
 #include <limits.h>
@@ -387,36 +388,46 @@ long Blip_Buffer::read_samples( blip_sample_t* out_, long max_samples, int stere
 
 	if ( count )
 	{
-		int const bass = BLIP_READER_BASS( *this );
-		BLIP_READER_BEGIN( reader, *this );
-		BLIP_READER_ADJ_( reader, count );
-		blip_sample_t* BLIP_RESTRICT out = out_ + count;
-		blip_long offset = (blip_long) -count;
-
-		if ( !stereo )
+#ifdef BLIP_SIMD
+		if ( blip_simd )
 		{
-			do
-			{
-				blip_long s = BLIP_READER_READ( reader );
-				BLIP_READER_NEXT_IDX_( reader, bass, offset );
-				BLIP_CLAMP( s, s );
-				out [offset] = (blip_sample_t) s;
-			}
-			while ( ++offset );
+			blip_simd_read_mono( out_, stereo ? blip_simd_left : blip_simd_mono,
+					buffer_, &reader_accum_, bass_shift_, (int) count );
 		}
 		else
+#endif
 		{
-			do
+			int const bass = BLIP_READER_BASS( *this );
+			BLIP_READER_BEGIN( reader, *this );
+			BLIP_READER_ADJ_( reader, count );
+			blip_sample_t* BLIP_RESTRICT out = out_ + count;
+			blip_long offset = (blip_long) -count;
+
+			if ( !stereo )
 			{
-				blip_long s = BLIP_READER_READ( reader );
-				BLIP_READER_NEXT_IDX_( reader, bass, offset );
-				BLIP_CLAMP( s, s );
-				out [offset * 2] = (blip_sample_t) s;
+				do
+				{
+					blip_long s = BLIP_READER_READ( reader );
+					BLIP_READER_NEXT_IDX_( reader, bass, offset );
+					BLIP_CLAMP( s, s );
+					out [offset] = (blip_sample_t) s;
+				}
+				while ( ++offset );
+			}
+			else
+			{
+				do
+				{
+					blip_long s = BLIP_READER_READ( reader );
+					BLIP_READER_NEXT_IDX_( reader, bass, offset );
+					BLIP_CLAMP( s, s );
+					out [offset * 2] = (blip_sample_t) s;
+				}
+				while ( ++offset );
 			}
-			while ( ++offset );
-		}
 
-		BLIP_READER_END( reader, *this );
+			BLIP_READER_END( reader, *this );
+		}
 
 		remove_samples( count );
 	}
@@ -0,0 +1,213 @@
+#include "core/apu/Blip_Simd.h"
+
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#ifdef BLIP_SIMD
+
+namespace {
+
+int const sample_shift = blip_sample_bits - 16;
+
+// Sample counts around the vector and chunk sizes of the SIMD loops.
+int const counts[] = { 0, 1, 3, 4, 5, 7, 8, 9, 63, 64, 65, 127, 128, 200, 1001 };
+
+// The scalar loops the SIMD loops replace, from Blip_Buffer::read_samples(),
+// Stereo_Mixer and Effects_Buffer.
+
+void read_mono( blip_sample_t* out, blip_simd_out_t mode, Blip_Buffer::buf_t_ const* in,
+		blip_long* accum, int bass, int count )
+{
+	for ( int i = 0; i < count; i++ )
+	{
+		blip_long s = *accum >> sample_shift;
+		*accum -= *accum >> bass;
+		*accum += in [i];
+		BLIP_CLAMP( s, s );
+		switch ( mode )
+		{
+		case blip_simd_mono: out [i] = (blip_sample_t) s; break;
+		case blip_simd_left: out [i * 2] = (blip_sample_t) s; break;
+		case blip_simd_both: out [i * 2] = out [i * 2 + 1] = (blip_sample_t) s; break;
+		}
+	}
+}
+
+void read_stereo( blip_sample_t* out, Blip_Buffer::buf_t_ const* left,
+		Blip_Buffer::buf_t_ const* right, Blip_Buffer::buf_t_ const* center,
+		blip_long accum [3], int bass, int count )
+{
+	for ( int i = 0; i < count; i++ )
+	{
+		blip_long l = (accum [2] + accum [0]) >> sample_shift;
+		blip_long r = (accum [2] + accum [1]) >> sample_shift;
+		for ( int c = 0; c < 3; c++ )
+			accum [c] -= accum [c] >> bass;
+		accum [0] += left   [i];
+		accum [1] += right  [i];
+		accum [2] += center [i];
+		BLIP_CLAMP( l, l );
+		BLIP_CLAMP( r, r );
+		out [i * 2    ] = (blip_sample_t) l;
+		out [i * 2 + 1] = (blip_sample_t) r;
+	}
+}
+
+void mix_pairs( blip_long* out, Blip_Buffer::buf_t_ const* in, blip_long* accum, int bass,
+		blip_long vol_0, blip_long vol_1, int count )
+{
+	for ( int i = 0; i < count; i++ )
+	{
+		blip_long s = *accum >> sample_shift;
+		*accum -= *accum >> bass;
+		*accum += in [i];
+		out [i * 2    ] += s * vol_0;
+		out [i * 2 + 1] += s * vol_1;
+	}
+}
+
+void clamp( blip_sample_t* out, blip_long const* in, int shift, int count )
+{
+	for ( int i = 0; i < count; i++ )
+	{
+		blip_long s = in [i] >> shift;
+		BLIP_CLAMP( s, s );
+		out [i] = (blip_sample_t) s;
+	}
+}
+
+template<class T>
+std::vector<T> random_values( std::mt19937& rng, size_t size, int32_t min, int32_t max )
+{
+	std::uniform_int_distribution<int32_t> dist( min, max );
+	std::vector<T> values( size );
+	for ( T& value : values )
+		value = (T) dist( rng );
+	return values;
+}
+
+// The buffer deltas and the accumulators are kept within 30 bits, as in
+// Blip_Buffer, so that the scalar loops do not overflow. They still give
+// samples well past 16 bits, which are clamped.
+int32_t const max_delta = 1 << 21;
+int32_t const max_accum = 1 << 29;
+int const max_bass = 8;
+
+class BlipSimdTest : public ::testing::Test {
+protected:
+	void SetUp() override
+	{
+		if ( !blip_simd )
+			GTEST_SKIP() << "The CPU does not support the SIMD loops";
+	}
+
+	std::mt19937 rng { 1 };
+};
+
+}  // namespace
+
+TEST_F( BlipSimdTest, ReadMono )
+{
+	blip_simd_out_t const modes[] = { blip_simd_mono, blip_simd_left, blip_simd_both };
+	for ( blip_simd_out_t mode : modes )
+	{
+		for ( int count : counts )
+		{
+			int const bass = rng() % (max_bass + 1);
+			auto in = random_values<Blip_Buffer::buf_t_>( rng, count, -max_delta, max_delta );
+			blip_long accum = random_values<blip_long>( rng, 1, -max_accum, max_accum ) [0];
+			// Left only leaves the right samples as they are.
+			auto expected = random_values<blip_sample_t>( rng, count * 2 + 1, -0x8000, 0x7FFF );
+			auto out = expected;
+			blip_long expected_accum = accum;
+
+			read_mono( expected.data(), mode, in.data(), &expected_accum, bass, count );
+			blip_simd_read_mono( out.data(), mode, in.data(), &accum, bass, count );
+
+			EXPECT_EQ( out, expected ) << "mode " << mode << " count " << count;
+			EXPECT_EQ( accum, expected_accum ) << "mode " << mode << " count " << count;
+		}
+	}
+}
+
+TEST_F( BlipSimdTest, ReadStereo )
+{
+	for ( int count : counts )
+	{
+		int const bass = rng() % (max_bass + 1);
+		auto left   = random_values<Blip_Buffer::buf_t_>( rng, count, -max_delta, max_delta );
+		auto right  = random_values<Blip_Buffer::buf_t_>( rng, count, -max_delta, max_delta );
+		auto center = random_values<Blip_Buffer::buf_t_>( rng, count, -max_delta, max_delta );
+		// Left and right are added to center.
+		auto accum = random_values<blip_long>( rng, 3, -max_accum / 2, max_accum / 2 );
+		std::vector<blip_sample_t> expected( count * 2 + 1 ), out( count * 2 + 1 );
+		auto expected_accum = accum;
+
+		read_stereo( expected.data(), left.data(), right.data(), center.data(),
+				expected_accum.data(), bass, count );
+		blip_simd_read_stereo( out.data(), left.data(), right.data(), center.data(),
+				accum.data(), bass, count );
+
+		EXPECT_EQ( out, expected ) << "count " << count;
+		EXPECT_EQ( accum, expected_accum ) << "count " << count;
+	}
+}
+
+TEST_F( BlipSimdTest, MixPairs )
+{
+	for ( int count : counts )
+	{
+		int const bass = rng() % (max_bass + 1);
+		auto in = random_values<Blip_Buffer::buf_t_>( rng, count, -max_delta, max_delta );
+		blip_long accum = random_values<blip_long>( rng, 1, -max_accum, max_accum ) [0];
+		auto vol = random_values<blip_long>( rng, 2, -0x1000, 0x1000 );
+		auto expected = random_values<blip_long>( rng, count * 2 + 1, -max_accum, max_accum );
+		auto out = expected;
+		blip_long expected_accum = accum;
+
+		mix_pairs( expected.data(), in.data(), &expected_accum, bass, vol [0], vol [1], count );
+		blip_simd_mix_pairs( out.data(), in.data(), &accum, bass, vol [0], vol [1], count );
+
+		EXPECT_EQ( out, expected ) << "count " << count;
+		EXPECT_EQ( accum, expected_accum ) << "count " << count;
+	}
+}
+
+TEST_F( BlipSimdTest, Clamp )
+{
+	// With the small shifts, most values are past 24 bits, and take the slow
+	// path of the SSE2 clamp.
+	for ( int shift = 0; shift <= 16; shift++ )
+	{
+		for ( int count : counts )
+		{
+			auto in = random_values<blip_long>( rng, count, INT32_MIN, INT32_MAX );
+			std::vector<blip_sample_t> expected( count + 1 ), out( count + 1 );
+
+			clamp( expected.data(), in.data(), shift, count );
+			blip_simd_clamp( out.data(), in.data(), shift, count );
+
+			EXPECT_EQ( out, expected ) << "shift " << shift << " count " << count;
+		}
+	}
+}
+
+TEST_F( BlipSimdTest, ClampAroundTheLimits )
+{
+	// Values on both sides of the 16 and 24-bit limits, in every lane.
+	blip_long const limits[] = { 0x7FFF, 0x8000, -0x8000, -0x8001, 0xFFFFFF, 0x1000000,
+			-0x1000000, -0x1000001, INT32_MAX, INT32_MIN, 0 };
+	std::vector<blip_long> in;
+	for ( int i = 0; i < 64; i++ )
+		in.push_back( limits [(i * 7 + i / 11) % (sizeof limits / sizeof *limits)] );
+	std::vector<blip_sample_t> expected( in.size() ), out( in.size() );
+
+	clamp( expected.data(), in.data(), 0, (int) in.size() );
+	blip_simd_clamp( out.data(), in.data(), 0, (int) in.size() );
+
+	EXPECT_EQ( out, expected );
+}
+
+#endif  // BLIP_SIMD
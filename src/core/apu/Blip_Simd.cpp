@@ -0,0 +1,372 @@
+// SIMD versions of the loops reading samples from Blip_Buffer
+
+#include "core/apu/Blip_Simd.h"
+
+#ifdef BLIP_SIMD
+
+#if defined(BLIP_SIMD_SSE2)
+	#include <emmintrin.h>
+	#if defined(_MSC_VER) && !defined(_M_X64)
+		#include <intrin.h>
+	#endif
+#else
+	#include <arm_neon.h>
+#endif
+
+// The accumulators are moved in and out of 32-bit lanes
+static_assert( sizeof (blip_long) == 4, "blip_long must be 32 bits" );
+static_assert( sizeof (Blip_Buffer::buf_t_) == 4, "Blip_Buffer::buf_t_ must be 32 bits" );
+
+int const sample_shift = blip_sample_bits - 16;
+
+// Vector operations on four 32-bit values
+
+#if defined(BLIP_SIMD_SSE2)
+
+// 32-bit x86 only has SSE2 if the compiler was told so, otherwise these
+// functions are compiled for it anyway and only called if the CPU has it.
+#if defined(__GNUC__) && !defined(__SSE2__)
+	#define BLIP_SIMD_TARGET __attribute__((target("sse2")))
+#else
+	#define BLIP_SIMD_TARGET
+#endif
+
+typedef __m128i vec_t;
+typedef __m128i shift_t;
+
+static bool supported()
+{
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	return true;
+#elif defined(__GNUC__)
+	return __builtin_cpu_supports( "sse2" );
+#elif defined(_MSC_VER)
+	int info [4];
+	__cpuid( info, 1 );
+	return (info [3] >> 26) & 1;
+#else
+	return false;
+#endif
+}
+
+BLIP_SIMD_TARGET static inline shift_t make_shift( int n ) { return _mm_cvtsi32_si128( n ); }
+BLIP_SIMD_TARGET static inline vec_t vzero() { return _mm_setzero_si128(); }
+BLIP_SIMD_TARGET static inline vec_t vset( blip_long a, blip_long b, blip_long c, blip_long d )
+{
+	return _mm_setr_epi32( a, b, c, d );
+}
+BLIP_SIMD_TARGET static inline vec_t vload( blip_long const* p ) { return _mm_loadu_si128( (__m128i const*) p ); }
+BLIP_SIMD_TARGET static inline void vstore( blip_long* p, vec_t v ) { _mm_storeu_si128( (__m128i*) p, v ); }
+BLIP_SIMD_TARGET static inline vec_t vadd( vec_t a, vec_t b ) { return _mm_add_epi32( a, b ); }
+BLIP_SIMD_TARGET static inline vec_t vsub( vec_t a, vec_t b ) { return _mm_sub_epi32( a, b ); }
+BLIP_SIMD_TARGET static inline vec_t vsra( vec_t v, shift_t n ) { return _mm_sra_epi32( v, n ); }
+
+// Low 32 bits of the products, SSE2 only multiplies the even lanes
+BLIP_SIMD_TARGET static inline vec_t vmul( vec_t a, vec_t b )
+{
+	vec_t even = _mm_mul_epu32( a, b );
+	vec_t odd  = _mm_mul_epu32( _mm_srli_epi64( a, 32 ), _mm_srli_epi64( b, 32 ) );
+	return _mm_unpacklo_epi32( _mm_shuffle_epi32( even, _MM_SHUFFLE( 0, 0, 2, 0 ) ),
+			_mm_shuffle_epi32( odd, _MM_SHUFFLE( 0, 0, 2, 0 ) ) );
+}
+
+// a0 a0 a1 a1, a2 a2 a3 a3
+BLIP_SIMD_TARGET static inline vec_t vdup_lo( vec_t v ) { return _mm_unpacklo_epi32( v, v ); }
+BLIP_SIMD_TARGET static inline vec_t vdup_hi( vec_t v ) { return _mm_unpackhi_epi32( v, v ); }
+
+BLIP_SIMD_TARGET static inline void vtranspose( vec_t& a, vec_t& b, vec_t& c, vec_t& d )
+{
+	vec_t ab_lo = _mm_unpacklo_epi32( a, b );
+	vec_t cd_lo = _mm_unpacklo_epi32( c, d );
+	vec_t ab_hi = _mm_unpackhi_epi32( a, b );
+	vec_t cd_hi = _mm_unpackhi_epi32( c, d );
+	a = _mm_unpacklo_epi64( ab_lo, cd_lo );
+	b = _mm_unpackhi_epi64( ab_lo, cd_lo );
+	c = _mm_unpacklo_epi64( ab_hi, cd_hi );
+	d = _mm_unpackhi_epi64( ab_hi, cd_hi );
+}
+
+// Same as BLIP_CLAMP() followed by the cast to blip_sample_t, sign-extended
+BLIP_SIMD_TARGET static inline vec_t vclamp( vec_t v )
+{
+	vec_t const max = _mm_set1_epi32( 0x7FFF );
+	vec_t out = _mm_or_si128( _mm_cmpgt_epi32( v, max ), _mm_cmplt_epi32( v, _mm_set1_epi32( -0x8000 ) ) );
+	vec_t clamped = _mm_xor_si128( _mm_srai_epi32( v, 24 ), max );
+	v = _mm_or_si128( _mm_and_si128( out, clamped ), _mm_andnot_si128( out, v ) );
+	return _mm_srai_epi32( _mm_slli_epi32( v, 16 ), 16 );
+}
+
+// Clamps a and b to 16 bits, packed in that order. BLIP_CLAMP() saturates
+// values within 24 bits, so only larger ones need vclamp().
+BLIP_SIMD_TARGET static inline __m128i vpack( vec_t a, vec_t b )
+{
+	vec_t const bias = _mm_set1_epi32( 1 << 24 );
+	vec_t large = _mm_or_si128( _mm_srli_epi32( _mm_add_epi32( a, bias ), 25 ),
+			_mm_srli_epi32( _mm_add_epi32( b, bias ), 25 ) );
+	if ( _mm_movemask_epi8( _mm_cmpeq_epi32( large, _mm_setzero_si128() ) ) != 0xFFFF )
+	{
+		a = vclamp( a );
+		b = vclamp( b );
+	}
+	return _mm_packs_epi32( a, b );
+}
+
+// The stores clamp the values to 16 bits
+
+BLIP_SIMD_TARGET static inline void store_mono( blip_sample_t* out, vec_t v )
+{
+	_mm_storel_epi64( (__m128i*) out, vpack( v, v ) );
+}
+
+BLIP_SIMD_TARGET static inline void store_8( blip_sample_t* out, vec_t a, vec_t b )
+{
+	_mm_storeu_si128( (__m128i*) out, vpack( a, b ) );
+}
+
+BLIP_SIMD_TARGET static inline void store_pairs( blip_sample_t* out, vec_t left, vec_t right )
+{
+	__m128i p = vpack( left, right );
+	_mm_storeu_si128( (__m128i*) out, _mm_unpacklo_epi16( p, _mm_unpackhi_epi64( p, p ) ) );
+}
+
+BLIP_SIMD_TARGET static inline void store_left( blip_sample_t* out, vec_t v )
+{
+	vec_t right = _mm_and_si128( _mm_loadu_si128( (__m128i const*) out ), _mm_set1_epi32( (int) 0xFFFF0000 ) );
+	vec_t left = _mm_unpacklo_epi16( vpack( v, v ), _mm_setzero_si128() );
+	_mm_storeu_si128( (__m128i*) out, _mm_or_si128( right, left ) );
+}
+
+#else
+
+#define BLIP_SIMD_TARGET
+
+typedef int32x4_t vec_t;
+struct shift_t { int32x4_t right; };
+
+static bool supported() { return true; }
+
+static inline shift_t make_shift( int n ) { shift_t s = { vdupq_n_s32( -n ) }; return s; }
+static inline vec_t vzero() { return vdupq_n_s32( 0 ); }
+static inline vec_t vset( blip_long a, blip_long b, blip_long c, blip_long d )
+{
+	int32_t const v [4] = { (int32_t) a, (int32_t) b, (int32_t) c, (int32_t) d };
+	return vld1q_s32( v );
+}
+static inline vec_t vload( blip_long const* p ) { return vld1q_s32( (int32_t const*) p ); }
+static inline void vstore( blip_long* p, vec_t v ) { vst1q_s32( (int32_t*) p, v ); }
+static inline vec_t vadd( vec_t a, vec_t b ) { return vaddq_s32( a, b ); }
+static inline vec_t vsub( vec_t a, vec_t b ) { return vsubq_s32( a, b ); }
+static inline vec_t vsra( vec_t v, shift_t n ) { return vshlq_s32( v, n.right ); }
+static inline vec_t vmul( vec_t a, vec_t b ) { return vmulq_s32( a, b ); }
+static inline vec_t vdup_lo( vec_t v ) { return vzipq_s32( v, v ).val [0]; }
+static inline vec_t vdup_hi( vec_t v ) { return vzipq_s32( v, v ).val [1]; }
+
+static inline void vtranspose( vec_t& a, vec_t& b, vec_t& c, vec_t& d )
+{
+	int32x4x2_t ab = vtrnq_s32( a, b );
+	int32x4x2_t cd = vtrnq_s32( c, d );
+	a = vcombine_s32( vget_low_s32 ( ab.val [0] ), vget_low_s32 ( cd.val [0] ) );
+	b = vcombine_s32( vget_low_s32 ( ab.val [1] ), vget_low_s32 ( cd.val [1] ) );
+	c = vcombine_s32( vget_high_s32( ab.val [0] ), vget_high_s32( cd.val [0] ) );
+	d = vcombine_s32( vget_high_s32( ab.val [1] ), vget_high_s32( cd.val [1] ) );
+}
+
+// Same as BLIP_CLAMP() followed by the cast to blip_sample_t, sign-extended
+static inline vec_t vclamp( vec_t v )
+{
+	vec_t const max = vdupq_n_s32( 0x7FFF );
+	uint32x4_t out = vorrq_u32( vcgtq_s32( v, max ), vcltq_s32( v, vdupq_n_s32( -0x8000 ) ) );
+	v = vbslq_s32( out, veorq_s32( vshrq_n_s32( v, 24 ), max ), v );
+	return vshrq_n_s32( vshlq_n_s32( v, 16 ), 16 );
+}
+
+// The stores clamp the values to 16 bits
+
+static inline void store_mono( blip_sample_t* out, vec_t v ) { vst1_s16( out, vmovn_s32( vclamp( v ) ) ); }
+
+static inline void store_8( blip_sample_t* out, vec_t a, vec_t b )
+{
+	vst1q_s16( out, vcombine_s16( vmovn_s32( vclamp( a ) ), vmovn_s32( vclamp( b ) ) ) );
+}
+
+static inline void store_pairs( blip_sample_t* out, vec_t left, vec_t right )
+{
+	int16x4x2_t pairs = { { vmovn_s32( vclamp( left ) ), vmovn_s32( vclamp( right ) ) } };
+	vst2_s16( out, pairs );
+}
+
+static inline void store_left( blip_sample_t* out, vec_t v )
+{
+	int16x4x2_t pairs = vld2_s16( out );
+	pairs.val [0] = vmovn_s32( vclamp( v ) );
+	vst2_s16( out, pairs );
+}
+
+#endif
+
+bool blip_simd = supported();
+
+// Loops
+
+// One channel has a single accumulator, its integration stays sequential: a
+// chunk is integrated first, then converted four samples at a time.
+int const chunk_size = 64;
+
+// Integrates count samples of in, stores the accumulator before each one
+static inline void integrate( Blip_Buffer::buf_t_ const* in, blip_long& accum, int bass,
+		blip_long* out, int count )
+{
+	for ( int i = 0; i < count; i++ )
+	{
+		out [i] = accum;
+		accum -= accum >> bass;
+		accum += in [i];
+	}
+}
+
+BLIP_SIMD_TARGET
+void blip_simd_read_mono( blip_sample_t* out, blip_simd_out_t mode, Blip_Buffer::buf_t_ const* in,
+		blip_long* accum_, int bass, int count )
+{
+	shift_t const shift = make_shift( sample_shift );
+	blip_long accum = *accum_;
+	blip_long raw [chunk_size];
+	while ( count )
+	{
+		int const n = count < chunk_size ? count : chunk_size;
+		integrate( in, accum, bass, raw, n );
+
+		int i = 0;
+		for ( ; i + 4 <= n; i += 4 )
+		{
+			vec_t s = vsra( vload( raw + i ), shift );
+			switch ( mode )
+			{
+			case blip_simd_mono: store_mono( out + i, s ); break;
+			case blip_simd_left: store_left( out + i * 2, s ); break;
+			case blip_simd_both: store_pairs( out + i * 2, s, s ); break;
+			}
+		}
+
+		for ( ; i < n; i++ )
+		{
+			blip_long s = raw [i] >> sample_shift;
+			BLIP_CLAMP( s, s );
+			switch ( mode )
+			{
+			case blip_simd_mono: out [i] = (blip_sample_t) s; break;
+			case blip_simd_left: out [i * 2] = (blip_sample_t) s; break;
+			case blip_simd_both: out [i * 2] = out [i * 2 + 1] = (blip_sample_t) s; break;
+			}
+		}
+
+		in    += n;
+		out   += mode == blip_simd_mono ? n : n * 2;
+		count -= n;
+	}
+	*accum_ = accum;
+}
+
+BLIP_SIMD_TARGET
+void blip_simd_read_stereo( blip_sample_t* out, Blip_Buffer::buf_t_ const* left,
+		Blip_Buffer::buf_t_ const* right, Blip_Buffer::buf_t_ const* center,
+		blip_long accum [3], int bass, int count )
+{
+	// The three channels are integrated together, one per lane: four samples of
+	// each are transposed to four vectors of left, right, center and zero
+	shift_t const bass_shift = make_shift( bass );
+	shift_t const shift = make_shift( sample_shift );
+	vec_t acc = vset( accum [0], accum [1], accum [2], 0 );
+	int i = 0;
+	for ( ; i + 4 <= count; i += 4 )
+	{
+		vec_t in_0 = vload( left + i );
+		vec_t in_1 = vload( right + i );
+		vec_t in_2 = vload( center + i );
+		vec_t in_3 = vzero();
+		vtranspose( in_0, in_1, in_2, in_3 );
+
+		vec_t a_0 = acc; acc = vadd( vsub( acc, vsra( acc, bass_shift ) ), in_0 );
+		vec_t a_1 = acc; acc = vadd( vsub( acc, vsra( acc, bass_shift ) ), in_1 );
+		vec_t a_2 = acc; acc = vadd( vsub( acc, vsra( acc, bass_shift ) ), in_2 );
+		vec_t a_3 = acc; acc = vadd( vsub( acc, vsra( acc, bass_shift ) ), in_3 );
+		vtranspose( a_0, a_1, a_2, a_3 );
+
+		store_pairs( out + i * 2, vsra( vadd( a_2, a_0 ), shift ), vsra( vadd( a_2, a_1 ), shift ) );
+	}
+
+	blip_long a [4];
+	vstore( a, acc );
+	for ( ; i < count; i++ )
+	{
+		blip_long l = (a [2] + a [0]) >> sample_shift;
+		blip_long r = (a [2] + a [1]) >> sample_shift;
+		for ( int c = 0; c < 3; c++ )
+			a [c] -= a [c] >> bass;
+		a [0] += left   [i];
+		a [1] += right  [i];
+		a [2] += center [i];
+
+		BLIP_CLAMP( l, l );
+		BLIP_CLAMP( r, r );
+		out [i * 2    ] = (blip_sample_t) l;
+		out [i * 2 + 1] = (blip_sample_t) r;
+	}
+	accum [0] = a [0];
+	accum [1] = a [1];
+	accum [2] = a [2];
+}
+
+BLIP_SIMD_TARGET
+void blip_simd_mix_pairs( blip_long* out, Blip_Buffer::buf_t_ const* in, blip_long* accum_,
+		int bass, blip_long vol_0, blip_long vol_1, int count )
+{
+	shift_t const shift = make_shift( sample_shift );
+	vec_t const vol = vset( vol_0, vol_1, vol_0, vol_1 );
+	blip_long accum = *accum_;
+	blip_long raw [chunk_size];
+	while ( count )
+	{
+		int const n = count < chunk_size ? count : chunk_size;
+		integrate( in, accum, bass, raw, n );
+
+		int i = 0;
+		for ( ; i + 4 <= n; i += 4 )
+		{
+			vec_t s = vsra( vload( raw + i ), shift );
+			blip_long* pair = out + i * 2;
+			vstore( pair,     vadd( vload( pair     ), vmul( vdup_lo( s ), vol ) ) );
+			vstore( pair + 4, vadd( vload( pair + 4 ), vmul( vdup_hi( s ), vol ) ) );
+		}
+
+		for ( ; i < n; i++ )
+		{
+			blip_long s = raw [i] >> sample_shift;
+			out [i * 2    ] += s * vol_0;
+			out [i * 2 + 1] += s * vol_1;
+		}
+
+		in    += n;
+		out   += n * 2;
+		count -= n;
+	}
+	*accum_ = accum;
+}
+
+BLIP_SIMD_TARGET
+void blip_simd_clamp( blip_sample_t* out, blip_long const* in, int shift_, int count )
+{
+	shift_t const shift = make_shift( shift_ );
+	int i = 0;
+	for ( ; i + 8 <= count; i += 8 )
+		store_8( out + i, vsra( vload( in + i ), shift ), vsra( vload( in + i + 4 ), shift ) );
+
+	for ( ; i < count; i++ )
+	{
+		blip_long s = in [i] >> shift_;
+		BLIP_CLAMP( s, s );
+		out [i] = (blip_sample_t) s;
+	}
+}
+
+#endif
@@ -0,0 +1,51 @@
+// SIMD versions of the loops reading samples from Blip_Buffer
+
+#ifndef BLIP_SIMD_H
+#define BLIP_SIMD_H
+
+#include "core/apu/Blip_Buffer.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define BLIP_SIMD_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define BLIP_SIMD_NEON 1
+#endif
+
+#if defined(BLIP_SIMD_SSE2) || defined(BLIP_SIMD_NEON)
+#define BLIP_SIMD 1
+
+// True if the CPU supports the SIMD loops, checked at startup. They give
+// exactly the same samples as the scalar loops, which are used otherwise.
+extern bool blip_simd;
+
+// Where blip_simd_read_mono() writes the samples
+enum blip_simd_out_t {
+        blip_simd_mono, // out [i]
+        blip_simd_left, // out [i * 2], out [i * 2 + 1] is left as is
+        blip_simd_both  // out [i * 2] and out [i * 2 + 1]
+};
+
+// The functions below take the read position and accumulator of the
+// BLIP_READER macros, and update the accumulator as BLIP_READER_NEXT_IDX_()
+// does for every sample.
+
+// Reads count samples of in, clamped to 16 bits
+void blip_simd_read_mono(blip_sample_t *out, blip_simd_out_t, Blip_Buffer::buf_t_ const *in,
+                         blip_long *accum, int bass, int count);
+
+// Reads count stereo pairs, the sum of center with left and with right, clamped
+// to 16 bits. accum holds the accumulators of left, right and center.
+void blip_simd_read_stereo(blip_sample_t *out, Blip_Buffer::buf_t_ const *left,
+                           Blip_Buffer::buf_t_ const *right, Blip_Buffer::buf_t_ const *center,
+                           blip_long accum[3], int bass, int count);
+
+// Adds count samples of in, multiplied by vol_0 and by vol_1, to count pairs of out
+void blip_simd_mix_pairs(blip_long *out, Blip_Buffer::buf_t_ const *in, blip_long *accum,
+                         int bass, blip_long vol_0, blip_long vol_1, int count);
+
+// Writes count values of in, shifted right by shift and clamped to 16 bits
+void blip_simd_clamp(blip_sample_t *out, blip_long const *in, int shift, int count);
+
+#endif
+
+#endif
@@ -1,6 +1,7 @@
 // Game_Music_Emu $vers. http://www.slack.net/~ant/
 
 #include "core/apu/Effects_Buffer.h"
+#include "core/apu/Blip_Simd.h"
 
 #include <string.h>
 
@@ -510,16 +511,26 @@ void Effects_Buffer::mix_effects( blip_sample_t* out_, int pair_count )
 						BLIP_READER_ADJ_( in, count );
 
 						out += count;
-						int offset = -count;
-						do
+#ifdef BLIP_SIMD
+						if ( blip_simd )
 						{
-							fixed_t s = BLIP_READER_READ( in );
-							BLIP_READER_NEXT_IDX_( in, bass, offset );
-
-							out [offset] [0] += s * vol_0;
-							out [offset] [1] += s * vol_1;
+							blip_simd_mix_pairs( out [-count], in_reader_buf - count,
+									&in_reader_accum, bass, vol_0, vol_1, count );
+						}
+						else
+#endif
+						{
+							int offset = -count;
+							do
+							{
+								fixed_t s = BLIP_READER_READ( in );
+								BLIP_READER_NEXT_IDX_( in, bass, offset );
+
+								out [offset] [0] += s * vol_0;
+								out [offset] [1] += s * vol_1;
+							}
+							while ( ++offset );
 						}
-						while ( ++offset );
 
 						out = (stereo_fixed_t*) echo.begin();
 						count = remain;
@@ -602,19 +613,28 @@ void Effects_Buffer::mix_effects( blip_sample_t* out_, int pair_count )
 			remain -= count;
 			in  += count;
 			out += count;
-			int offset = -count;
-			do
+#ifdef BLIP_SIMD
+			if ( blip_simd )
+			{
+				blip_simd_clamp( out [-count], in [-count], fixed_shift, count * stereo );
+			}
+			else
+#endif
 			{
-				fixed_t in_0 = FROM_FIXED( in [offset] [0] );
-				fixed_t in_1 = FROM_FIXED( in [offset] [1] );
+				int offset = -count;
+				do
+				{
+					fixed_t in_0 = FROM_FIXED( in [offset] [0] );
+					fixed_t in_1 = FROM_FIXED( in [offset] [1] );
 
-				BLIP_CLAMP( in_0, in_0 );
-				out [offset] [0] = (blip_sample_t) in_0;
+					BLIP_CLAMP( in_0, in_0 );
+					out [offset] [0] = (blip_sample_t) in_0;
 
-				BLIP_CLAMP( in_1, in_1 );
-				out [offset] [1] = (blip_sample_t) in_1;
+					BLIP_CLAMP( in_1, in_1 );
+					out [offset] [1] = (blip_sample_t) in_1;
+				}
+				while ( ++offset );
 			}
-			while ( ++offset );
 
 			in = (stereo_fixed_t*) echo.begin();
 			count = remain;
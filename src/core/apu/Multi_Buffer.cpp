@@ -1,6 +1,7 @@
 // Blip_Buffer 0.4.1. http://www.slack.net/~ant/
 
 #include "core/apu/Multi_Buffer.h"
+#include "core/apu/Blip_Simd.h"
 
 /* Copyright (C) 2003-2007 Shay Green. This module is free software; you
 can redistribute it and/or modify it under the terms of the GNU Lesser
@@ -216,6 +217,16 @@ void Stereo_Mixer::read_pairs( blip_sample_t* out, int count )
 
 void Stereo_Mixer::mix_mono( blip_sample_t* out_, int count )
 {
+#ifdef BLIP_SIMD
+	if ( blip_simd )
+	{
+		// read_pairs() already added count to samples_read
+		blip_simd_read_mono( out_, blip_simd_both, bufs [2]->buffer_ + samples_read - count,
+				&bufs [2]->reader_accum_, BLIP_READER_BASS( *bufs [2] ), count );
+		return;
+	}
+#endif
+
 	int const bass = BLIP_READER_BASS( *bufs [2] );
 	BLIP_READER_BEGIN( center, *bufs [2] );
 	BLIP_READER_ADJ_( center, samples_read );
@@ -239,6 +250,20 @@ void Stereo_Mixer::mix_mono( blip_sample_t* out_, int count )
 
 void Stereo_Mixer::mix_stereo( blip_sample_t* out_, int count )
 {
+#ifdef BLIP_SIMD
+	if ( blip_simd )
+	{
+		// read_pairs() already added count to samples_read
+		long const start = samples_read - count;
+		blip_long accum [3] = { bufs [0]->reader_accum_, bufs [1]->reader_accum_, bufs [2]->reader_accum_ };
+		blip_simd_read_stereo( out_, bufs [0]->buffer_ + start, bufs [1]->buffer_ + start,
+				bufs [2]->buffer_ + start, accum, BLIP_READER_BASS( *bufs [2] ), count );
+		for ( int i = 0; i < 3; i++ )
+			bufs [i]->reader_accum_ = accum [i];
+		return;
+	}
+#endif
+
 	blip_sample_t* BLIP_RESTRICT out = out_ + count * stereo;
 
 	// do left + center and right + center separately to reduce register load
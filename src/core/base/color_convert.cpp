@@ -0,0 +1,252 @@
+#include "core/base/color_convert.h"
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VBAM_COLOR_CONVERT_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define VBAM_COLOR_CONVERT_NEON
+#include <arm_neon.h>
+#endif
+
+#include "core/base/system.h"
+
+namespace {
+
+ColorConvertMode g_mode = ColorConvertMode::kColorMap;
+
+template <typename T>
+inline uint32_t ShiftPixel(T pixel) {
+    return ((pixel & 0x1f) << systemRedShift) |
+           (((pixel >> 5) & 0x1f) << systemGreenShift) |
+           (((pixel >> 10) & 0x1f) << systemBlueShift);
+}
+
+// The SIMD kernels below convert as many pixels as they can in full vectors
+// and return that count. The caller converts the remaining pixels.
+
+#if defined(VBAM_COLOR_CONVERT_SSE2)
+
+inline __m128i ShiftVector32(__m128i pixels) {
+    const __m128i mask = _mm_set1_epi32(0x1f);
+    const __m128i r = _mm_sll_epi32(_mm_and_si128(pixels, mask),
+                                    _mm_cvtsi32_si128(systemRedShift));
+    const __m128i g = _mm_sll_epi32(_mm_and_si128(_mm_srli_epi32(pixels, 5), mask),
+                                    _mm_cvtsi32_si128(systemGreenShift));
+    const __m128i b = _mm_sll_epi32(_mm_and_si128(_mm_srli_epi32(pixels, 10), mask),
+                                    _mm_cvtsi32_si128(systemBlueShift));
+    return _mm_or_si128(r, _mm_or_si128(g, b));
+}
+
+inline __m128i ShiftVector16(__m128i pixels) {
+    const __m128i mask = _mm_set1_epi16(0x1f);
+    const __m128i r = _mm_sll_epi16(_mm_and_si128(pixels, mask),
+                                    _mm_cvtsi32_si128(systemRedShift));
+    const __m128i g = _mm_sll_epi16(_mm_and_si128(_mm_srli_epi16(pixels, 5), mask),
+                                    _mm_cvtsi32_si128(systemGreenShift));
+    const __m128i b = _mm_sll_epi16(_mm_and_si128(_mm_srli_epi16(pixels, 10), mask),
+                                    _mm_cvtsi32_si128(systemBlueShift));
+    return _mm_or_si128(r, _mm_or_si128(g, b));
+}
+
+// Loads 8 source pixels as 16-bit lanes.
+inline __m128i Load8(const uint32_t* src) {
+    const __m128i mask = _mm_set1_epi32(0x7fff);
+    const __m128i lo = _mm_and_si128(_mm_loadu_si128((const __m128i*)src), mask);
+    const __m128i hi = _mm_and_si128(_mm_loadu_si128((const __m128i*)(src + 4)), mask);
+    return _mm_packs_epi32(lo, hi);
+}
+
+inline __m128i Load8(const uint16_t* src) {
+    return _mm_loadu_si128((const __m128i*)src);
+}
+
+template <typename T>
+size_t ShiftLine16Simd(const T* src, uint16_t* dest, size_t count) {
+    const size_t end = count & ~size_t(7);
+    size_t x = 0;
+    for (; x < end; x += 8) {
+        _mm_storeu_si128((__m128i*)(dest + x), ShiftVector16(Load8(src + x)));
+    }
+    return x;
+}
+
+template <typename T>
+size_t ShiftLine32Simd(const T* src, uint32_t* dest, size_t count) {
+    const __m128i zero = _mm_setzero_si128();
+    const size_t end = count & ~size_t(7);
+    size_t x = 0;
+    for (; x < end; x += 8) {
+        const __m128i pixels = Load8(src + x);
+        _mm_storeu_si128((__m128i*)(dest + x),
+                         ShiftVector32(_mm_unpacklo_epi16(pixels, zero)));
+        _mm_storeu_si128((__m128i*)(dest + x + 4),
+                         ShiftVector32(_mm_unpackhi_epi16(pixels, zero)));
+    }
+    return x;
+}
+
+#elif defined(VBAM_COLOR_CONVERT_NEON)
+
+inline uint32x4_t ShiftVector32(uint32x4_t pixels) {
+    const uint32x4_t mask = vdupq_n_u32(0x1f);
+    const uint32x4_t r = vshlq_u32(vandq_u32(pixels, mask), vdupq_n_s32(systemRedShift));
+    const uint32x4_t g =
+        vshlq_u32(vandq_u32(vshrq_n_u32(pixels, 5), mask), vdupq_n_s32(systemGreenShift));
+    const uint32x4_t b =
+        vshlq_u32(vandq_u32(vshrq_n_u32(pixels, 10), mask), vdupq_n_s32(systemBlueShift));
+    return vorrq_u32(r, vorrq_u32(g, b));
+}
+
+inline uint16x8_t ShiftVector16(uint16x8_t pixels) {
+    const uint16x8_t mask = vdupq_n_u16(0x1f);
+    const uint16x8_t r = vshlq_u16(vandq_u16(pixels, mask), vdupq_n_s16(systemRedShift));
+    const uint16x8_t g =
+        vshlq_u16(vandq_u16(vshrq_n_u16(pixels, 5), mask), vdupq_n_s16(systemGreenShift));
+    const uint16x8_t b =
+        vshlq_u16(vandq_u16(vshrq_n_u16(pixels, 10), mask), vdupq_n_s16(systemBlueShift));
+    return vorrq_u16(r, vorrq_u16(g, b));
+}
+
+// Loads 8 source pixels as 16-bit lanes.
+inline uint16x8_t Load8(const uint32_t* src) {
+    return vcombine_u16(vmovn_u32(vld1q_u32(src)), vmovn_u32(vld1q_u32(src + 4)));
+}
+
+inline uint16x8_t Load8(const uint16_t* src) {
+    return vld1q_u16(src);
+}
+
+template <typename T>
+size_t ShiftLine16Simd(const T* src, uint16_t* dest, size_t count) {
+    const size_t end = count & ~size_t(7);
+    size_t x = 0;
+    for (; x < end; x += 8) {
+        vst1q_u16(dest + x, ShiftVector16(Load8(src + x)));
+    }
+    return x;
+}
+
+template <typename T>
+size_t ShiftLine32Simd(const T* src, uint32_t* dest, size_t count) {
+    const uint16x8_t mask = vdupq_n_u16(0x7fff);
+    const size_t end = count & ~size_t(7);
+    size_t x = 0;
+    for (; x < end; x += 8) {
+        const uint16x8_t pixels = vandq_u16(Load8(src + x), mask);
+        vst1q_u32(dest + x, ShiftVector32(vmovl_u16(vget_low_u16(pixels))));
+        vst1q_u32(dest + x + 4, ShiftVector32(vmovl_u16(vget_high_u16(pixels))));
+    }
+    return x;
+}
+
+#else
+
+template <typename T>
+size_t ShiftLine16Simd(const T*, uint16_t*, size_t) {
+    return 0;
+}
+
+template <typename T>
+size_t ShiftLine32Simd(const T*, uint32_t*, size_t) {
+    return 0;
+}
+
+#endif
+
+template <typename T>
+void ConvertLine16(const T* src, uint16_t* dest, size_t count) {
+    switch (g_mode) {
+        case ColorConvertMode::kColorMap:
+            for (size_t x = 0; x < count; x++) {
+                dest[x] = systemColorMap16[src[x] & 0xffff];
+            }
+            break;
+        case ColorConvertMode::kShift:
+            for (size_t x = ShiftLine16Simd(src, dest, count); x < count; x++) {
+                dest[x] = static_cast<uint16_t>(ShiftPixel(src[x]));
+            }
+            break;
+        case ColorConvertMode::kRaw:
+            for (size_t x = 0; x < count; x++) {
+                dest[x] = src[x] & 0x7fff;
+            }
+            break;
+    }
+}
+
+template <typename T>
+void ConvertLine24(const T* src, uint8_t* dest, size_t count) {
+    for (size_t x = 0; x < count; x++) {
+        uint32_t color = 0;
+        switch (g_mode) {
+            case ColorConvertMode::kColorMap:
+                color = systemColorMap32[src[x] & 0xffff];
+                break;
+            case ColorConvertMode::kShift:
+                color = ShiftPixel(src[x]);
+                break;
+            case ColorConvertMode::kRaw:
+                color = src[x] & 0x7fff;
+                break;
+        }
+        // A 24-bit pixel is made of the first 3 bytes of the 32-bit color.
+        memcpy(dest + x * 3, &color, 3);
+    }
+}
+
+template <typename T>
+void ConvertLine32(const T* src, uint32_t* dest, size_t count) {
+    switch (g_mode) {
+        case ColorConvertMode::kColorMap:
+            for (size_t x = 0; x < count; x++) {
+                dest[x] = systemColorMap32[src[x] & 0xffff];
+            }
+            break;
+        case ColorConvertMode::kShift:
+            for (size_t x = ShiftLine32Simd(src, dest, count); x < count; x++) {
+                dest[x] = ShiftPixel(src[x]);
+            }
+            break;
+        case ColorConvertMode::kRaw:
+            for (size_t x = 0; x < count; x++) {
+                dest[x] = src[x] & 0x7fff;
+            }
+            break;
+    }
+}
+
+}  // namespace
+
+void colorConvertSetMode(ColorConvertMode mode) {
+    g_mode = mode;
+}
+
+ColorConvertMode colorConvertGetMode() {
+    return g_mode;
+}
+
+void colorConvertLine16(const uint32_t* src, uint16_t* dest, size_t count) {
+    ConvertLine16(src, dest, count);
+}
+
+void colorConvertLine16(const uint16_t* src, uint16_t* dest, size_t count) {
+    ConvertLine16(src, dest, count);
+}
+
+void colorConvertLine24(const uint32_t* src, uint8_t* dest, size_t count) {
+    ConvertLine24(src, dest, count);
+}
+
+void colorConvertLine24(const uint16_t* src, uint8_t* dest, size_t count) {
+    ConvertLine24(src, dest, count);
+}
+
+void colorConvertLine32(const uint32_t* src, uint32_t* dest, size_t count) {
+    ConvertLine32(src, dest, count);
+}
+
+void colorConvertLine32(const uint16_t* src, uint32_t* dest, size_t count) {
+    ConvertLine32(src, dest, count);
+}
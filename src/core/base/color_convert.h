@@ -0,0 +1,35 @@
+#ifndef VBAM_CORE_BASE_COLOR_CONVERT_H_
+#define VBAM_CORE_BASE_COLOR_CONVERT_H_
+
+#include <cstddef>
+#include <cstdint>
+
+// Scanline conversion from the emulated BGR555 colors to the frontend pixel
+// format described by systemColorDepth and the system*Shift values.
+//
+// Only the low 16 bits of each source pixel are used, the GBA renderer keeps
+// layer flags in the upper bits of g_lineMix.
+
+enum class ColorConvertMode {
+    // Look up every pixel in systemColorMap16/systemColorMap32. This is the
+    // default, as frontends may apply color correction to the maps.
+    kColorMap,
+    // Compute every pixel from the system*Shift values. Only valid when the
+    // color maps are the plain, uncorrected ones.
+    kShift,
+    // Store the BGR555 value as-is, for headless users of the frame buffer.
+    kRaw,
+};
+
+void colorConvertSetMode(ColorConvertMode mode);
+ColorConvertMode colorConvertGetMode();
+
+void colorConvertLine16(const uint32_t* src, uint16_t* dest, size_t count);
+void colorConvertLine16(const uint16_t* src, uint16_t* dest, size_t count);
+// Writes 3 bytes per pixel.
+void colorConvertLine24(const uint32_t* src, uint8_t* dest, size_t count);
+void colorConvertLine24(const uint16_t* src, uint8_t* dest, size_t count);
+void colorConvertLine32(const uint32_t* src, uint32_t* dest, size_t count);
+void colorConvertLine32(const uint16_t* src, uint32_t* dest, size_t count);
+
+#endif  // VBAM_CORE_BASE_COLOR_CONVERT_H_
@@ -1,6 +1,7 @@
 #ifndef VBAM_CORE_BASE_FILE_UTIL_H_
 #define VBAM_CORE_BASE_FILE_UTIL_H_
 
+#include <cstddef>
 #include <cstdio>
 #include <cstdint>
 
@@ -23,11 +24,16 @@ typedef struct {
 void utilPutDword(uint8_t *, uint32_t);
 FILE* utilOpenFile(const char *filename, const char *mode);
 uint8_t *utilLoad(const char *, bool (*)(const char *), uint8_t *, int &);
+// Frees an image returned by utilLoad() or utilMapImage().
+void utilFreeImage(uint8_t *image);
+// Resizes an image returned by utilLoad() or utilMapImage(), like realloc().
+uint8_t *utilReallocImage(uint8_t *image, size_t size);
 IMAGE_TYPE utilFindType(const char *);
 bool utilIsGBAImage(const char *);
 bool utilIsGBImage(const char *);
 
-#if defined(__LIBRETRO__)
+// Raw in-memory states, the data is copied as is.
+unsigned utilDataSize(variable_desc *);
 
 void utilWriteIntMem(uint8_t *&data, int);
 void utilWriteMem(uint8_t *&data, const void *in_data, unsigned size);
@@ -37,13 +43,33 @@ int utilReadIntMem(const uint8_t *&data);
 void utilReadMem(void *buf, const uint8_t *&data, unsigned size);
 void utilReadDataMem(const uint8_t *&data, variable_desc *);
 
-#else  // !defined(__LIBRETRO__)
+#if !defined(__LIBRETRO__)
 
 // strip .gz or .z off end
 void utilStripDoubleExtension(const char *, char *);
 
+// Maps a plain, uncompressed image file, private and copy-on-write, at the
+// start of a zero-filled buffer of `buffer_size` bytes, or of the file size
+// rounded up to a power of 2 if 0. The pages of the file are shared with the
+// page cache until written to. Sets `size` to the file size. Returns nullptr
+// for the archives, when the file can not be mapped or when the mapping is not
+// enabled, utilLoad() must be used instead.
+uint8_t *utilMapImage(const char *file, bool (*accept)(const char *), size_t buffer_size,
+                      int &size);
+// Enables utilMapImage(), off by default. A mapped image file must not be
+// truncated or rewritten while in use, the emulator would crash with SIGBUS
+// on the next read of the missing pages. Only for the tools that run many
+// instances of the same games, such as vbam-batch.
+void utilSetMapImages(bool enable);
+
 gzFile utilAutoGzOpen(const char *file, const char *mode);
 gzFile utilGzOpen(const char *file, const char *mode);
+// Opens `file` for writing. The data is kept in memory, then compressed and
+// written on a background thread once closed. Opening a file for reading with
+// utilGzOpen() waits for these writes, and so does opening the same file again.
+// The writes that failed are reported with systemMessage() by the next
+// utilGzOpen() or utilGzOpenAsync() call.
+gzFile utilGzOpenAsync(const char *file);
 gzFile utilMemGzOpen(char *memory, int available, const char *mode);
 int utilGzWrite(gzFile file, const voidp buffer, unsigned int len);
 int utilGzRead(gzFile file, voidp buffer, unsigned int len);
@@ -56,6 +82,6 @@ void utilReadDataSkip(gzFile, variable_desc *);
 int utilReadInt(gzFile);
 void utilWriteInt(gzFile, int);
 
-#endif  // defined(__LIBRETRO__)
+#endif  // !defined(__LIBRETRO__)
 
 #endif  // VBAM_CORE_BASE_FILE_UTIL_H_
\ No newline at end of file
@@ -4,10 +4,23 @@
 #error "This file is only for non-libretro builds"
 #endif
 
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif  // !defined(_WIN32)
 
 #include "core/base/internal/file_util_internal.h"
+#include "core/base/internal/gz_writer.h"
 #include "core/base/internal/memgzio.h"
 #include "core/base/message.h"
 #include "core/fex/fex.h"
@@ -85,6 +98,33 @@ int utilGetSize(int size) {
     return res;
 }
 
+// Set with utilSetMapImages().
+bool mapImages = false;
+
+// The images mapped with utilMapImage(), with the size of their mapping.
+std::mutex mappedImagesMutex;
+std::unordered_map<uint8_t*, size_t> mappedImages;
+
+// Returns the size of the mapping if `image` was mapped, 0 otherwise.
+size_t utilMappedImageSize(uint8_t* image) {
+    std::lock_guard<std::mutex> lock(mappedImagesMutex);
+    auto it = mappedImages.find(image);
+    return it == mappedImages.end() ? 0 : it->second;
+}
+
+void utilUnmapImage(uint8_t* image) {
+#if !defined(_WIN32)
+    size_t size;
+    {
+        std::lock_guard<std::mutex> lock(mappedImagesMutex);
+        auto it = mappedImages.find(image);
+        size = it->second;
+        mappedImages.erase(it);
+    }
+    munmap(image, size);
+#endif  // !defined(_WIN32)
+}
+
 IMAGE_TYPE utilFindType(const char* file, char (&buffer)[2048]) {
     fex_t* fe = scanArchive(file, utilIsImage, buffer);
     if (!fe) {
@@ -101,6 +141,47 @@ int(ZEXPORT* utilGzReadFunc)(gzFile, voidp, unsigned int) = nullptr;
 int(ZEXPORT* utilGzCloseFunc)(gzFile) = nullptr;
 z_off_t(ZEXPORT* utilGzSeekFunc)(gzFile, z_off_t, int) = nullptr;
 
+// A file opened with utilGzOpenAsync(), the data is buffered until closed.
+struct AsyncGzFile {
+    FILE* file;
+    std::string name;
+    std::vector<uint8_t> data;
+};
+
+// Size of the last file written with utilGzOpenAsync(), to size the buffer.
+size_t asyncGzLastSize = 0;
+
+int ZEXPORT asyncGzWrite(gzFile file, const voidp buffer, unsigned int len) {
+    AsyncGzFile* async = reinterpret_cast<AsyncGzFile*>(file);
+    const uint8_t* bytes = static_cast<const uint8_t*>(buffer);
+    async->data.insert(async->data.end(), bytes, bytes + len);
+    return len;
+}
+
+int ZEXPORT asyncGzRead(gzFile, voidp, unsigned int) {
+    return -1;
+}
+
+int ZEXPORT asyncGzClose(gzFile file) {
+    AsyncGzFile* async = reinterpret_cast<AsyncGzFile*>(file);
+    asyncGzLastSize = async->data.size();
+    core::internal::GzWriteInBackground(async->file, std::move(async->name),
+                                        std::move(async->data));
+    delete async;
+    return Z_OK;
+}
+
+z_off_t ZEXPORT asyncGzSeek(gzFile, z_off_t, int) {
+    return -1;
+}
+
+// Reports the background writes that failed, on the calling thread.
+void reportFailedAsyncGzWrites() {
+    for (const std::string& name : core::internal::GzTakeFailedBackgroundWrites()) {
+        systemMessage(MSG_ERROR_CREATING_FILE, N_("Error writing file %s"), name.c_str());
+    }
+}
+
 }  // namespace
 
 uint8_t* utilLoad(const char* file, bool (*accept)(const char*), uint8_t* data, int& size) {
@@ -148,6 +229,92 @@ uint8_t* utilLoad(const char* file, bool (*accept)(const char*), uint8_t* data,
     return image;
 }
 
+uint8_t* utilMapImage(const char* file, bool (*accept)(const char*), size_t buffer_size, int& size) {
+#if defined(_WIN32)
+    // A file view can not be placed in a larger buffer without the
+    // placeholder APIs, the images are loaded in memory instead.
+    (void)file;
+    (void)accept;
+    (void)buffer_size;
+    (void)size;
+    return nullptr;
+#else   // !defined(_WIN32)
+    if (!mapImages)
+        return nullptr;
+
+    // Only the plain files are mapped, fex reads the archives.
+    fex_type_t type;
+    if (fex_identify_file(&type, file) || !type || *fex_type_extension(type) != '\0')
+        return nullptr;
+
+    if (!accept(file))
+        return nullptr;
+
+    const int fd = open(file, O_RDONLY);
+    if (fd < 0)
+        return nullptr;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0 || st.st_size > MAX_CART_SIZE) {
+        close(fd);
+        return nullptr;
+    }
+
+    const int fileSize = (int)st.st_size;
+    if (buffer_size == 0)
+        buffer_size = utilGetSize(fileSize);
+    const size_t mapSize = std::min((size_t)fileSize, buffer_size);
+
+    // The file is mapped over the start of an anonymous mapping, the bytes
+    // after the end of the file read as 0, like the rest of the buffer.
+    void* buffer = mmap(nullptr, buffer_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+    if (buffer == MAP_FAILED) {
+        close(fd);
+        return nullptr;
+    }
+    if (mmap(buffer, mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(buffer, buffer_size);
+        close(fd);
+        return nullptr;
+    }
+    close(fd);
+
+    uint8_t* image = static_cast<uint8_t*>(buffer);
+    {
+        std::lock_guard<std::mutex> lock(mappedImagesMutex);
+        mappedImages[image] = buffer_size;
+    }
+
+    size = fileSize;
+    return image;
+#endif  // defined(_WIN32)
+}
+
+void utilSetMapImages(bool enable) {
+    mapImages = enable;
+}
+
+void utilFreeImage(uint8_t* image) {
+    if (utilMappedImageSize(image) != 0)
+        utilUnmapImage(image);
+    else
+        free(image);
+}
+
+uint8_t* utilReallocImage(uint8_t* image, size_t size) {
+    const size_t mappedSize = utilMappedImageSize(image);
+    if (mappedSize == 0)
+        return (uint8_t*)realloc(image, size);
+
+    // The mapping can not be resized, it is copied to the heap.
+    uint8_t* copy = (uint8_t*)malloc(size);
+    if (copy == nullptr)
+        return nullptr;
+    memcpy(copy, image, std::min(size, mappedSize));
+    utilUnmapImage(image);
+    return copy;
+}
+
 IMAGE_TYPE utilFindType(const char* file) {
     char buffer[2048];
     return utilFindType(file, buffer);
@@ -183,6 +350,11 @@ gzFile utilAutoGzOpen(const char* file, const char* mode) {
 }
 
 gzFile utilGzOpen(const char* file, const char* mode) {
+    // The file may still be written in the background.
+    if (mode[0] == 'r')
+        core::internal::GzWaitForBackgroundWrites();
+    reportFailedAsyncGzWrites();
+
     utilGzWriteFunc = (int(ZEXPORT*)(gzFile, void* const, unsigned int))gzwrite;
     utilGzReadFunc = gzread;
     utilGzCloseFunc = gzclose;
@@ -191,6 +363,25 @@ gzFile utilGzOpen(const char* file, const char* mode) {
     return utilAutoGzOpen(file, mode);
 }
 
+gzFile utilGzOpenAsync(const char* file) {
+    // Do not truncate the file while an earlier save is written to it.
+    core::internal::GzWaitForBackgroundWrites(file);
+    reportFailedAsyncGzWrites();
+
+    FILE* fp = utilOpenFile(file, "wb");
+    if (fp == nullptr)
+        return nullptr;
+
+    utilGzWriteFunc = asyncGzWrite;
+    utilGzReadFunc = asyncGzRead;
+    utilGzCloseFunc = asyncGzClose;
+    utilGzSeekFunc = asyncGzSeek;
+
+    AsyncGzFile* async = new AsyncGzFile{fp, file, {}};
+    async->data.reserve(asyncGzLastSize);
+    return reinterpret_cast<gzFile>(async);
+}
+
 gzFile utilMemGzOpen(char* memory, int available, const char* mode) {
     utilGzWriteFunc = memgzwrite;
     utilGzReadFunc = memgzread;
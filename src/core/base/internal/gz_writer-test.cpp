@@ -0,0 +1,125 @@
+#include "core/base/internal/gz_writer.h"
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include <zlib.h>
+
+#include "core/base/file_util.h"
+
+namespace core {
+namespace internal {
+
+namespace {
+
+std::vector<uint8_t> TestData(size_t size, int seed) {
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i < data.size(); i++) {
+        data[i] = static_cast<uint8_t>(i * seed + (i >> 9));
+    }
+    return data;
+}
+
+// Data that does not compress, slow to write.
+std::vector<uint8_t> RandomData(size_t size) {
+    std::mt19937 rng(42);
+    std::vector<uint8_t> data(size);
+    for (uint8_t& byte : data) {
+        byte = static_cast<uint8_t>(rng());
+    }
+    return data;
+}
+
+// Decompresses the file `name`, which must hold exactly one gzip stream.
+std::vector<uint8_t> ReadGz(const std::string& name) {
+    std::vector<uint8_t> compressed;
+    FILE* file = fopen(name.c_str(), "rb");
+    if (file == nullptr) {
+        return {};
+    }
+    uint8_t chunk[4096];
+    size_t count;
+    while ((count = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        compressed.insert(compressed.end(), chunk, chunk + count);
+    }
+    fclose(file);
+
+    z_stream stream = {};
+    if (inflateInit2(&stream, MAX_WBITS + 16) != Z_OK) {
+        return {};
+    }
+    stream.next_in = compressed.data();
+    stream.avail_in = static_cast<uInt>(compressed.size());
+    std::vector<uint8_t> data;
+    int result = Z_OK;
+    while (result == Z_OK) {
+        stream.next_out = chunk;
+        stream.avail_out = sizeof(chunk);
+        result = inflate(&stream, Z_NO_FLUSH);
+        data.insert(data.end(), chunk, chunk + sizeof(chunk) - stream.avail_out);
+    }
+    inflateEnd(&stream);
+
+    if (result != Z_STREAM_END || stream.avail_in != 0) {
+        return {};
+    }
+    return data;
+}
+
+}  // namespace
+
+TEST(GzWriterTest, WritesTheCompressedData) {
+    const std::vector<uint8_t> data = TestData(200000, 7);
+    const std::string name = ::testing::TempDir() + "gz_writer_test.gz";
+    FILE* file = fopen(name.c_str(), "wb");
+    ASSERT_NE(file, nullptr);
+
+    GzWriteInBackground(file, name, data);
+    GzWaitForBackgroundWrites();
+    EXPECT_TRUE(GzTakeFailedBackgroundWrites().empty());
+
+    EXPECT_EQ(ReadGz(name), data);
+    remove(name.c_str());
+}
+
+TEST(GzWriterTest, SavesTwiceToTheSameFile) {
+    // The second save is smaller, it would be followed by the end of the first
+    // one if the file were truncated while the first one is written.
+    const std::vector<uint8_t> first = RandomData(8000000);
+    const std::vector<uint8_t> second = TestData(100000, 13);
+    const std::string name = ::testing::TempDir() + "gz_writer_twice_test.gz";
+
+    for (const std::vector<uint8_t>* data : {&first, &second}) {
+        gzFile gz = utilGzOpenAsync(name.c_str());
+        ASSERT_NE(gz, nullptr);
+        ASSERT_EQ(utilGzWrite(gz, const_cast<uint8_t*>(data->data()),
+                              static_cast<unsigned>(data->size())),
+                  static_cast<int>(data->size()));
+        ASSERT_EQ(utilGzClose(gz), 0);
+    }
+    GzWaitForBackgroundWrites();
+    EXPECT_TRUE(GzTakeFailedBackgroundWrites().empty());
+
+    EXPECT_EQ(ReadGz(name), second);
+    remove(name.c_str());
+}
+
+#if defined(__linux__)
+TEST(GzWriterTest, ReportsTheFailedWrites) {
+    // Writing to /dev/full always fails with ENOSPC.
+    FILE* file = fopen("/dev/full", "wb");
+    ASSERT_NE(file, nullptr);
+
+    GzWriteInBackground(file, "full", std::vector<uint8_t>(100000, 1));
+    GzWaitForBackgroundWrites();
+
+    EXPECT_EQ(GzTakeFailedBackgroundWrites(), std::vector<std::string>{"full"});
+    EXPECT_TRUE(GzTakeFailedBackgroundWrites().empty());
+}
+#endif  // defined(__linux__)
+
+}  // namespace internal
+}  // namespace core
@@ -0,0 +1,163 @@
+#include "core/base/internal/gz_writer.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include <zlib.h>
+
+namespace core {
+namespace internal {
+
+namespace {
+
+constexpr size_t kChunkSize = 1 << 16;
+
+struct GzWrite {
+    FILE* file;
+    std::string name;
+    std::vector<uint8_t> data;
+};
+
+bool Compress(const GzWrite& write) {
+    z_stream stream = {};
+    // 16 is added to the window bits to get a gzip header and trailer.
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, MAX_WBITS + 16, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+
+    uint8_t chunk[kChunkSize];
+    stream.next_in = const_cast<Bytef*>(write.data.data());
+    stream.avail_in = static_cast<uInt>(write.data.size());
+
+    int result = Z_OK;
+    while (result == Z_OK) {
+        stream.next_out = chunk;
+        stream.avail_out = kChunkSize;
+        result = deflate(&stream, Z_FINISH);
+        const size_t size = kChunkSize - stream.avail_out;
+        if (fwrite(chunk, 1, size, write.file) != size) {
+            result = Z_ERRNO;
+        }
+    }
+    deflateEnd(&stream);
+
+    return result == Z_STREAM_END;
+}
+
+// The thread is started on the first write, and stopped at exit once all the
+// queued files are written.
+class GzWriter {
+public:
+    ~GzWriter() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        work_.notify_one();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+    void Queue(GzWrite write) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!thread_.joinable()) {
+            thread_ = std::thread(&GzWriter::Run, this);
+        }
+        writes_.push_back(std::move(write));
+        work_.notify_one();
+    }
+
+    void Wait() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this] { return writes_.empty() && !busy_; });
+    }
+
+    void Wait(const std::string& name) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this, &name] {
+            return !(busy_ && busy_name_ == name) &&
+                   std::none_of(writes_.begin(), writes_.end(),
+                                [&name](const GzWrite& write) { return write.name == name; });
+        });
+    }
+
+    std::vector<std::string> TakeFailed() {
+        std::vector<std::string> failed;
+        std::lock_guard<std::mutex> lock(mutex_);
+        failed.swap(failed_);
+        return failed;
+    }
+
+private:
+    void Run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            work_.wait(lock, [this] { return stopping_ || !writes_.empty(); });
+            if (writes_.empty()) {
+                return;
+            }
+
+            GzWrite write = std::move(writes_.front());
+            writes_.pop_front();
+            busy_ = true;
+            busy_name_ = write.name;
+            lock.unlock();
+
+            bool written = Compress(write);
+            written = fclose(write.file) == 0 && written;
+
+            lock.lock();
+            if (!written) {
+                failed_.push_back(std::move(write.name));
+            }
+            busy_ = false;
+            done_.notify_all();
+        }
+    }
+
+    std::thread thread_;
+    std::mutex mutex_;
+    // Signaled when a write is queued or the writer stops.
+    std::condition_variable work_;
+    // Signaled when a write is done.
+    std::condition_variable done_;
+
+    // Guarded by mutex_.
+    std::deque<GzWrite> writes_;
+    std::vector<std::string> failed_;
+    bool busy_ = false;
+    // The name of the file being written, when busy_.
+    std::string busy_name_;
+    bool stopping_ = false;
+};
+
+GzWriter& Writer() {
+    static GzWriter writer;
+    return writer;
+}
+
+}  // namespace
+
+void GzWriteInBackground(FILE* file, std::string name, std::vector<uint8_t> data) {
+    Writer().Queue({file, std::move(name), std::move(data)});
+}
+
+void GzWaitForBackgroundWrites() {
+    Writer().Wait();
+}
+
+void GzWaitForBackgroundWrites(const std::string& name) {
+    Writer().Wait(name);
+}
+
+std::vector<std::string> GzTakeFailedBackgroundWrites() {
+    return Writer().TakeFailed();
+}
+
+}  // namespace internal
+}  // namespace core
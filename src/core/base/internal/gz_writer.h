@@ -0,0 +1,35 @@
+#ifndef VBAM_CORE_BASE_INTERNAL_GZ_WRITER_H_
+#define VBAM_CORE_BASE_INTERNAL_GZ_WRITER_H_
+
+#if defined(__LIBRETRO__)
+#error "This file is only for non-libretro builds"
+#endif
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace core {
+namespace internal {
+
+// Compresses `data` with gzip and writes it to `file` on a background thread.
+// `file` is closed once written, `name` is only used to report errors.
+void GzWriteInBackground(FILE* file, std::string name, std::vector<uint8_t> data);
+
+// Waits for all the background writes to be done.
+void GzWaitForBackgroundWrites();
+
+// Waits for the background writes of the file `name` to be done, before it is
+// opened again.
+void GzWaitForBackgroundWrites(const std::string& name);
+
+// Returns the names of the files that failed to be written since the last
+// call. The background thread never reports the errors itself, this is left to
+// the emulation thread.
+std::vector<std::string> GzTakeFailedBackgroundWrites();
+
+}  // namespace internal
+}  // namespace core
+
+#endif  // VBAM_CORE_BASE_INTERNAL_GZ_WRITER_H_
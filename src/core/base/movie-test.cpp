@@ -0,0 +1,284 @@
+#include "core/base/movie.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "core/base/run_ahead.h"
+#include "core/base/system.h"
+
+namespace {
+
+// A fake core: its state is the number of frames emulated and a hash of the
+// input of every frame, read from `g_movie`.
+struct FakeState {
+    uint32_t frames;
+    uint32_t hash;
+};
+
+FakeState g_fake;
+const Movie* g_movie = nullptr;
+int g_restores = 0;
+
+void FakeMain(int) {
+    const MovieInput& input = g_movie->input();
+    g_fake.frames++;
+    g_fake.hash = g_fake.hash * 31 + input.joypad;
+    g_fake.hash = g_fake.hash * 31 + (uint32_t)input.sensor_x;
+    g_fake.hash = g_fake.hash * 31 + input.darkness;
+    RunAhead::ReportFrame();
+}
+
+bool FakeReadState(const char*) {
+    g_fake = FakeState();
+    return true;
+}
+
+bool FakeReadMemState(char* data, int size) {
+    if (size != (int)sizeof(g_fake))
+        return false;
+    memcpy(&g_fake, data, sizeof(g_fake));
+    g_restores++;
+    return true;
+}
+
+bool FakeWriteMemState(char* data, int available, long& size) {
+    size = sizeof(g_fake);
+    if (available < size)
+        return false;
+    memcpy(data, &g_fake, sizeof(g_fake));
+    return true;
+}
+
+EmulatedSystem FakeSystem() {
+    EmulatedSystem system = {};
+    system.emuMain = FakeMain;
+    system.emuReadState = FakeReadState;
+    system.emuReadMemState = FakeReadMemState;
+    system.emuWriteMemState = FakeWriteMemState;
+    return system;
+}
+
+MovieInput InputAt(int frame) {
+    MovieInput input;
+    input.joypad = frame / 3;
+    input.sensor_x = frame < 10 ? 0 : -frame;
+    input.darkness = frame < 20 ? 0xe8 : 0x40;
+    return input;
+}
+
+// Emulates one frame with `movie`, returns the input it used.
+MovieInput RunFrame(Movie& movie, const EmulatedSystem& system, const MovieInput& live) {
+    const MovieInput input = movie.NextFrame(system, live);
+    system.emuMain(system.emuCount);
+    return input;
+}
+
+// Records `frames` frames from a reset fake core, returns the state after
+// every frame.
+std::vector<FakeState> Record(Movie& movie, const EmulatedSystem& system, int frames,
+                              int keyframe_interval) {
+    g_fake = FakeState();
+    g_movie = &movie;
+    std::vector<FakeState> states;
+    EXPECT_TRUE(movie.StartRecording(system, keyframe_interval));
+    for (int i = 0; i < frames; i++) {
+        RunFrame(movie, system, InputAt(i));
+        states.push_back(g_fake);
+    }
+    movie.Stop();
+    return states;
+}
+
+std::string TempFile(const char* name) {
+    return ::testing::TempDir() + name;
+}
+
+std::vector<uint8_t> ReadBytes(const std::string& name) {
+    std::vector<uint8_t> data;
+    FILE* f = fopen(name.c_str(), "rb");
+    if (!f)
+        return data;
+    int c;
+    while ((c = fgetc(f)) != EOF) {
+        data.push_back((uint8_t)c);
+    }
+    fclose(f);
+    return data;
+}
+
+void WriteBytes(const std::string& name, const std::vector<uint8_t>& data) {
+    FILE* f = fopen(name.c_str(), "wb");
+    ASSERT_NE(f, nullptr);
+    ASSERT_EQ(fwrite(data.data(), 1, data.size(), f), data.size());
+    fclose(f);
+}
+
+void Put32(std::vector<uint8_t>& out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out.push_back((value >> (i * 8)) & 0xff);
+    }
+}
+
+bool operator==(const FakeState& a, const FakeState& b) {
+    return a.frames == b.frames && a.hash == b.hash;
+}
+
+}  // namespace
+
+TEST(MovieTest, SaveLoadRoundTrip) {
+    const EmulatedSystem system = FakeSystem();
+    Movie recorded;
+    const std::vector<FakeState> states = Record(recorded, system, 25, 10);
+    const std::string file = TempFile("movie_test_round_trip.vbm");
+    ASSERT_TRUE(recorded.Save(file.c_str()));
+    EXPECT_TRUE(Movie::IsMovieFile(file.c_str()));
+
+    Movie movie;
+    ASSERT_TRUE(movie.Load(file.c_str()));
+    EXPECT_EQ(movie.frame_count(), 25);
+
+    // Playing back from a different state restores the start of the movie.
+    g_fake.frames = 1000;
+    g_movie = &movie;
+    ASSERT_TRUE(movie.StartPlayback(system));
+    EXPECT_EQ(movie.mode(), Movie::Mode::kPlaying);
+    for (int i = 0; i < 25; i++) {
+        EXPECT_EQ(RunFrame(movie, system, MovieInput()), InputAt(i));
+        EXPECT_TRUE(g_fake == states[i]) << "frame " << i;
+    }
+
+    // The playback stops after the last frame and returns the live input.
+    MovieInput live;
+    live.joypad = 0x3ff;
+    EXPECT_EQ(movie.NextFrame(system, live), live);
+    EXPECT_EQ(movie.mode(), Movie::Mode::kStopped);
+    remove(file.c_str());
+}
+
+TEST(MovieTest, RejectsTruncatedAndCorruptFiles) {
+    const EmulatedSystem system = FakeSystem();
+    Movie recorded;
+    Record(recorded, system, 25, 10);
+    const std::string file = TempFile("movie_test_corrupt.vbm");
+    ASSERT_TRUE(recorded.Save(file.c_str()));
+    const std::vector<uint8_t> data = ReadBytes(file);
+    ASSERT_GT(data.size(), 20u);
+
+    Movie movie;
+    for (size_t size = 0; size < data.size(); size++) {
+        WriteBytes(file, std::vector<uint8_t>(data.begin(), data.begin() + size));
+        EXPECT_FALSE(movie.Load(file.c_str())) << "size " << size;
+        EXPECT_EQ(movie.frame_count(), 0);
+    }
+
+    // Trailing data.
+    std::vector<uint8_t> corrupt = data;
+    corrupt.push_back(0);
+    WriteBytes(file, corrupt);
+    EXPECT_FALSE(movie.Load(file.c_str()));
+
+    // Unknown version.
+    corrupt = data;
+    corrupt[4] = 2;
+    WriteBytes(file, corrupt);
+    EXPECT_FALSE(movie.Load(file.c_str()));
+
+    // Unknown field in the first frame.
+    corrupt = data;
+    corrupt[20] = 0x80;
+    WriteBytes(file, corrupt);
+    EXPECT_FALSE(movie.Load(file.c_str()));
+
+    WriteBytes(file, data);
+    EXPECT_TRUE(movie.Load(file.c_str()));
+    EXPECT_EQ(movie.frame_count(), 25);
+    remove(file.c_str());
+}
+
+TEST(MovieTest, SeeksAcrossKeyframes) {
+    const EmulatedSystem system = FakeSystem();
+    Movie movie;
+    const std::vector<FakeState> states = Record(movie, system, 45, 10);
+    g_movie = &movie;
+    ASSERT_TRUE(movie.StartPlayback(system));
+
+    // Forward, past two keyframes: the last one before the frame is restored.
+    g_restores = 0;
+    ASSERT_TRUE(movie.Seek(system, 23));
+    EXPECT_EQ(movie.frame(), 23);
+    EXPECT_TRUE(g_fake == states[22]);
+    EXPECT_EQ(g_restores, 1);
+
+    // Forward, before the next keyframe: the frames are only emulated.
+    ASSERT_TRUE(movie.Seek(system, 28));
+    EXPECT_TRUE(g_fake == states[27]);
+    EXPECT_EQ(g_restores, 1);
+
+    // Backward, across a keyframe.
+    ASSERT_TRUE(movie.Seek(system, 7));
+    EXPECT_EQ(movie.frame(), 7);
+    EXPECT_TRUE(g_fake == states[6]);
+    EXPECT_EQ(g_restores, 2);
+
+    // Past the end, to the last frame, then the playback goes on from there.
+    ASSERT_TRUE(movie.Seek(system, 100));
+    EXPECT_EQ(movie.frame(), 45);
+    EXPECT_TRUE(g_fake == states[44]);
+    EXPECT_EQ(movie.NextFrame(system, MovieInput()), MovieInput());
+    EXPECT_EQ(movie.mode(), Movie::Mode::kStopped);
+
+    EXPECT_FALSE(movie.Seek(system, 3));
+}
+
+TEST(MovieTest, ImportsVMVTimestamps) {
+    const EmulatedSystem system = FakeSystem();
+    // The joypad is 1 on frames 0 to 4, 2 on frames 5 to 7, and the movie
+    // ends at frame 8.
+    const uint32_t changes[3][2] = {{0, 1}, {5, 2}, {8, 0}};
+
+    for (uint32_t version = 1; version <= 2; version++) {
+        std::vector<uint8_t> data;
+        Put32(data, version);
+        uint32_t previous = 0;
+        for (const auto& change : changes) {
+            // Version 1 counts from the start, version 2 from the previous
+            // change.
+            Put32(data, version == 1 ? change[0] : change[0] - previous);
+            Put32(data, change[1]);
+            previous = change[0];
+        }
+        const std::string file = TempFile("movie_test.vmv");
+        WriteBytes(file, data);
+
+        Movie movie;
+        g_movie = &movie;
+        ASSERT_TRUE(movie.ImportVMV(file.c_str(), system)) << "version " << version;
+        EXPECT_EQ(movie.frame_count(), 8);
+        ASSERT_TRUE(movie.StartPlayback(system));
+        for (int i = 0; i < 8; i++) {
+            EXPECT_EQ(RunFrame(movie, system, MovieInput()).joypad, i < 5 ? 1u : 2u)
+                << "version " << version << " frame " << i;
+        }
+        remove(file.c_str());
+    }
+}
+
+TEST(MovieTest, RejectsBackwardVMVTimestamps) {
+    const EmulatedSystem system = FakeSystem();
+    std::vector<uint8_t> data;
+    Put32(data, 1);
+    Put32(data, 5);
+    Put32(data, 1);
+    Put32(data, 3);
+    Put32(data, 2);
+    const std::string file = TempFile("movie_test_backward.vmv");
+    WriteBytes(file, data);
+
+    Movie movie;
+    EXPECT_FALSE(movie.ImportVMV(file.c_str(), system));
+    remove(file.c_str());
+}
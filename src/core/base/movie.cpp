@@ -0,0 +1,446 @@
+#include "core/base/movie.h"
+
+#if defined(__LIBRETRO__)
+#error "This file is only for non-libretro builds"
+#endif
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include <zlib.h>
+
+#include "core/base/file_util.h"
+#include "core/base/run_ahead.h"
+#include "core/base/system.h"
+
+// A movie file, all values little-endian:
+//   "VBMV"
+//   <version>.32 = 1
+//   <keyframe interval>.32
+//   <frame count>.32
+//   <keyframe count>.32
+//   for every frame {
+//      <changed fields>.8 = bit 0: joypad, 1: sensor X, 2: sensor Y,
+//                           3: sensor Z, 4: darkness
+//      the changed fields, from the previous frame or the default input:
+//      <joypad>.32, <sensor X>.32, <sensor Y>.32, <sensor Z>.32, <darkness>.8
+//   }
+//   for every keyframe {
+//      <frame>.32
+//      <state size>.32
+//      <compressed size>.32
+//      <compressed state>, the in-memory state compressed with zlib
+//   }
+
+namespace {
+
+constexpr char kMagic[4] = {'V', 'B', 'M', 'V'};
+constexpr uint32_t kVersion = 1;
+
+enum ChangedFields : uint8_t {
+    kJoypad = 1 << 0,
+    kSensorX = 1 << 1,
+    kSensorY = 1 << 2,
+    kSensorZ = 1 << 3,
+    kDarkness = 1 << 4,
+    kAllFields = kJoypad | kSensorX | kSensorY | kSensorZ | kDarkness,
+};
+
+// Only the GBA and GB raw states are expected, larger data is an error.
+constexpr uint32_t kMaxStateSize = 16 << 20;
+
+// Scratch buffer for the states, kept to reuse its allocation.
+std::vector<char> g_state;
+
+void Put8(std::vector<uint8_t>& out, uint8_t value) {
+    out.push_back(value);
+}
+
+void Put32(std::vector<uint8_t>& out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out.push_back((value >> (i * 8)) & 0xff);
+    }
+}
+
+// Reads little-endian values from a buffer, fails once past its end.
+class Reader {
+public:
+    explicit Reader(const std::vector<uint8_t>& data) : data_(data) {}
+
+    bool Get8(uint8_t& value) {
+        if (pos_ + 1 > data_.size())
+            return false;
+        value = data_[pos_++];
+        return true;
+    }
+
+    bool Get32(uint32_t& value) {
+        if (pos_ + 4 > data_.size())
+            return false;
+        value = 0;
+        for (int i = 0; i < 4; i++) {
+            value |= uint32_t(data_[pos_++]) << (i * 8);
+        }
+        return true;
+    }
+
+    bool GetBytes(std::vector<uint8_t>& out, size_t size) {
+        if (pos_ + size > data_.size())
+            return false;
+        out.assign(data_.begin() + pos_, data_.begin() + pos_ + size);
+        pos_ += size;
+        return true;
+    }
+
+    bool done() const { return pos_ == data_.size(); }
+
+private:
+    const std::vector<uint8_t>& data_;
+    size_t pos_ = 0;
+};
+
+bool ReadFile(const char* file, std::vector<uint8_t>& data) {
+    FILE* f = utilOpenFile(file, "rb");
+    if (!f)
+        return false;
+
+    data.clear();
+    uint8_t buffer[1 << 16];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), f)) > 0) {
+        data.insert(data.end(), buffer, buffer + read);
+    }
+    const bool ok = !ferror(f);
+    fclose(f);
+    return ok;
+}
+
+}  // namespace
+
+bool Movie::StartRecording(const EmulatedSystem& system, int keyframe_interval) {
+    Clear();
+    keyframe_interval_ = std::max(1, keyframe_interval);
+
+    if (!AddKeyframe(system))
+        return false;
+
+    mode_ = Mode::kRecording;
+    return true;
+}
+
+bool Movie::StartPlayback(const EmulatedSystem& system) {
+    mode_ = Mode::kStopped;
+    if (keyframes_.empty() || !RestoreKeyframe(system, keyframes_.front()))
+        return false;
+
+    frame_ = 0;
+    input_ = MovieInput();
+    mode_ = Mode::kPlaying;
+    return true;
+}
+
+void Movie::Stop() {
+    mode_ = Mode::kStopped;
+}
+
+const MovieInput& Movie::NextFrame(const EmulatedSystem& system, const MovieInput& live) {
+    switch (mode_) {
+        case Mode::kStopped:
+            input_ = live;
+            break;
+
+        case Mode::kRecording:
+            if (frame_ % keyframe_interval_ == 0 && keyframes_.back().frame < frame_)
+                AddKeyframe(system);
+
+            input_ = live;
+            inputs_.push_back(live);
+            frame_++;
+            break;
+
+        case Mode::kPlaying:
+            if (frame_ >= frame_count()) {
+                mode_ = Mode::kStopped;
+                input_ = live;
+                break;
+            }
+
+            // The imported movies only get their keyframes when played back.
+            if (frame_ % keyframe_interval_ == 0 && keyframes_.back().frame < frame_)
+                AddKeyframe(system);
+
+            input_ = inputs_[frame_++];
+            break;
+    }
+
+    return input_;
+}
+
+bool Movie::Seek(const EmulatedSystem& system, int frame) {
+    if (mode_ != Mode::kPlaying)
+        return false;
+
+    frame = std::min(std::max(frame, 0), frame_count());
+
+    // The last keyframe before `frame`, restored unless the current frame is
+    // already after it.
+    auto keyframe = std::upper_bound(
+        keyframes_.begin(), keyframes_.end(), frame,
+        [](int frame, const Keyframe& keyframe) { return frame < keyframe.frame; });
+    --keyframe;
+
+    if (frame_ > frame || frame_ < keyframe->frame) {
+        if (!RestoreKeyframe(system, *keyframe))
+            return false;
+        frame_ = keyframe->frame;
+    }
+
+    while (frame_ < frame) {
+        if (frame_ % keyframe_interval_ == 0 && keyframes_.back().frame < frame_)
+            AddKeyframe(system);
+
+        input_ = inputs_[frame_++];
+        // Only the video of the last frame is presented.
+        RunAhead::EmulateHiddenFrame(system, frame_ == frame);
+    }
+
+    return true;
+}
+
+// static
+bool Movie::IsMovieFile(const char* file) {
+    FILE* f = utilOpenFile(file, "rb");
+    if (!f)
+        return false;
+
+    char magic[sizeof(kMagic)];
+    const bool movie = fread(magic, 1, sizeof(magic), f) == sizeof(magic) &&
+                       memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+    fclose(f);
+    return movie;
+}
+
+bool Movie::Load(const char* file) {
+    if (mode_ != Mode::kStopped)
+        return false;
+
+    std::vector<uint8_t> data;
+    if (!ReadFile(file, data) || data.size() < sizeof(kMagic) ||
+        memcmp(data.data(), kMagic, sizeof(kMagic)) != 0) {
+        return false;
+    }
+
+    Clear();
+    Reader reader(data);
+    std::vector<uint8_t> magic;
+    uint32_t version, keyframe_interval, frame_count, keyframe_count;
+    if (!reader.GetBytes(magic, sizeof(kMagic)) || !reader.Get32(version) ||
+        version != kVersion || !reader.Get32(keyframe_interval) || keyframe_interval == 0 ||
+        !reader.Get32(frame_count) || !reader.Get32(keyframe_count) || keyframe_count == 0) {
+        return false;
+    }
+    keyframe_interval_ = (int)std::min<uint32_t>(keyframe_interval, INT32_MAX);
+
+    // Every field must be read, a movie is never loaded in part.
+    MovieInput input;
+    for (uint32_t i = 0; i < frame_count; i++) {
+        uint8_t changed;
+        uint32_t sensor_x, sensor_y, sensor_z;
+        if (!reader.Get8(changed) || (changed & ~kAllFields) ||
+            ((changed & kJoypad) && !reader.Get32(input.joypad)) ||
+            ((changed & kSensorX) && !reader.Get32(sensor_x)) ||
+            ((changed & kSensorY) && !reader.Get32(sensor_y)) ||
+            ((changed & kSensorZ) && !reader.Get32(sensor_z)) ||
+            ((changed & kDarkness) && !reader.Get8(input.darkness))) {
+            Clear();
+            return false;
+        }
+        if (changed & kSensorX)
+            input.sensor_x = (int32_t)sensor_x;
+        if (changed & kSensorY)
+            input.sensor_y = (int32_t)sensor_y;
+        if (changed & kSensorZ)
+            input.sensor_z = (int32_t)sensor_z;
+        inputs_.push_back(input);
+    }
+
+    for (uint32_t i = 0; i < keyframe_count; i++) {
+        Keyframe keyframe;
+        uint32_t frame, compressed_size;
+        if (!reader.Get32(frame) || !reader.Get32(keyframe.state_size) ||
+            !reader.Get32(compressed_size) || !reader.GetBytes(keyframe.data, compressed_size) ||
+            frame > INT32_MAX || keyframe.state_size > kMaxStateSize ||
+            // The first keyframe is the start of the movie, then in frame order.
+            (keyframes_.empty() ? frame != 0 : (int)frame <= keyframes_.back().frame)) {
+            Clear();
+            return false;
+        }
+        keyframe.frame = (int)frame;
+        keyframes_.push_back(std::move(keyframe));
+    }
+
+    if (!reader.done()) {
+        Clear();
+        return false;
+    }
+
+    return true;
+}
+
+bool Movie::Save(const char* file) const {
+    if (mode_ == Mode::kRecording || keyframes_.empty())
+        return false;
+
+    std::vector<uint8_t> data(kMagic, kMagic + sizeof(kMagic));
+    Put32(data, kVersion);
+    Put32(data, keyframe_interval_);
+    Put32(data, (uint32_t)inputs_.size());
+    Put32(data, (uint32_t)keyframes_.size());
+
+    MovieInput previous;
+    for (const MovieInput& input : inputs_) {
+        uint8_t changed = 0;
+        if (input.joypad != previous.joypad)
+            changed |= kJoypad;
+        if (input.sensor_x != previous.sensor_x)
+            changed |= kSensorX;
+        if (input.sensor_y != previous.sensor_y)
+            changed |= kSensorY;
+        if (input.sensor_z != previous.sensor_z)
+            changed |= kSensorZ;
+        if (input.darkness != previous.darkness)
+            changed |= kDarkness;
+
+        Put8(data, changed);
+        if (changed & kJoypad)
+            Put32(data, input.joypad);
+        if (changed & kSensorX)
+            Put32(data, (uint32_t)input.sensor_x);
+        if (changed & kSensorY)
+            Put32(data, (uint32_t)input.sensor_y);
+        if (changed & kSensorZ)
+            Put32(data, (uint32_t)input.sensor_z);
+        if (changed & kDarkness)
+            Put8(data, input.darkness);
+        previous = input;
+    }
+
+    for (const Keyframe& keyframe : keyframes_) {
+        Put32(data, (uint32_t)keyframe.frame);
+        Put32(data, keyframe.state_size);
+        Put32(data, (uint32_t)keyframe.data.size());
+        data.insert(data.end(), keyframe.data.begin(), keyframe.data.end());
+    }
+
+    FILE* f = utilOpenFile(file, "wb");
+    if (!f)
+        return false;
+
+    const bool written = fwrite(data.data(), 1, data.size(), f) == data.size();
+    return fclose(f) == 0 && written;
+}
+
+bool Movie::ImportVMV(const char* file, const EmulatedSystem& system) {
+    if (mode_ != Mode::kStopped)
+        return false;
+
+    std::vector<uint8_t> data;
+    if (!ReadFile(file, data))
+        return false;
+
+    // <version>.32, then (<frame>.32, <joypad>.32) for every joypad change
+    // and once at the end of the movie. The frames are counted from the start
+    // of the movie in version 1, from the previous change in version 2.
+    Reader reader(data);
+    uint32_t version;
+    if (!reader.Get32(version) || version < 1 || version > 2)
+        return false;
+
+    std::vector<std::pair<uint32_t, uint32_t>> changes;
+    uint32_t frame = 0;
+    uint32_t stamp, joypad;
+    while (reader.Get32(stamp) && reader.Get32(joypad)) {
+        frame = version == 1 ? stamp : frame + stamp;
+        if (frame > INT32_MAX || (!changes.empty() && frame < changes.back().first))
+            return false;
+        changes.emplace_back(frame, joypad);
+    }
+    if (changes.empty())
+        return false;
+
+    // The start state is <name>.vm0.
+    std::string state_file(file);
+    state_file.back() = '0';
+    if (!system.emuReadState(state_file.c_str()))
+        return false;
+
+    Clear();
+    if (!AddKeyframe(system)) {
+        Clear();
+        return false;
+    }
+
+    MovieInput input;
+    size_t next = 0;
+    const uint32_t frame_count = changes.back().first;
+    inputs_.reserve(frame_count);
+    for (uint32_t i = 0; i < frame_count; i++) {
+        while (next < changes.size() && changes[next].first <= i) {
+            input.joypad = changes[next++].second;
+        }
+        inputs_.push_back(input);
+    }
+
+    return true;
+}
+
+void Movie::Clear() {
+    mode_ = Mode::kStopped;
+    keyframe_interval_ = kDefaultKeyframeInterval;
+    frame_ = 0;
+    input_ = MovieInput();
+    inputs_.clear();
+    keyframes_.clear();
+}
+
+bool Movie::AddKeyframe(const EmulatedSystem& system) {
+    long size = 0;
+    if (!system.emuWriteMemState(g_state.data(), (int)g_state.size(), size)) {
+        g_state.resize(size);
+        if (!system.emuWriteMemState(g_state.data(), (int)g_state.size(), size))
+            return false;
+    }
+
+    Keyframe keyframe;
+    keyframe.frame = frame_;
+    keyframe.state_size = (uint32_t)size;
+    uLongf compressed_size = compressBound(size);
+    keyframe.data.resize(compressed_size);
+    if (compress2(keyframe.data.data(), &compressed_size,
+                  reinterpret_cast<const Bytef*>(g_state.data()), size, Z_BEST_SPEED) != Z_OK) {
+        return false;
+    }
+    keyframe.data.resize(compressed_size);
+    keyframe.data.shrink_to_fit();
+
+    keyframes_.push_back(std::move(keyframe));
+    return true;
+}
+
+bool Movie::RestoreKeyframe(const EmulatedSystem& system, const Keyframe& keyframe) {
+    g_state.resize(std::max<size_t>(g_state.size(), keyframe.state_size));
+    uLongf size = keyframe.state_size;
+    if (uncompress(reinterpret_cast<Bytef*>(g_state.data()), &size, keyframe.data.data(),
+                   keyframe.data.size()) != Z_OK ||
+        size != keyframe.state_size) {
+        return false;
+    }
+
+    // Restoring the state resets the battery save counter.
+    const int save_update_counter = systemSaveUpdateCounter;
+    const bool restored = system.emuReadMemState(g_state.data(), (int)size);
+    systemSaveUpdateCounter = save_update_counter;
+    return restored;
+}
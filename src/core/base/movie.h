@@ -0,0 +1,112 @@
+#ifndef VBAM_CORE_BASE_MOVIE_H_
+#define VBAM_CORE_BASE_MOVIE_H_
+
+#if defined(__LIBRETRO__)
+#error "This file is only for non-libretro builds"
+#endif
+
+#include <cstdint>
+#include <vector>
+
+struct EmulatedSystem;
+
+// The input of one frame.
+struct MovieInput {
+    // As returned by systemReadJoypad().
+    uint32_t joypad = 0;
+    // As returned by systemGetSensorX(), systemGetSensorY() and
+    // systemGetSensorZ().
+    int32_t sensor_x = 0;
+    int32_t sensor_y = 0;
+    int32_t sensor_z = 0;
+    // As returned by systemGetSensorDarkness().
+    uint8_t darkness = 0xe8;
+
+    bool operator==(const MovieInput& other) const {
+        return joypad == other.joypad && sensor_x == other.sensor_x &&
+               sensor_y == other.sensor_y && sensor_z == other.sensor_z &&
+               darkness == other.darkness;
+    }
+    bool operator!=(const MovieInput& other) const { return !(*this == other); }
+};
+
+// Records and plays back the input of every frame, starting from a saved
+// state.
+//
+// The frontend calls NextFrame() before emulating every frame, and its input
+// callbacks return input() while a movie is recorded or played back. A
+// keyframe, a compressed in-memory state, is taken every `keyframe_interval`
+// frames, so that seeking only emulates the frames since the previous one.
+class Movie {
+public:
+    // 10 seconds, a keyframe takes about 40 KiB for the GBA.
+    static constexpr int kDefaultKeyframeInterval = 600;
+
+    enum class Mode {
+        kStopped,
+        kRecording,
+        kPlaying,
+    };
+
+    // Starts a new movie from the current state of `system`.
+    bool StartRecording(const EmulatedSystem& system,
+                        int keyframe_interval = kDefaultKeyframeInterval);
+
+    // Restores the start of the movie and plays it back.
+    bool StartPlayback(const EmulatedSystem& system);
+
+    // Stops recording or playing back, the movie is kept.
+    void Stop();
+
+    // Returns the input for the next frame: `live` is recorded and returned
+    // when recording, the recorded input is returned when playing back. The
+    // playback stops after the last frame, and `live` is returned.
+    const MovieInput& NextFrame(const EmulatedSystem& system, const MovieInput& live);
+
+    // Restores the last keyframe before `frame` and emulates the frames after
+    // it, without presenting them. Only while playing back.
+    bool Seek(const EmulatedSystem& system, int frame);
+
+    // Loads or saves a movie file, when stopped.
+    bool Load(const char* file);
+    bool Save(const char* file) const;
+
+    // Whether `file` starts like a movie file, whether or not it can be
+    // loaded.
+    static bool IsMovieFile(const char* file);
+
+    // Imports a VMV keystroke log from the wx frontend, with its <name>.vm0
+    // start state, which is restored to `system`.
+    bool ImportVMV(const char* file, const EmulatedSystem& system);
+
+    // The input of the current frame.
+    const MovieInput& input() const { return input_; }
+
+    Mode mode() const { return mode_; }
+    // The number of frames emulated since the start of the movie.
+    int frame() const { return frame_; }
+    int frame_count() const { return (int)inputs_.size(); }
+
+private:
+    struct Keyframe {
+        int frame;
+        uint32_t state_size;
+        // The state compressed with zlib.
+        std::vector<uint8_t> data;
+    };
+
+    void Clear();
+    bool AddKeyframe(const EmulatedSystem& system);
+    bool RestoreKeyframe(const EmulatedSystem& system, const Keyframe& keyframe);
+
+    Mode mode_ = Mode::kStopped;
+    int keyframe_interval_ = kDefaultKeyframeInterval;
+    int frame_ = 0;
+    MovieInput input_;
+
+    std::vector<MovieInput> inputs_;
+    // In frame order, the first one is the start of the movie.
+    std::vector<Keyframe> keyframes_;
+};
+
+#endif  // VBAM_CORE_BASE_MOVIE_H_
@@ -200,7 +200,7 @@ static bool patchApplyIPS(const char* patchname, uint8_t** r, int* s)
             // check if we need to reallocate our ROM
             if ((offset + len) >= size) {
                 size *= 2;
-                rom = (uint8_t*)realloc(rom, size);
+                rom = utilReallocImage(rom, size);
                 *r = rom;
                 *s = size;
             }
@@ -285,7 +285,7 @@ static bool patchApplyUPS(const char* patchname, uint8_t** rom, int* size)
         return false;
     }
     if (dataSize > *size) {
-        *rom = (uint8_t*)realloc(*rom, dataSize);
+        *rom = utilReallocImage(*rom, dataSize);
         memset(*rom + *size, 0, dataSize - *size);
         *size = (int)(dataSize);
     }
@@ -420,7 +420,7 @@ static bool patchApplyBPS(const char* patchname, uint8_t** rom, int* size)
     if(crc == dstCRC)
     {
         if (dataSize > *size) {
-            *rom = (uint8_t*)realloc(*rom, dataSize);
+            *rom = utilReallocImage(*rom, dataSize);
         }
         memcpy(*rom, new_rom, dataSize);
         *size = dataSize;
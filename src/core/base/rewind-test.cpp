@@ -0,0 +1,172 @@
+#include "core/base/rewind.h"
+
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "core/base/system.h"
+
+// Used by the other parts of vbam-core-base.
+struct CoreOptions coreOptions;
+
+namespace {
+
+using State = std::vector<uint8_t>;
+
+State RandomState(std::mt19937& rng, size_t size) {
+    State state(size);
+    for (uint8_t& byte : state) {
+        byte = static_cast<uint8_t>(rng());
+    }
+    return state;
+}
+
+// Returns `state` resized to `size`, with a few random runs changed.
+State Modify(std::mt19937& rng, const State& state, size_t size) {
+    State next = state;
+    next.resize(size, 0xa5);
+    for (int run = 0; run < 8 && size; run++) {
+        const size_t start = rng() % size;
+        const size_t end = std::min(size, start + rng() % 64);
+        for (size_t i = start; i < end; i++) {
+            next[i] = static_cast<uint8_t>(rng());
+        }
+    }
+    return next;
+}
+
+void Push(RewindBuffer& buffer, const State& state) {
+    buffer.Push(state.data(), state.size());
+}
+
+State Newest(const RewindBuffer& buffer) {
+    return State(buffer.newest(), buffer.newest() + buffer.newest_size());
+}
+
+}  // namespace
+
+TEST(RewindBufferTest, Empty) {
+    RewindBuffer buffer(1 << 20);
+
+    EXPECT_EQ(buffer.count(), 0);
+    EXPECT_FALSE(buffer.DropNewest());
+}
+
+TEST(RewindBufferTest, SingleState) {
+    std::mt19937 rng(1);
+    RewindBuffer buffer(1 << 20);
+    const State state = RandomState(rng, 5000);
+
+    Push(buffer, state);
+
+    EXPECT_EQ(buffer.count(), 1);
+    EXPECT_EQ(buffer.delta_bytes(), 0);
+    EXPECT_EQ(Newest(buffer), state);
+    EXPECT_FALSE(buffer.DropNewest());
+    EXPECT_EQ(Newest(buffer), state);
+}
+
+TEST(RewindBufferTest, UnchangedStateOnlyStoresTheHeader) {
+    std::mt19937 rng(2);
+    RewindBuffer buffer(1 << 20);
+    const State state = RandomState(rng, 3 * RewindBuffer::kPageSize);
+
+    Push(buffer, state);
+    Push(buffer, state);
+
+    EXPECT_EQ(buffer.count(), 2);
+    // The size of the older state and the end marker.
+    EXPECT_EQ(buffer.delta_bytes(), 8);
+    EXPECT_TRUE(buffer.DropNewest());
+    EXPECT_EQ(Newest(buffer), state);
+}
+
+TEST(RewindBufferTest, RoundTripsStatesOfDifferentSizes) {
+    std::mt19937 rng(3);
+    RewindBuffer buffer(64 << 20);
+
+    // Sizes growing and shrinking across page boundaries, with partial last
+    // pages, an empty tail after a shrink and a page-sized state.
+    const size_t sizes[] = {5000,  5003, 12288, 100,  4096, 9000, 9000,
+                            20000, 4097, 1,     8192, 8191, 30000};
+    std::vector<State> states;
+    State state = RandomState(rng, sizes[0]);
+    for (size_t size : sizes) {
+        state = Modify(rng, state, size);
+        states.push_back(state);
+        Push(buffer, state);
+        ASSERT_EQ(Newest(buffer), state);
+    }
+    ASSERT_EQ(buffer.count(), states.size());
+
+    for (size_t i = states.size() - 1; i > 0; i--) {
+        ASSERT_TRUE(buffer.DropNewest());
+        ASSERT_EQ(buffer.count(), i);
+        ASSERT_EQ(Newest(buffer), states[i - 1]) << "state " << i - 1;
+    }
+    EXPECT_FALSE(buffer.DropNewest());
+    EXPECT_EQ(buffer.delta_bytes(), 0);
+}
+
+TEST(RewindBufferTest, PushAfterDrop) {
+    std::mt19937 rng(4);
+    RewindBuffer buffer(1 << 20);
+    const State a = RandomState(rng, 10000);
+    const State b = Modify(rng, a, 6000);
+    const State c = Modify(rng, a, 14000);
+
+    Push(buffer, a);
+    Push(buffer, b);
+    ASSERT_TRUE(buffer.DropNewest());
+    Push(buffer, c);
+
+    EXPECT_EQ(Newest(buffer), c);
+    ASSERT_TRUE(buffer.DropNewest());
+    EXPECT_EQ(Newest(buffer), a);
+    EXPECT_FALSE(buffer.DropNewest());
+}
+
+TEST(RewindBufferTest, BudgetDropsTheOldestStates) {
+    std::mt19937 rng(5);
+    const size_t budget = 16 * 1024;
+    RewindBuffer buffer(budget);
+
+    std::vector<State> states;
+    State state = RandomState(rng, 16 * RewindBuffer::kPageSize);
+    for (int i = 0; i < 200; i++) {
+        state = Modify(rng, state, state.size());
+        states.push_back(state);
+        Push(buffer, state);
+        ASSERT_LE(buffer.delta_bytes(), budget);
+    }
+    ASSERT_LT(buffer.count(), states.size());
+    ASSERT_GT(buffer.count(), 1);
+
+    // The states left are the newest ones, in order.
+    const size_t kept = buffer.count();
+    size_t i = states.size() - 1;
+    EXPECT_EQ(Newest(buffer), states[i]);
+    while (buffer.DropNewest()) {
+        i--;
+        ASSERT_EQ(Newest(buffer), states[i]) << "state " << i;
+    }
+    EXPECT_EQ(states.size() - i, kept);
+}
+
+TEST(RewindBufferTest, Clear) {
+    std::mt19937 rng(6);
+    RewindBuffer buffer(1 << 20);
+    const State a = RandomState(rng, 5000);
+
+    Push(buffer, a);
+    Push(buffer, Modify(rng, a, 5000));
+    buffer.Clear();
+
+    EXPECT_EQ(buffer.count(), 0);
+    EXPECT_EQ(buffer.delta_bytes(), 0);
+    EXPECT_FALSE(buffer.DropNewest());
+
+    Push(buffer, a);
+    EXPECT_EQ(Newest(buffer), a);
+}
@@ -0,0 +1,155 @@
+#include "core/base/rewind.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr size_t kPageWords = RewindBuffer::kPageSize / 4;
+constexpr uint32_t kEndOfDelta = 0xffffffff;
+
+// A delta is made of:
+// - The size of the older state.
+// - For every page that changed, its index followed by runs covering the
+//   whole page. A run starts with the count of unchanged words in the upper
+//   16 bits and the count of changed words in the lower 16 bits, followed by
+//   the changed words XOR'ed between the 2 states.
+// - kEndOfDelta.
+// All the values are 32-bit words in host byte order.
+
+inline uint32_t LoadWord(const uint8_t* data) {
+    uint32_t word;
+    memcpy(&word, data, sizeof(word));
+    return word;
+}
+
+inline void StoreWord(uint8_t* data, uint32_t word) {
+    memcpy(data, &word, sizeof(word));
+}
+
+inline void AppendWord(std::vector<uint8_t>* out, uint32_t word) {
+    const size_t pos = out->size();
+    out->resize(pos + sizeof(word));
+    StoreWord(out->data() + pos, word);
+}
+
+void EncodePage(uint32_t index, const uint8_t* older, const uint8_t* newer,
+                std::vector<uint8_t>* out) {
+    AppendWord(out, index);
+
+    size_t word = 0;
+    while (word < kPageWords) {
+        size_t changed = word;
+        while (changed < kPageWords && LoadWord(older + changed * 4) == LoadWord(newer + changed * 4)) {
+            changed++;
+        }
+        size_t end = changed;
+        while (end < kPageWords && LoadWord(older + end * 4) != LoadWord(newer + end * 4)) {
+            end++;
+        }
+
+        AppendWord(out, static_cast<uint32_t>((changed - word) << 16 | (end - changed)));
+        for (size_t i = changed; i < end; i++) {
+            AppendWord(out, LoadWord(older + i * 4) ^ LoadWord(newer + i * 4));
+        }
+        word = end;
+    }
+}
+
+// Applies the runs of one page, returns the end of its data.
+const uint8_t* DecodePage(const uint8_t* in, uint8_t* page) {
+    size_t word = 0;
+    while (word < kPageWords) {
+        const uint32_t run = LoadWord(in);
+        in += 4;
+        word += run >> 16;
+        for (size_t count = run & 0xffff; count; count--) {
+            StoreWord(page + word * 4, LoadWord(page + word * 4) ^ LoadWord(in));
+            word++;
+            in += 4;
+        }
+    }
+    return in;
+}
+
+inline size_t PageCount(size_t size) {
+    return (size + RewindBuffer::kPageSize - 1) / RewindBuffer::kPageSize;
+}
+
+}  // namespace
+
+RewindBuffer::RewindBuffer(size_t budget_bytes) : budget_bytes_(budget_bytes) {}
+
+void RewindBuffer::Push(const uint8_t* state, size_t size) {
+    const size_t pages = PageCount(size);
+
+    if (current_size_) {
+        const size_t total_pages = std::max(pages, current_.size() / kPageSize);
+        current_.resize(total_pages * kPageSize, 0);
+
+        encoded_.clear();
+        AppendWord(&encoded_, static_cast<uint32_t>(current_size_));
+        uint8_t padded[kPageSize];
+        for (size_t page = 0; page < total_pages; page++) {
+            const size_t offset = page * kPageSize;
+            const uint8_t* older = current_.data() + offset;
+            const uint8_t* newer = state + offset;
+            if (offset + kPageSize > size) {
+                memset(padded, 0, kPageSize);
+                if (offset < size) {
+                    memcpy(padded, newer, size - offset);
+                }
+                newer = padded;
+            }
+            if (memcmp(older, newer, kPageSize) != 0) {
+                EncodePage(static_cast<uint32_t>(page), older, newer, &encoded_);
+            }
+        }
+        AppendWord(&encoded_, kEndOfDelta);
+
+        deltas_.emplace_back(encoded_.begin(), encoded_.end());
+        delta_bytes_ += encoded_.size();
+    }
+
+    current_.assign(state, state + size);
+    current_.resize(pages * kPageSize, 0);
+    current_size_ = size;
+
+    while (delta_bytes_ > budget_bytes_) {
+        delta_bytes_ -= deltas_.front().size();
+        deltas_.pop_front();
+    }
+}
+
+bool RewindBuffer::DropNewest() {
+    if (deltas_.empty()) {
+        return false;
+    }
+
+    const std::vector<uint8_t>& delta = deltas_.back();
+    const uint8_t* in = delta.data();
+    const size_t older_size = LoadWord(in);
+    in += 4;
+
+    const size_t older_pages = PageCount(older_size);
+    if (current_.size() < older_pages * kPageSize) {
+        current_.resize(older_pages * kPageSize, 0);
+    }
+    for (uint32_t page = LoadWord(in); page != kEndOfDelta; page = LoadWord(in)) {
+        in = DecodePage(in + 4, current_.data() + page * kPageSize);
+    }
+    // Pages past the older state were XOR'ed back to zeroes.
+    current_.resize(older_pages * kPageSize);
+    current_size_ = older_size;
+
+    delta_bytes_ -= delta.size();
+    deltas_.pop_back();
+    return true;
+}
+
+void RewindBuffer::Clear() {
+    current_.clear();
+    current_size_ = 0;
+    deltas_.clear();
+    delta_bytes_ = 0;
+}
@@ -0,0 +1,57 @@
+#ifndef VBAM_CORE_BASE_REWIND_H_
+#define VBAM_CORE_BASE_REWIND_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// History of emulator states for rewinding.
+//
+// The newest state is kept in full. Every older state is stored as a delta
+// against the state that followed it: only the 4 KiB pages that changed are
+// kept, XOR'ed with their newer contents and run-length encoded. Unchanged
+// pages cost nothing, so a history of closely spaced states only takes as
+// much memory as the emulator actually writes between them. Stepping back
+// applies a single delta whatever the length of the history, and the oldest
+// states are dropped once the deltas outgrow the memory budget.
+class RewindBuffer {
+public:
+    static constexpr size_t kPageSize = 4096;
+
+    explicit RewindBuffer(size_t budget_bytes);
+
+    // Records a copy of `state` as the newest state.
+    void Push(const uint8_t* state, size_t size);
+
+    // Forgets the newest state, the one before it becomes the newest.
+    // Returns false when there is no older state.
+    bool DropNewest();
+
+    // Forgets all the states.
+    void Clear();
+
+    // The newest state, only valid when count() > 0.
+    const uint8_t* newest() const { return current_.data(); }
+    size_t newest_size() const { return current_size_; }
+
+    size_t count() const { return current_size_ ? deltas_.size() + 1 : 0; }
+    // Memory used by the deltas, not counting the newest state.
+    size_t delta_bytes() const { return delta_bytes_; }
+
+private:
+    const size_t budget_bytes_;
+
+    // Padded with zeroes to a whole number of pages.
+    std::vector<uint8_t> current_;
+    size_t current_size_ = 0;
+
+    // Oldest first.
+    std::deque<std::vector<uint8_t>> deltas_;
+    size_t delta_bytes_ = 0;
+
+    // Scratch space for encoding a delta, kept to reuse its allocation.
+    std::vector<uint8_t> encoded_;
+};
+
+#endif  // VBAM_CORE_BASE_REWIND_H_
@@ -0,0 +1,60 @@
+#include "core/base/run_ahead.h"
+
+#include "core/base/system.h"
+
+bool RunAhead::frame_done_ = false;
+bool RunAhead::running_ahead_ = false;
+
+void RunAhead::EmulateFrame(const EmulatedSystem& system, int frames) {
+    if (frames <= 0 || !system.emuReadMemState || !system.emuWriteMemState) {
+        system.emuMain(system.emuCount);
+        return;
+    }
+
+    const bool video_off = coreOptions.videoOff;
+
+    coreOptions.videoOff = true;
+    EmulateUntilFrameDone(system);
+
+    long size = 0;
+    if (!system.emuWriteMemState(state_.data(), (int)state_.size(), size)) {
+        state_.resize(size);
+        if (!system.emuWriteMemState(state_.data(), (int)state_.size(), size)) {
+            coreOptions.videoOff = video_off;
+            return;
+        }
+    }
+    // Restoring the state resets the battery save counter.
+    const int save_update_counter = systemSaveUpdateCounter;
+
+    coreOptions.videoOff = video_off;
+    for (int i = 1; i <= frames; i++) {
+        EmulateHiddenFrame(system, i == frames);
+    }
+
+    system.emuReadMemState(state_.data(), (int)state_.size());
+    systemSaveUpdateCounter = save_update_counter;
+}
+
+// static
+void RunAhead::EmulateUntilFrameDone(const EmulatedSystem& system) {
+    frame_done_ = false;
+    while (!frame_done_) {
+        system.emuMain(system.emuCount);
+    }
+}
+
+// static
+void RunAhead::EmulateHiddenFrame(const EmulatedSystem& system, bool video) {
+    const bool video_off = coreOptions.videoOff;
+    const bool audio_off = coreOptions.audioOff;
+
+    running_ahead_ = true;
+    coreOptions.videoOff = video_off || !video;
+    coreOptions.audioOff = true;
+    EmulateUntilFrameDone(system);
+    running_ahead_ = false;
+
+    coreOptions.videoOff = video_off;
+    coreOptions.audioOff = audio_off;
+}
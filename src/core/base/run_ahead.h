@@ -0,0 +1,48 @@
+#ifndef VBAM_CORE_BASE_RUN_AHEAD_H_
+#define VBAM_CORE_BASE_RUN_AHEAD_H_
+
+#include <vector>
+
+struct EmulatedSystem;
+
+// Hides the input latency of games that only react to the joypad a few frames
+// after reading it.
+//
+// Every frame is emulated without video, then saved. The next frames are
+// emulated ahead of time with the same input and without audio, only the
+// video of the last one is presented, and the saved state is restored. The
+// audio comes from the real frame, so it is not affected.
+class RunAhead {
+public:
+    // Emulates one frame, and presents the video of the frame `frames` ahead
+    // of it. With no frames to run ahead, this is a regular call to emuMain().
+    void EmulateFrame(const EmulatedSystem& system, int frames);
+
+    // Calls emuMain() until the end of a frame.
+    static void EmulateUntilFrameDone(const EmulatedSystem& system);
+
+    // Emulates a frame that is not reported to the frontend, without audio,
+    // and without video unless `video` is set. Also used to emulate frames
+    // again after a state was restored.
+    static void EmulateHiddenFrame(const EmulatedSystem& system, bool video);
+
+    // Called by the cores at the end of every frame. Returns false for the
+    // hidden frames, which are not reported to the frontend.
+    static bool ReportFrame() {
+        frame_done_ = true;
+        return !running_ahead_;
+    }
+
+    // Whether a hidden frame is emulated. The cores don't advance the devices
+    // that are not part of the states, such as the GBA RTC, in these frames.
+    static bool IsHiddenFrame() { return running_ahead_; }
+
+private:
+    static bool frame_done_;
+    static bool running_ahead_;
+
+    // Kept to reuse its allocation.
+    std::vector<char> state_;
+};
+
+#endif  // VBAM_CORE_BASE_RUN_AHEAD_H_
@@ -40,9 +40,16 @@ public:
     virtual void resume() = 0;
 
     // Write length bytes of data from the finalWave buffer to the driver output buffer.
+    // `length` is a whole number of 16-bit stereo sample pairs, but otherwise
+    // varies from call to call: all the samples of a frame are written at once.
     virtual void write(uint16_t* finalWave, int length) = 0;
 
     virtual void setThrottle(unsigned short throttle) = 0;
+
+    // Returns how full the output buffer is, from 0.0 (empty) to 1.0 (full),
+    // or a negative value if the driver does not know. Used by the dynamic
+    // rate control, see `CoreOptions::audioRateControl`.
+    virtual double bufferFill() { return -1.0; }
 };
 
 #endif  // VBAM_CORE_BASE_SOUND_DRIVER_H_
@@ -0,0 +1,124 @@
+#include "core/base/spsc_ring.h"
+
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+TEST(SpscRingTest, KeepsTheRequestedCapacity) {
+    SpscRing<int16_t> ring(1000);
+
+    EXPECT_EQ(ring.capacity(), 1000);
+    EXPECT_EQ(ring.size(), 0);
+    EXPECT_EQ(ring.write_avail(), 1000);
+    EXPECT_EQ(ring.read_avail(), 0);
+}
+
+TEST(SpscRingTest, NonPowerOfTwoCapacity) {
+    SpscRing<int> ring(6);
+    std::vector<int> out(8);
+    int next = 0;
+    int expected = 0;
+
+    for (int round = 0; round < 10; round++) {
+        std::vector<int> in(8);
+        for (int& value : in) {
+            value = next;
+            next++;
+        }
+        // Only 6 of the 8 values fit, even though the storage is 8 long.
+        ASSERT_EQ(ring.write(in.data(), in.size()), 6);
+        ASSERT_EQ(ring.write_avail(), 0);
+        ASSERT_EQ(ring.size(), 6);
+        next -= 2;
+
+        ASSERT_EQ(ring.read(out.data(), 5), 5);
+        for (int i = 0; i < 5; i++) {
+            ASSERT_EQ(out[i], expected++);
+        }
+        ASSERT_EQ(ring.write_avail(), 5);
+        ASSERT_EQ(ring.read(out.data(), 8), 1);
+        ASSERT_EQ(out[0], expected++);
+    }
+}
+
+TEST(SpscRingTest, WrapsAround) {
+    SpscRing<int> ring(8);
+    std::vector<int> out(8);
+    int next = 0;
+    int expected = 0;
+
+    for (int round = 0; round < 10; round++) {
+        std::vector<int> in(5);
+        for (int& value : in) {
+            value = next++;
+        }
+        ASSERT_EQ(ring.write(in.data(), in.size()), 5);
+        ASSERT_EQ(ring.read(out.data(), 5), 5);
+        for (int i = 0; i < 5; i++) {
+            ASSERT_EQ(out[i], expected++);
+        }
+    }
+}
+
+TEST(SpscRingTest, WriteStopsWhenFull) {
+    SpscRing<int> ring(4);
+    const int in[6] = {1, 2, 3, 4, 5, 6};
+    int out[6] = {};
+
+    EXPECT_EQ(ring.write(in, 6), 4);
+    EXPECT_EQ(ring.write_avail(), 0);
+    EXPECT_EQ(ring.read(out, 6), 4);
+    EXPECT_EQ(out[3], 4);
+    EXPECT_EQ(ring.read(out, 6), 0);
+}
+
+TEST(SpscRingTest, SizeSeesTheReadsOfTheConsumer) {
+    SpscRing<int> ring(16);
+    const std::vector<int> in(12, 7);
+    std::vector<int> out(12);
+
+    ASSERT_EQ(ring.write(in.data(), in.size()), 12);
+    // The producer keeps its cached read position until the ring looks full.
+    ASSERT_EQ(ring.write_avail(), 4);
+    ASSERT_EQ(ring.read(out.data(), 10), 10);
+
+    EXPECT_EQ(ring.size(), 2);
+}
+
+TEST(SpscRingTest, TransfersBetweenThreads) {
+    constexpr int kCount = 100000;
+    SpscRing<int> ring(64);
+
+    std::thread producer([&ring] {
+        int next = 0;
+        while (next < kCount) {
+            int chunk[7];
+            int count = 0;
+            while (count < 7 && next + count < kCount) {
+                chunk[count] = next + count;
+                count++;
+            }
+            const size_t written = ring.write(chunk, count);
+            if (written == 0) {
+                std::this_thread::yield();
+            }
+            next += static_cast<int>(written);
+        }
+    });
+
+    int expected = 0;
+    while (expected < kCount) {
+        int chunk[5];
+        const size_t count = ring.read(chunk, 5);
+        if (count == 0) {
+            std::this_thread::yield();
+        }
+        for (size_t i = 0; i < count; i++) {
+            EXPECT_EQ(chunk[i], expected++);
+        }
+    }
+    producer.join();
+    EXPECT_EQ(ring.size(), 0);
+}
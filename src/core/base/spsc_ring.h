@@ -0,0 +1,125 @@
+#ifndef VBAM_CORE_BASE_SPSC_RING_H_
+#define VBAM_CORE_BASE_SPSC_RING_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// A ring buffer between one producer thread and one consumer thread, which
+// never lock nor wait for each other. Used by the sound drivers between the
+// emulation thread and the audio callback thread.
+//
+// The positions only grow, and each thread owns one of them. They are kept in
+// separate cache lines, each with the cached copy of the other position that
+// its thread uses, so that the threads only share a cache line when the
+// cached copy is out of date.
+//
+// The storage is rounded up to a power of two to index it with a mask, but
+// the ring never holds more than the capacity asked for, which sets the
+// latency of the sound drivers.
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity = 0) { reset(capacity); }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Empties the ring, with room for `capacity` values. Only when neither
+    // thread uses it.
+    void reset(size_t capacity) {
+        size_t size = capacity ? 1 : 0;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        buffer_.assign(size, T());
+        mask_ = size ? size - 1 : 0;
+        capacity_ = capacity;
+
+        write_pos_.store(0, std::memory_order_relaxed);
+        read_pos_.store(0, std::memory_order_relaxed);
+        cached_read_pos_ = 0;
+        cached_write_pos_ = 0;
+    }
+
+    size_t capacity() const { return capacity_; }
+
+    // Either thread: the number of values in the ring. Unlike write_avail()
+    // and read_avail(), which only refresh the cached position of the other
+    // thread when they have to, this always loads both positions.
+    size_t size() const {
+        // The read position is loaded first, it never passes the write one.
+        const size_t read_pos = read_pos_.load(std::memory_order_acquire);
+        return write_pos_.load(std::memory_order_acquire) - read_pos;
+    }
+
+    // Producer: the number of values that can be written.
+    size_t write_avail() {
+        const size_t write_pos = write_pos_.load(std::memory_order_relaxed);
+        if (write_pos - cached_read_pos_ == capacity()) {
+            cached_read_pos_ = read_pos_.load(std::memory_order_acquire);
+        }
+        return capacity() - (write_pos - cached_read_pos_);
+    }
+
+    // Producer: writes up to `count` values, returns the number written.
+    size_t write(const T* data, size_t count) {
+        const size_t write_pos = write_pos_.load(std::memory_order_relaxed);
+        if (write_pos - cached_read_pos_ + count > capacity()) {
+            cached_read_pos_ = read_pos_.load(std::memory_order_acquire);
+        }
+        count = std::min(count, capacity() - (write_pos - cached_read_pos_));
+
+        const size_t start = write_pos & mask_;
+        const size_t first = std::min(count, buffer_.size() - start);
+        std::copy(data, data + first, buffer_.begin() + start);
+        std::copy(data + first, data + count, buffer_.begin());
+
+        write_pos_.store(write_pos + count, std::memory_order_release);
+        return count;
+    }
+
+    // Consumer: the number of values that can be read.
+    size_t read_avail() {
+        const size_t read_pos = read_pos_.load(std::memory_order_relaxed);
+        if (cached_write_pos_ == read_pos) {
+            cached_write_pos_ = write_pos_.load(std::memory_order_acquire);
+        }
+        return cached_write_pos_ - read_pos;
+    }
+
+    // Consumer: reads up to `count` values, returns the number read.
+    size_t read(T* data, size_t count) {
+        const size_t read_pos = read_pos_.load(std::memory_order_relaxed);
+        if (cached_write_pos_ - read_pos < count) {
+            cached_write_pos_ = write_pos_.load(std::memory_order_acquire);
+        }
+        count = std::min(count, cached_write_pos_ - read_pos);
+
+        const size_t start = read_pos & mask_;
+        const size_t first = std::min(count, buffer_.size() - start);
+        std::copy(buffer_.begin() + start, buffer_.begin() + start + first, data);
+        std::copy(buffer_.begin(), buffer_.begin() + (count - first), data + first);
+
+        read_pos_.store(read_pos + count, std::memory_order_release);
+        return count;
+    }
+
+private:
+    static constexpr size_t kCacheLineSize = 64;
+
+    std::vector<T> buffer_;
+    size_t mask_ = 0;
+    size_t capacity_ = 0;
+
+    // Owned by the producer.
+    alignas(kCacheLineSize) std::atomic<size_t> write_pos_{0};
+    size_t cached_read_pos_ = 0;
+
+    // Owned by the consumer.
+    alignas(kCacheLineSize) std::atomic<size_t> read_pos_{0};
+    size_t cached_write_pos_ = 0;
+};
+
+#endif  // VBAM_CORE_BASE_SPSC_RING_H_
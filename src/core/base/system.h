@@ -57,8 +57,19 @@ extern struct CoreOptions {
     bool skipBios = false;
     bool parseDebug = true;
     bool speedHack = false;
+    bool skipIdleLoops = false;
     bool speedup = false;
     bool speedup_throttle_frame_skip = false;
+    bool threadedRender = false;
+    // Skip all the video output. Emulation timing is not affected.
+    bool videoOff = false;
+    // Skip all the audio output: the sound channels keep running, but
+    // nothing is synthesized or mixed. Emulation is not affected.
+    bool audioOff = false;
+    // Dynamic rate control: resample the audio up to 0.5% faster or slower
+    // to keep the sound driver buffer half full. The emulation can then be
+    // paced by the video, without audio underruns or the driver blocking.
+    bool audioRateControl = false;
     int cheatsEnabled = 1;
     int cpuDisableSfx = 0;
     int cpuSaveType = 0;
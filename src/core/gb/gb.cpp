@@ -8,8 +8,10 @@
 #include <vector>
 
 #include "core/base/check.h"
+#include "core/base/color_convert.h"
 #include "core/base/file_util.h"
 #include "core/base/message.h"
+#include "core/base/run_ahead.h"
 #include "core/base/sizes.h"
 #include "core/base/system.h"
 #include "core/gb/gbCheats.h"
@@ -332,7 +334,7 @@ bool gbInitializeRom(size_t romSize) {
     // is necessary for some ROM hacks.
     const size_t romHeaderSize = g_gbCartData.rom_size();
     if (romSize < romHeaderSize) {
-        uint8_t* gbRomNew = (uint8_t*)realloc(gbRom, romHeaderSize);
+        uint8_t* gbRomNew = utilReallocImage(gbRom, romHeaderSize);
         if (!gbRomNew) {
             return false;
         };
@@ -1187,6 +1189,11 @@ static const uint16_t gbColorizationPaletteData[32][3][4] = {
 #define GBSAVE_GAME_VERSION_12 12
 #define GBSAVE_GAME_VERSION GBSAVE_GAME_VERSION_12
 
+// Version of the raw in-memory states, they are not compatible with the save
+// game files.
+#define GBSAVE_GAME_RAW_VERSION_1 0x10001
+#define GBSAVE_GAME_RAW_VERSION GBSAVE_GAME_RAW_VERSION_1
+
 void setColorizerHack(bool value)
 {
     allow_colorizer_hack = value;
@@ -3335,29 +3342,9 @@ static bool gbWriteSaveState(gzFile gzFile)
     return true;
 }
 
-bool gbWriteMemSaveState(char* memory, int available, long& reserved)
-{
-    gzFile gzFile = utilMemGzOpen(memory, available, "w");
-
-    if (gzFile == NULL) {
-        return false;
-    }
-
-    bool res = gbWriteSaveState(gzFile);
-
-    reserved = utilGzMemTell(gzFile) + 8;
-
-    if (reserved >= (available))
-        res = false;
-
-    utilGzClose(gzFile);
-
-    return res;
-}
-
 bool gbWriteSaveState(const char* name)
 {
-    gzFile gzFile = utilGzOpen(name, "wb");
+    gzFile gzFile = utilGzOpenAsync(name);
 
     if (gzFile == NULL)
         return false;
@@ -3704,17 +3691,6 @@ static bool gbReadSaveState(gzFile gzFile)
     return true;
 }
 
-bool gbReadMemSaveState(char* memory, int available)
-{
-    gzFile gzFile = utilMemGzOpen(memory, available, "r");
-
-    bool res = gbReadSaveState(gzFile);
-
-    utilGzClose(gzFile);
-
-    return res;
-}
-
 bool gbReadSaveState(const char* name)
 {
     gzFile gzFile = utilGzOpen(name, "rb");
@@ -3753,7 +3729,7 @@ void gbCleanUp()
     }
 
     if (gbRom != nullptr) {
-        free(gbRom);
+        utilFreeImage(gbRom);
         gbRom = nullptr;
     }
 
@@ -3815,7 +3791,13 @@ bool gbLoadRom(const char* filename) {
 
     systemSaveUpdateCounter = SYSTEM_SAVE_NOT_UPDATED;
 
-    gbRom = utilLoad(filename, utilIsGBImage, nullptr, romSize);
+#if !defined(__LIBRETRO__)
+    // Plain ROM files can be mapped rather than read, so that the instances
+    // running the same game share the ROM pages.
+    gbRom = utilMapImage(filename, utilIsGBImage, 0, romSize);
+#endif
+    if (!gbRom)
+        gbRom = utilLoad(filename, utilIsGBImage, nullptr, romSize);
     if (!gbRom)
         return false;
 
@@ -3890,27 +3872,8 @@ void gbDrawLine()
         uint16_t* dest = (uint16_t*)g_pix + (gbBorderLineSkip + 2) * (register_LY + gbBorderRowSkip + 1)
             + gbBorderColumnSkip;
 #endif
-        for (size_t x = 0; x < kGBWidth;) {
-            *dest++ = systemColorMap16[gbLineMix[x++]];
-            *dest++ = systemColorMap16[gbLineMix[x++]];
-            *dest++ = systemColorMap16[gbLineMix[x++]];
-            *dest++ = systemColorMap16[gbLineMix[x++]];
-
-            *dest++ = systemColorMap16[gbLineMix[x++]];
-            *dest++ = systemColorMap16[gbLineMix[x++]];
-            *dest++ = systemColorMap16[gbLineMix[x++]];
-            *dest++ = systemColorMap16[gbLineMix[x++]];
-
-            *dest++ = systemColorMap16[gbLineMix[x++]];
-            *dest++ = systemColorMap16[gbLineMix[x++]];
-            *dest++ = systemColorMap16[gbLineMix[x++]];
-            *dest++ = systemColorMap16[gbLineMix[x++]];
-
-            *dest++ = systemColorMap16[gbLineMix[x++]];
-            *dest++ = systemColorMap16[gbLineMix[x++]];
-            *dest++ = systemColorMap16[gbLineMix[x++]];
-            *dest++ = systemColorMap16[gbLineMix[x++]];
-        }
+        colorConvertLine16(gbLineMix, dest, kGBWidth);
+        dest += kGBWidth;
         if (gbBorderOn)
             dest += gbBorderColumnSkip;
 #ifndef __LIBRETRO__
@@ -3920,43 +3883,7 @@ void gbDrawLine()
 
     case 24: {
         uint8_t* dest = (uint8_t*)g_pix + 3 * (gbBorderLineSkip * (register_LY + gbBorderRowSkip) + gbBorderColumnSkip);
-        for (size_t x = 0; x < kGBWidth;) {
-            *((uint32_t*)dest) = systemColorMap32[gbLineMix[x++]];
-            dest += 3;
-            *((uint32_t*)dest) = systemColorMap32[gbLineMix[x++]];
-            dest += 3;
-            *((uint32_t*)dest) = systemColorMap32[gbLineMix[x++]];
-            dest += 3;
-            *((uint32_t*)dest) = systemColorMap32[gbLineMix[x++]];
-            dest += 3;
-
-            *((uint32_t*)dest) = systemColorMap32[gbLineMix[x++]];
-            dest += 3;
-            *((uint32_t*)dest) = systemColorMap32[gbLineMix[x++]];
-            dest += 3;
-            *((uint32_t*)dest) = systemColorMap32[gbLineMix[x++]];
-            dest += 3;
-            *((uint32_t*)dest) = systemColorMap32[gbLineMix[x++]];
-            dest += 3;
-
-            *((uint32_t*)dest) = systemColorMap32[gbLineMix[x++]];
-            dest += 3;
-            *((uint32_t*)dest) = systemColorMap32[gbLineMix[x++]];
-            dest += 3;
-            *((uint32_t*)dest) = systemColorMap32[gbLineMix[x++]];
-            dest += 3;
-            *((uint32_t*)dest) = systemColorMap32[gbLineMix[x++]];
-            dest += 3;
-
-            *((uint32_t*)dest) = systemColorMap32[gbLineMix[x++]];
-            dest += 3;
-            *((uint32_t*)dest) = systemColorMap32[gbLineMix[x++]];
-            dest += 3;
-            *((uint32_t*)dest) = systemColorMap32[gbLineMix[x++]];
-            dest += 3;
-            *((uint32_t*)dest) = systemColorMap32[gbLineMix[x++]];
-            dest += 3;
-        }
+        colorConvertLine24(gbLineMix, dest, kGBWidth);
     } break;
 
     case 32: {
@@ -3967,27 +3894,7 @@ void gbDrawLine()
         uint32_t* dest = (uint32_t*)g_pix + (gbBorderLineSkip + 1) * (register_LY + gbBorderRowSkip + 1)
             + gbBorderColumnSkip;
 #endif
-        for (size_t x = 0; x < kGBWidth;) {
-            *dest++ = systemColorMap32[gbLineMix[x++]];
-            *dest++ = systemColorMap32[gbLineMix[x++]];
-            *dest++ = systemColorMap32[gbLineMix[x++]];
-            *dest++ = systemColorMap32[gbLineMix[x++]];
-
-            *dest++ = systemColorMap32[gbLineMix[x++]];
-            *dest++ = systemColorMap32[gbLineMix[x++]];
-            *dest++ = systemColorMap32[gbLineMix[x++]];
-            *dest++ = systemColorMap32[gbLineMix[x++]];
-
-            *dest++ = systemColorMap32[gbLineMix[x++]];
-            *dest++ = systemColorMap32[gbLineMix[x++]];
-            *dest++ = systemColorMap32[gbLineMix[x++]];
-            *dest++ = systemColorMap32[gbLineMix[x++]];
-
-            *dest++ = systemColorMap32[gbLineMix[x++]];
-            *dest++ = systemColorMap32[gbLineMix[x++]];
-            *dest++ = systemColorMap32[gbLineMix[x++]];
-            *dest++ = systemColorMap32[gbLineMix[x++]];
-        }
+        colorConvertLine32(gbLineMix, dest, kGBWidth);
     } break;
     }
 }
@@ -4411,21 +4318,24 @@ void gbEmulate(int ticksToStop)
                             gbLcdTicksDelayed += GBLCD_MODE_1_CLOCK_TICKS;
                             gbLcdModeDelayed = 1;
 
-                            gbFrameCount++;
-                            systemFrame();
                             gbSoundTick(soundTicks);
 
-                            if ((gbFrameCount % 10) == 0)
-                                system10Frames();
-
-                            if (gbFrameCount >= 60) {
-                                uint32_t currentTime = systemGetClock();
-                                if (currentTime != gbLastTime)
-                                    systemShowSpeed(100000 / (currentTime - gbLastTime));
-                                else
-                                    systemShowSpeed(0);
-                                gbLastTime = currentTime;
-                                gbFrameCount = 0;
+                            if (RunAhead::ReportFrame()) {
+                                gbFrameCount++;
+                                systemFrame();
+
+                                if ((gbFrameCount % 10) == 0)
+                                    system10Frames();
+
+                                if (gbFrameCount >= 60) {
+                                    uint32_t currentTime = systemGetClock();
+                                    if (currentTime != gbLastTime)
+                                        systemShowSpeed(100000 / (currentTime - gbLastTime));
+                                    else
+                                        systemShowSpeed(0);
+                                    gbLastTime = currentTime;
+                                    gbFrameCount = 0;
+                                }
                             }
 
                             int newmask = gbJoymask[0] & 255;
@@ -4449,21 +4359,23 @@ void gbEmulate(int ticksToStop)
                             }
                             gbCapturePrevious = gbCapture;
 
-                            if (gbFrameSkipCount >= framesToSkip) {
+                            if (!coreOptions.videoOff) {
+                                if (gbFrameSkipCount >= framesToSkip) {
 
-                                if (!gbSgbMask) {
-                                    if (gbBorderOn)
-                                        gbSgbRenderBorder();
-                                    //if (gbScreenOn)
-                                    systemDrawScreen();
-                                    if (systemPauseOnFrame())
-                                        ticksToStop = 0;
+                                    if (!gbSgbMask) {
+                                        if (gbBorderOn)
+                                            gbSgbRenderBorder();
+                                        //if (gbScreenOn)
+                                        systemDrawScreen();
+                                    }
+                                    gbFrameSkipCount = 0;
+                                } else {
+                                    gbFrameSkipCount++;
+                                    systemSendScreen();
                                 }
-                                gbFrameSkipCount = 0;
-                            } else {
-                                gbFrameSkipCount++;
-                                systemSendScreen();
                             }
+                            if (systemPauseOnFrame())
+                                ticksToStop = 0;
 
                             frameDone = true;
 
@@ -4499,10 +4411,13 @@ void gbEmulate(int ticksToStop)
                         // OAM and VRAM in use
                         // next mode is H-Blank
                         if ((register_LY < kGBHeight) && (register_LCDC & 0x80) && gbScreenOn) {
-                            if (!gbSgbMask) {
+                            // The window line counter is emulated state, keep
+                            // it going on the lines that are not drawn.
+                            const int windowLine = gbUpdateWindowLine();
+                            if (!gbSgbMask && !coreOptions.videoOff) {
                                 if (gbFrameSkipCount >= framesToSkip) {
                                     if (!gbBlackScreen) {
-                                        gbRenderLine();
+                                        gbRenderLine(windowLine);
                                         gbDrawSprites(true);
                                     } else if (gbBlackScreen) {
                                         uint16_t color = gbColorOption ? gbColorFilter[0] : 0;
@@ -4569,7 +4484,7 @@ void gbEmulate(int ticksToStop)
                 if (gbScreenTicks <= 0) {
                     gbWhiteScreen = 1;
                     uint8_t register_LYLcdOff = ((register_LY + 154) % 154);
-                    for (register_LY = 0; register_LY <= 0x90; register_LY++) {
+                    for (register_LY = 0; register_LY <= 0x90 && !coreOptions.videoOff; register_LY++) {
                         uint16_t color = gbColorOption ? gbColorFilter[0x7FFF] : 0x7FFF;
                         if (!gbCgbMode)
                             color = gbColorOption ? gbColorFilter[gbPalette[0] & 0x7FFF] : gbPalette[0] & 0x7FFF;
@@ -4590,6 +4505,8 @@ void gbEmulate(int ticksToStop)
                     register_LY = ((register_LY + 1) % 154);
                     gbLcdLYIncrementTicks += GBLY_INCREMENT_CLOCK_TICKS;
                     if (register_LY < kGBHeight) {
+                        if (coreOptions.videoOff)
+                            continue;
 
                         uint16_t color = gbColorOption ? gbColorFilter[0x7FFF] : 0x7FFF;
                         if (!gbCgbMode)
@@ -4606,34 +4523,36 @@ void gbEmulate(int ticksToStop)
                         if ((gbFrameSkipCount >= framesToSkip) || (gbWhiteScreen == 1)) {
                             gbWhiteScreen = 2;
 
-                            if (!gbSgbMask) {
+                            if (!gbSgbMask && !coreOptions.videoOff) {
                                 if (gbBorderOn)
                                     gbSgbRenderBorder();
                                 //if (gbScreenOn)
                                 systemDrawScreen();
-                                if (systemPauseOnFrame())
-                                    ticksToStop = 0;
                             }
-                        } else {
+                        } else if (!coreOptions.videoOff) {
                             systemSendScreen();
                         }
+                        if (systemPauseOnFrame())
+                            ticksToStop = 0;
 
-                        gbFrameCount++;
-
-                        systemFrame();
                         gbSoundTick(soundTicks);
 
-                        if ((gbFrameCount % 10) == 0)
-                            system10Frames();
-
-                        if (gbFrameCount >= 60) {
-                            uint32_t currentTime = systemGetClock();
-                            if (currentTime != gbLastTime)
-                                systemShowSpeed(100000 / (currentTime - gbLastTime));
-                            else
-                                systemShowSpeed(0);
-                            gbLastTime = currentTime;
-                            gbFrameCount = 0;
+                        if (RunAhead::ReportFrame()) {
+                            gbFrameCount++;
+                            systemFrame();
+
+                            if ((gbFrameCount % 10) == 0)
+                                system10Frames();
+
+                            if (gbFrameCount >= 60) {
+                                uint32_t currentTime = systemGetClock();
+                                if (currentTime != gbLastTime)
+                                    systemShowSpeed(100000 / (currentTime - gbLastTime));
+                                else
+                                    systemShowSpeed(0);
+                                gbLastTime = currentTime;
+                                gbFrameCount = 0;
+                            }
                         }
                         frameDone = true;
                     }
@@ -4949,14 +4868,41 @@ bool gbApplyPatch(const char* patchName) {
 }
 #endif  // __LIBRETRO__
 
-#ifdef __LIBRETRO__
-#include <stddef.h>
+unsigned int gbStateSize()
+{
+    unsigned int size = 3 * sizeof(int) + 15 + utilDataSize(gbSaveGameStruct) + 2;
+
+    if (gbSgbMode)
+        size += gbSgbStateSize();
+
+    size += sizeof(gbDataMBC1) + sizeof(gbDataMBC2) + sizeof(gbDataMBC3) +
+        sizeof(gbDataMBC5) + sizeof(gbDataHuC1) + sizeof(gbDataHuC3);
+    if (g_gbCartData.mapper_type() == gbCartData::MapperType::kHuC3)
+        size += sizeof(gbRTCHuC3);
+    size += sizeof(gbDataTAMA5);
+    if (gbTAMA5ram != nullptr)
+        size += kTama5RamSize;
+    size += sizeof(gbDataMMM01);
+
+    size += sizeof(gbPalette) + 0x8000;
+
+    if (g_gbCartData.HasRam())
+        size += sizeof(int) + g_gbCartData.ram_size();
+
+    if (gbCgbMode)
+        size += kGBVRamSize + kGBWRamSize;
+
+    size += gbSoundStateSize();
+
+    // LCD and timer state, and the end marker.
+    return size + 13 * sizeof(int);
+}
 
 unsigned int gbWriteSaveState(uint8_t* data)
 {
-	uint8_t* orig = data;
+    uint8_t* orig = data;
 
-    utilWriteIntMem(data, GBSAVE_GAME_VERSION);
+    utilWriteIntMem(data, GBSAVE_GAME_RAW_VERSION);
 
     utilWriteMem(data, &gbRom[0x134], 15);
 
@@ -5017,14 +4963,15 @@ unsigned int gbWriteSaveState(uint8_t* data)
     utilWriteIntMem(data, gbScreenOn);
     utilWriteIntMem(data, 0x12345678); // end marker
 
-	return (ptrdiff_t)data - (ptrdiff_t)orig;
+    return (unsigned int)(data - orig);
 }
 
 bool gbReadSaveState(const uint8_t* data)
 {
     int version = utilReadIntMem(data);
 
-   if (version != GBSAVE_GAME_VERSION) {
+    // Older libretro builds wrote the same layout with the save game version.
+    if (version != GBSAVE_GAME_RAW_VERSION && version != GBSAVE_GAME_VERSION) {
         systemMessage(MSG_UNSUPPORTED_VB_SGM,
             N_("Unsupported VBA-M save game version %d"), version);
         return false;
@@ -5241,14 +5188,33 @@ bool gbReadSaveState(const uint8_t* data)
 
     systemSaveUpdateCounter = SYSTEM_SAVE_NOT_UPDATED;
 
-    if (version >= 12 && utilReadIntMem(data) != 0x12345678) {
+    if (utilReadIntMem(data) != 0x12345678) {
         // fails if something read too much/little from file
         return false;
     }
 
     return true;
 }
-#endif /* __LIBRETRO__ */
+
+bool gbWriteMemSaveState(char* memory, int available, long& reserved)
+{
+    reserved = gbStateSize();
+
+    if (reserved > available)
+        return false;
+
+    gbWriteSaveState((uint8_t*)memory);
+
+    return true;
+}
+
+bool gbReadMemSaveState(char* memory, int available)
+{
+    if (available < (int)gbStateSize())
+        return false;
+
+    return gbReadSaveState((const uint8_t*)memory);
+}
 
 struct EmulatedSystem GBSystem = {
     // emuMain
@@ -5262,8 +5228,8 @@ struct EmulatedSystem GBSystem = {
     NULL,               // emuWriteBattery
     gbReadSaveState,    // emuReadState
     gbWriteSaveState,   // emuWriteState
-    NULL,               // emuReadMemState
-    NULL,               // emuWriteMemState
+    gbReadMemSaveState, // emuReadMemState
+    gbWriteMemSaveState, // emuWriteMemState
     NULL,               // emuWritePNG
     NULL,               // emuWriteBMP
 #else    
@@ -52,6 +52,12 @@ void gbCPUInit(const char*, bool);
 void gbSgbRenderBorder();
 bool gbReadGSASnapshot(const char*);
 
+// Raw in-memory states, without the derived data such as the frame buffer.
+// They have a fixed layout and gbStateSize() bytes for the loaded game.
+unsigned int gbStateSize();
+bool gbReadSaveState(const uint8_t*);
+unsigned int gbWriteSaveState(uint8_t*);
+
 // Allows invalid vram/palette access needed for Colorizer hacked games in GBC/GBA hardware
 void setColorizerHack(bool value);
 bool allowColorizerHack(void);
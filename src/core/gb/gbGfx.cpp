@@ -45,7 +45,41 @@ uint16_t gbLineMix[160];
 uint16_t gbWindowColor[160];
 extern int inUseRegister_WY;
 
-void gbRenderLine()
+int gbUpdateWindowLine()
+{
+    if (!(register_LCDC & 0x80) || register_LY >= 144)
+        return -1;
+
+    // LCDC.0 also enables/disables the window in !gbCgbMode ?!?!
+    // (tested on real hardware)
+    // This fixes Last Bible II & Zankurou Musouken
+    if ((register_LCDC & 0x01 || gbCgbMode) && (register_LCDC & 0x20) && (gbWindowLine != -2)) {
+        // Fix (accurate emulation) for most of the window display problems
+        // (ie. Zen - Intergalactic Ninja, Urusei Yatsura...).
+        if ((gbWindowLine == -1) || (gbWindowLine > 144)) {
+            inUseRegister_WY = oldRegister_WY;
+            if (register_LY > oldRegister_WY)
+                gbWindowLine = 146;
+        }
+
+        if (register_LY >= inUseRegister_WY) {
+            if ((gbWindowLine == -1) || (gbWindowLine > 144))
+                gbWindowLine = 0;
+
+            if (register_WX - 7 <= 159 && gbWindowLine <= 143)
+                return gbWindowLine++;
+        }
+    } else if (gbWindowLine == -2) {
+        inUseRegister_WY = oldRegister_WY;
+        if (register_LY > oldRegister_WY)
+            gbWindowLine = 146;
+        else
+            gbWindowLine = 0;
+    }
+    return -1;
+}
+
+void gbRenderLine(int windowLine)
 {
     memset(gbLineMix, 0, sizeof(gbLineMix));
     uint8_t* bank0;
@@ -213,177 +247,147 @@ void gbRenderLine()
         }
 
         // do the window display
-        // LCDC.0 also enables/disables the window in !gbCgbMode ?!?!
-        // (tested on real hardware)
-        // This fixes Last Bible II & Zankurou Musouken
-        if ((register_LCDC & 0x01 || gbCgbMode) && (register_LCDC & 0x20) && (coreOptions.layerSettings & 0x2000) && (gbWindowLine != -2)) {
+        if (windowLine >= 0 && (coreOptions.layerSettings & 0x2000)) {
             int i = 0;
-            // Fix (accurate emulation) for most of the window display problems
-            // (ie. Zen - Intergalactic Ninja, Urusei Yatsura...).
-            if ((gbWindowLine == -1) || (gbWindowLine > 144)) {
-                inUseRegister_WY = oldRegister_WY;
-                if (register_LY > oldRegister_WY)
-                    gbWindowLine = 146;
-                // for (i = 0; i<160; i++)
-                //   gbWindowColor[i] = gbLineMix[i];
-            }
-
             int wy = inUseRegister_WY;
+            int wx = register_WX;
+            int swx = 0;
+            wx -= 7;
 
-            if (y >= inUseRegister_WY) {
+            tile_map = 0x1800;
 
-                if ((gbWindowLine == -1) || (gbWindowLine > 144))
-                    gbWindowLine = 0;
+            if ((register_LCDC & 0x40) != 0)
+                tile_map = 0x1c00;
 
-                int wx = register_WX;
-                int swx = 0;
-                wx -= 7;
+            tx = 0;
+            ty = windowLine >> 3;
 
-                if (wx <= 159 && gbWindowLine <= 143) {
+            bx = 128;
+            by = windowLine & 7;
 
-                    tile_map = 0x1800;
+            // Tries to emulate the 'window scrolling bug' when wx == 0 (ie. wx-7 == -7).
+            // Nothing close to perfect, but good enought for now...
+            if (wx == -7) {
+                swx = 7 - ((gbSCXLine[0] - 1) & 7);
+                bx >>= ((gbSCXLine[0] + ((swx != 1) ? 1 : 0)) & 7);
+                if (swx == 1)
+                    swx = 2;
 
-                    if ((register_LCDC & 0x40) != 0)
-                        tile_map = 0x1c00;
-
-                    tx = 0;
-                    ty = gbWindowLine >> 3;
+                //bx >>= ((gbSCXLine[0]+(((swx>1) && (swx != 7)) ? 1 : 0)) & 7);
 
-                    bx = 128;
-                    by = gbWindowLine & 7;
+                if (swx == 7) {
+                    //wx = 0;
+                    if ((windowLine > 0) || (wy == 0))
+                        swx = 0;
+                }
+            } else if (wx < 0) {
+                bx >>= (-wx);
+                wx = 0;
+            }
 
-                    // Tries to emulate the 'window scrolling bug' when wx == 0 (ie. wx-7 == -7).
-                    // Nothing close to perfect, but good enought for now...
-                    if (wx == -7) {
-                        swx = 7 - ((gbSCXLine[0] - 1) & 7);
-                        bx >>= ((gbSCXLine[0] + ((swx != 1) ? 1 : 0)) & 7);
-                        if (swx == 1)
-                            swx = 2;
+            tile_map_line_y = tile_map + ty * 32;
 
-                        //bx >>= ((gbSCXLine[0]+(((swx>1) && (swx != 7)) ? 1 : 0)) & 7);
+            tile_map_address = tile_map_line_y + tx;
 
-                        if (swx == 7) {
-                            //wx = 0;
-                            if ((gbWindowLine > 0) || (wy == 0))
-                                swx = 0;
-                        }
-                    } else if (wx < 0) {
-                        bx >>= (-wx);
-                        wx = 0;
-                    }
+            x = wx;
 
-                    tile_map_line_y = tile_map + ty * 32;
+            tile = bank0[tile_map_address];
+            uint8_t attrs = 0;
+            if (bank1)
+                attrs = bank1[tile_map_address];
+            tile_map_address++;
 
-                    tile_map_address = tile_map_line_y + tx;
+            if ((register_LCDC & 16) == 0) {
+                if (tile < 128)
+                    tile += 128;
+                else
+                    tile -= 128;
+            }
 
-                    x = wx;
+            tile_pattern_address = tile_pattern + tile * 16 + by * 2;
 
-                    tile = bank0[tile_map_address];
-                    uint8_t attrs = 0;
-                    if (bank1)
-                        attrs = bank1[tile_map_address];
-                    tile_map_address++;
+            if (wx)
+                for (i = 0; i < swx; i++)
+                    gbLineMix[i] = gbWindowColor[i];
 
-                    if ((register_LCDC & 16) == 0) {
-                        if (tile < 128)
-                            tile += 128;
-                        else
-                            tile -= 128;
-                    }
+            while (x < 160) {
+                uint8_t tile_a = 0;
+                uint8_t tile_b = 0;
 
-                    tile_pattern_address = tile_pattern + tile * 16 + by * 2;
+                if (attrs & 0x40) {
+                    tile_pattern_address = tile_pattern + tile * 16 + (7 - by) * 2;
+                }
 
-                    if (wx)
-                        for (i = 0; i < swx; i++)
-                            gbLineMix[i] = gbWindowColor[i];
+                if (attrs & 0x08) {
+                    tile_a = bank1[tile_pattern_address++];
+                    tile_b = bank1[tile_pattern_address];
+                } else {
+                    tile_a = bank0[tile_pattern_address++];
+                    tile_b = bank0[tile_pattern_address];
+                }
 
-                    while (x < 160) {
-                        uint8_t tile_a = 0;
-                        uint8_t tile_b = 0;
+                if (attrs & 0x20) {
+                    tile_a = gbInvertTab[tile_a];
+                    tile_b = gbInvertTab[tile_b];
+                }
 
-                        if (attrs & 0x40) {
-                            tile_pattern_address = tile_pattern + tile * 16 + (7 - by) * 2;
-                        }
+                while (bx > 0) {
+                    uint8_t c = (tile_a & bx) != 0 ? 1 : 0;
+                    c += ((tile_b & bx) != 0 ? 2 : 0);
 
-                        if (attrs & 0x08) {
-                            tile_a = bank1[tile_pattern_address++];
-                            tile_b = bank1[tile_pattern_address];
+                    if (x >= 0) {
+                        if (attrs & 0x80)
+                            gbLineBuffer[x] = 0x300 + c;
+                        else
+                            gbLineBuffer[x] = 0x100 + c;
+
+                        if (gbCgbMode) {
+                            // Use the DMG palette if we are in compat mode.
+                            if (gbMemory[0xff6c] & 1) {
+                                c = gbBgp[c];
+                            } else {
+                                c = c + (attrs & 7) * 4;
+                            }
                         } else {
-                            tile_a = bank0[tile_pattern_address++];
-                            tile_b = bank0[tile_pattern_address];
-                        }
+                            c = (gbBgpLine[x + (gbSpeed ? 5 : 11) + gbSpritesTicks[x] * (gbSpeed ? 2 : 4)] >> (c << 1)) & 3;
+                            if (gbSgbMode && !gbCgbMode) {
+                                int dx = x >> 3;
+                                int dy = y >> 3;
 
-                        if (attrs & 0x20) {
-                            tile_a = gbInvertTab[tile_a];
-                            tile_b = gbInvertTab[tile_b];
-                        }
+                                int palette = gbSgbATF[dy * 20 + dx];
 
-                        while (bx > 0) {
-                            uint8_t c = (tile_a & bx) != 0 ? 1 : 0;
-                            c += ((tile_b & bx) != 0 ? 2 : 0);
+                                if (c == 0)
+                                    palette = 0;
 
-                            if (x >= 0) {
-                                if (attrs & 0x80)
-                                    gbLineBuffer[x] = 0x300 + c;
-                                else
-                                    gbLineBuffer[x] = 0x100 + c;
-
-                                if (gbCgbMode) {
-                                    // Use the DMG palette if we are in compat mode.
-                                    if (gbMemory[0xff6c] & 1) {
-                                        c = gbBgp[c];
-                                    } else {
-                                        c = c + (attrs & 7) * 4;
-                                    }
-                                } else {
-                                    c = (gbBgpLine[x + (gbSpeed ? 5 : 11) + gbSpritesTicks[x] * (gbSpeed ? 2 : 4)] >> (c << 1)) & 3;
-                                    if (gbSgbMode && !gbCgbMode) {
-                                        int dx = x >> 3;
-                                        int dy = y >> 3;
-
-                                        int palette = gbSgbATF[dy * 20 + dx];
-
-                                        if (c == 0)
-                                            palette = 0;
-
-                                        c = c + 4 * palette;
-                                    }
-                                }
-                                gbLineMix[x] = gbColorOption ? gbColorFilter[gbPalette[c] & 0x7FFF] : gbPalette[c] & 0x7FFF;
+                                c = c + 4 * palette;
                             }
-                            x++;
-                            if (x >= 160)
-                                break;
-                            bx >>= 1;
-                        }
-                        tx++;
-                        if (tx == 32)
-                            tx = 0;
-                        bx = 128;
-                        tile = bank0[tile_map_line_y + tx];
-                        if (bank1)
-                            attrs = bank1[tile_map_line_y + tx];
-
-                        if ((register_LCDC & 16) == 0) {
-                            if (tile < 128)
-                                tile += 128;
-                            else
-                                tile -= 128;
                         }
-                        tile_pattern_address = tile_pattern + tile * 16 + by * 2;
+                        gbLineMix[x] = gbColorOption ? gbColorFilter[gbPalette[c] & 0x7FFF] : gbPalette[c] & 0x7FFF;
                     }
+                    x++;
+                    if (x >= 160)
+                        break;
+                    bx >>= 1;
+                }
+                tx++;
+                if (tx == 32)
+                    tx = 0;
+                bx = 128;
+                tile = bank0[tile_map_line_y + tx];
+                if (bank1)
+                    attrs = bank1[tile_map_line_y + tx];
 
-                    //for (i = swx; i<160; i++)
-                    //  gbLineMix[i] = gbWindowColor[i];
-                    gbWindowLine++;
+                if ((register_LCDC & 16) == 0) {
+                    if (tile < 128)
+                        tile += 128;
+                    else
+                        tile -= 128;
                 }
+                tile_pattern_address = tile_pattern + tile * 16 + by * 2;
             }
-        } else if (gbWindowLine == -2) {
-            inUseRegister_WY = oldRegister_WY;
-            if (register_LY > oldRegister_WY)
-                gbWindowLine = 146;
-            else
-                gbWindowLine = 0;
+
+            //for (i = swx; i<160; i++)
+            //  gbLineMix[i] = gbWindowColor[i];
         }
     } else {
         uint16_t color = gbColorOption ? gbColorFilter[0x7FFF] : 0x7FFF;
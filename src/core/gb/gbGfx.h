@@ -1,7 +1,10 @@
 #ifndef VBAM_CORE_GB_GBGFX_H_
 #define VBAM_CORE_GB_GBGFX_H_
 
-void gbRenderLine();
+// Advances the window line counter on a visible line, whether the line is
+// drawn or not. Returns the window line to draw, or -1 if none.
+int gbUpdateWindowLine();
+void gbRenderLine(int windowLine);
 void gbDrawSprites(bool);
 
 #endif  // VBAM_CORE_GB_GBGFX_H_
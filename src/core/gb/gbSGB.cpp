@@ -291,7 +291,7 @@ void gbSgbDrawBorderTile(int x, int y, int tile, int attr)
 
 void gbSgbRenderBorder()
 {
-    if (gbBorderOn) {
+    if (gbBorderOn && !coreOptions.videoOff) {
         uint8_t* fromAddress = gbSgbBorder;
 
         for (uint8_t y = 0; y < 28; y++) {
@@ -882,7 +882,12 @@ variable_desc gbSgbSaveStructV3[] = {
     { NULL, 0 }
 };
 
-#ifdef __LIBRETRO__
+unsigned gbSgbStateSize()
+{
+    return utilDataSize(gbSgbSaveStructV3) + 2048 + 32 * 256 + 16 * 7 +
+        4 * 512 * sizeof(uint16_t) + 20 * 18 + 45 * 20 * 18;
+}
+
 void gbSgbSaveGame(uint8_t*& data)
 {
     utilWriteDataMem(data, gbSgbSaveStructV3);
@@ -911,7 +916,7 @@ void gbSgbReadGame(const uint8_t*& data)
     utilReadMem(gbSgbATFList, data, 45 * 20 * 18);
 }
 
-#else // !__LIBRETRO__
+#ifndef __LIBRETRO__
 void gbSgbSaveGame(gzFile gzFile)
 {
     utilWriteData(gzFile, gbSgbSaveStructV3);
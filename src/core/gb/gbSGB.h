@@ -14,10 +14,10 @@ void gbSgbResetPacketState();
 void gbSgbReset();
 void gbSgbDoBitTransfer(uint8_t);
 void gbSgbRenderBorder();
-#ifdef __LIBRETRO__
+unsigned gbSgbStateSize();
 void gbSgbSaveGame(uint8_t*&);
 void gbSgbReadGame(const uint8_t*&);
-#else
+#ifndef __LIBRETRO__
 void gbSgbSaveGame(gzFile);
 void gbSgbReadGame(gzFile, int version);
 #endif
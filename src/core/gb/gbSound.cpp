@@ -21,13 +21,28 @@ static Gb_Apu* gb_apu;
 
 static float soundVolume_ = -1;
 static int prevSoundEnable = -1;
+// coreOptions.audioOff, as last applied by apply_effects()
+static bool prevAudioOff = false;
 static bool declicking = false;
 
 int const chan_count = 4;
 int const ticks_to_time = 2 * GB_APU_OVERCLOCK;
 
+static void apply_effects();
+
+// All the channels are muted while coreOptions.audioOff is set. They keep
+// running, so the registers read the same, but nothing is synthesized, mixed
+// or resampled.
+static inline void sync_audio_off()
+{
+    if (prevAudioOff != coreOptions.audioOff && stereo_buffer)
+        apply_effects();
+}
+
 uint8_t gbSoundRead(int st, uint16_t address)
 {
+    sync_audio_off();
+
     if (gb_apu && address >= NR10 && address <= 0xFF3F)
         return gb_apu->read_register((blip_time_t)(st * ticks_to_time), address);
 
@@ -38,6 +53,8 @@ void gbSoundEvent(int st, uint16_t address, uint8_t data)
 {
     gbMemory[address] = data;
 
+    sync_audio_off();
+
     if (gb_apu && address >= NR10 && address <= 0xFF3F)
         gb_apu->write_register((blip_time_t)(st * ticks_to_time), address, data);
 }
@@ -45,7 +62,8 @@ void gbSoundEvent(int st, uint16_t address, uint8_t data)
 static void end_frame(blip_time_t time)
 {
     gb_apu->end_frame(time);
-    stereo_buffer->end_frame(time);
+    if (!prevAudioOff)
+        stereo_buffer->end_frame(time);
 }
 
 static void apply_effects()
@@ -59,12 +77,19 @@ static void apply_effects()
     stereo_buffer->config().surround = gb_effects_config_current.surround;
     stereo_buffer->apply_config();
 
+    bool const audio_off_changed = prevAudioOff != coreOptions.audioOff;
+    prevAudioOff = coreOptions.audioOff;
+
     for (int i = 0; i < chan_count; i++) {
         Multi_Buffer::channel_t ch = { 0, 0, 0 };
-        if (prevSoundEnable >> i & 1)
+        if (prevSoundEnable >> i & 1 && !prevAudioOff)
             ch = stereo_buffer->channel(i);
         gb_apu->set_output(ch.center, ch.left, ch.right, i);
     }
+
+    // The buffer stops or restarts, drop the samples of the current frame
+    if (audio_off_changed)
+        stereo_buffer->clear();
 }
 
 void gbSoundConfigEffects(gb_effects_config_t const& c)
@@ -83,6 +108,8 @@ static void apply_volume()
 void gbSoundTick(int st)
 {
     if (gb_apu && stereo_buffer) {
+        sync_audio_off();
+
         // Run sound hardware to present
         end_frame((blip_time_t)(st * ticks_to_time));
 
@@ -458,7 +485,11 @@ void gbSoundReadGame(int version, gzFile in)
 }
 #endif // ! __LIBRETRO__
 
-#ifdef __LIBRETRO__
+unsigned gbSoundStateSize()
+{
+    return utilDataSize(gb_state);
+}
+
 void gbSoundSaveGame(uint8_t*& out)
 {
     gb_apu->save_state(&state.apu);
@@ -479,4 +510,3 @@ void gbSoundReadGame(const uint8_t*& in)
     utilReadDataMem(in, gb_state);
     gb_apu->load_state(state.apu);
 }
-#endif // __LIBRETRO__
@@ -13,6 +13,7 @@
 #include "core/base/file_util.h"
 #include "core/base/message.h"
 #include "core/base/port.h"
+#include "core/base/run_ahead.h"
 #include "core/base/sizes.h"
 #include "core/base/system.h"
 #include "core/gba/gbaCheats.h"
@@ -38,6 +39,7 @@
 
 #if !defined(__LIBRETRO__)
 #include "core/base/image_util.h"
+#include "core/gba/gbaGfxThread.h"
 #endif // !__LIBRETRO__
 
 #ifdef PROFILING
@@ -85,6 +87,15 @@ bool cpuEEPROMSensorEnabled = false;
 uint32_t cpuPrefetch[2];
 
 int cpuTotalTicks = 0;
+
+// Idle loop detection state, see CPUCheckIdleLoop().
+bool cpuIdleLoopVolatile = false;
+static const uint32_t kNoIdleLoop = 0xFFFFFFFF;
+static uint32_t idleLoopTarget = kNoIdleLoop;
+static reg_pair idleLoopRegs[17];
+static bool idleLoopFlags[4];
+static bool idleLoopArmState = true;
+
 #ifdef PROFILING
 int profilingTicks = 0;
 int profilingTicksReload = 0;
@@ -143,8 +154,8 @@ int capture = 0;
 int capturePrevious = 0;
 int captureNumber = 0;
 
-int armOpcodeCount = 0;
-int thumbOpcodeCount = 0;
+uint64_t armOpcodeCount = 0;
+uint64_t thumbOpcodeCount = 0;
 
 const int TIMER_TICKS[4] = {
     0,
@@ -481,8 +492,9 @@ void gbaUpdateRomSize(int size)
     if (size > romSize) {
         romSize = size;
 
-        uint8_t* tmp = (uint8_t*)realloc(g_rom, SIZE_ROM);
+        uint8_t* tmp = utilReallocImage(g_rom, SIZE_ROM);
         g_rom = tmp;
+        CPUUpdateMemoryPages();
 
         uint16_t* temp = (uint16_t*)(g_rom + ((romSize + 1) & ~1));
         for (int i = (romSize + 1) & ~1; i < SIZE_ROM; i += 2) {
@@ -547,75 +559,69 @@ inline int CPUUpdateTicks()
     return cpuLoopTicks;
 }
 
-void CPUUpdateWindow0()
+// Called on backward branches when coreOptions.skipIdleLoops is set, with
+// armNextPC pointing at the branch target. Returns true when the CPU reached
+// the same target twice in a row with identical registers and flags, without
+// an event in between and without setting cpuIdleLoopVolatile: no store, and
+// no read of a value that changes on its own (the timer counters, computed
+// from cpuTotalTicks, the save chips, the RTC and the sensors). All the other
+// reads only change on stores and events, so the loop will then repeat
+// identically until the next event and the caller can fast-forward to
+// cpuNextEvent. While a cheat (m) code is set, the callers don't skip: it
+// patches memory when the CPU reaches its address.
+bool CPUCheckIdleLoop()
 {
-    int x00 = WIN0H >> 8;
-    int x01 = WIN0H & 255;
-
-    if (x00 <= x01) {
-        for (int i = 0; i < 240; i++) {
-            gfxInWin0[i] = (i >= x00 && i < x01);
-        }
-    } else {
-        for (int i = 0; i < 240; i++) {
-            gfxInWin0[i] = (i >= x00 || i < x01);
-        }
-    }
+    const bool idle = idleLoopTarget == armNextPC && !cpuIdleLoopVolatile &&
+        idleLoopArmState == armState && idleLoopFlags[0] == N_FLAG &&
+        idleLoopFlags[1] == Z_FLAG && idleLoopFlags[2] == C_FLAG &&
+        idleLoopFlags[3] == V_FLAG && memcmp(idleLoopRegs, reg, sizeof(idleLoopRegs)) == 0;
+
+    if (!idle) {
+        idleLoopTarget = armNextPC;
+        idleLoopArmState = armState;
+        idleLoopFlags[0] = N_FLAG;
+        idleLoopFlags[1] = Z_FLAG;
+        idleLoopFlags[2] = C_FLAG;
+        idleLoopFlags[3] = V_FLAG;
+        memcpy(idleLoopRegs, reg, sizeof(idleLoopRegs));
+    }
+    cpuIdleLoopVolatile = false;
+
+    return idle;
 }
 
-void CPUUpdateWindow1()
-{
-    int x00 = WIN1H >> 8;
-    int x01 = WIN1H & 255;
+// Line renderer state collected between two captured lines, see
+// CPUCaptureLine().
+static int gfxBG2Changed = 0;
+static int gfxBG3Changed = 0;
+static int gfxClearLines = 0;
 
-    if (x00 <= x01) {
-        for (int i = 0; i < 240; i++) {
-            gfxInWin1[i] = (i >= x00 && i < x01);
-        }
-    } else {
-        for (int i = 0; i < 240; i++) {
-            gfxInWin1[i] = (i >= x00 || i < x01);
-        }
+void CPUUpdateRenderBuffers(bool force)
+{
+    // The buffers are cleared by the renderer before it draws the next line.
+    for (int i = 0; i < 4; i++) {
+        if (!(coreOptions.layerEnable & (0x0100 << i)) || force)
+            gfxClearLines |= 1 << i;
     }
 }
 
-extern uint32_t g_line0[240];
-extern uint32_t g_line1[240];
-extern uint32_t g_line2[240];
-extern uint32_t g_line3[240];
-
-#define CLEAR_ARRAY(a)                  \
-    {                                   \
-        uint32_t* array = (a);               \
-        for (int i = 0; i < 240; i++) { \
-            *array++ = 0x80000000;      \
-        }                               \
-    }
-
-void CPUUpdateRenderBuffers(bool force)
+unsigned int CPUStateSize()
 {
-    if (!(coreOptions.layerEnable & 0x0100) || force) {
-        CLEAR_ARRAY(g_line0);
-    }
-    if (!(coreOptions.layerEnable & 0x0200) || force) {
-        CLEAR_ARRAY(g_line1);
-    }
-    if (!(coreOptions.layerEnable & 0x0400) || force) {
-        CLEAR_ARRAY(g_line2);
-    }
-    if (!(coreOptions.layerEnable & 0x0800) || force) {
-        CLEAR_ARRAY(g_line3);
-    }
+    return 4 * sizeof(int) + 16 + sizeof(reg) + utilDataSize(saveGameStruct) +
+        SIZE_IRAM + SIZE_PRAM + SIZE_WRAM + SIZE_VRAM + SIZE_OAM + SIZE_IOMEM +
+        eepromStateSize() + flashStateSize() + soundStateSize() + rtcStateSize();
 }
 
-#ifdef __LIBRETRO__
-#include <stddef.h>
+unsigned int CPUOldLibretroStateSize()
+{
+    return CPUStateSize() + SAVE_GAME_LIBRETRO_PIX_SIZE;
+}
 
 unsigned int CPUWriteState(uint8_t* data)
 {
     uint8_t* orig = data;
 
-    utilWriteIntMem(data, SAVE_GAME_VERSION);
+    utilWriteIntMem(data, SAVE_GAME_RAW_VERSION);
     utilWriteMem(data, &g_rom[0xa0], 16);
     utilWriteIntMem(data, coreOptions.useBios);
     utilWriteMem(data, &reg[0], sizeof(reg));
@@ -630,7 +636,6 @@ unsigned int CPUWriteState(uint8_t* data)
     utilWriteMem(data, g_workRAM, SIZE_WRAM);
     utilWriteMem(data, g_vram, SIZE_VRAM);
     utilWriteMem(data, g_oam, SIZE_OAM);
-    utilWriteMem(data, g_pix, SIZE_PIX);
     utilWriteMem(data, g_ioMem, SIZE_IOMEM);
 
     eepromSaveGame(data);
@@ -638,14 +643,13 @@ unsigned int CPUWriteState(uint8_t* data)
     soundSaveGame(data);
     rtcSaveGame(data);
 
-    return (ptrdiff_t)data - (ptrdiff_t)orig;
+    return (unsigned int)(data - orig);
 }
 
 bool CPUReadState(const uint8_t* data)
 {
-    // Don't really care about version.
     int version = utilReadIntMem(data);
-    if (version != SAVE_GAME_VERSION)
+    if (version != SAVE_GAME_RAW_VERSION && version != SAVE_GAME_VERSION)
         return false;
 
     char romname[16];
@@ -675,8 +679,11 @@ bool CPUReadState(const uint8_t* data)
     utilReadMem(g_workRAM, data, SIZE_WRAM);
     utilReadMem(g_vram, data, SIZE_VRAM);
     utilReadMem(g_oam, data, SIZE_OAM);
-    utilReadMem(g_pix, data, SIZE_PIX);
+    // The frame buffer is redrawn on the next frame.
+    if (version == SAVE_GAME_VERSION)
+        data += SAVE_GAME_LIBRETRO_PIX_SIZE;
     utilReadMem(g_ioMem, data, SIZE_IOMEM);
+    gfxMemoryChanged();
 
     eepromReadGame(data);
     flashReadGame(data);
@@ -689,15 +696,7 @@ bool CPUReadState(const uint8_t* data)
 
     CPUUpdateRender();
 
-    // CPU Update Render Buffers set to true
-    CLEAR_ARRAY(g_line0);
-    CLEAR_ARRAY(g_line1);
-    CLEAR_ARRAY(g_line2);
-    CLEAR_ARRAY(g_line3);
-    // End of CPU Update Render Buffers set to true
-
-    CPUUpdateWindow0();
-    CPUUpdateWindow1();
+    CPUUpdateRenderBuffers(true);
 
     SetSaveType(coreOptions.saveType);
 
@@ -713,7 +712,27 @@ bool CPUReadState(const uint8_t* data)
     return true;
 }
 
-#else // !__LIBRETRO__
+bool CPUWriteMemState(char* memory, int available, long& reserved)
+{
+    reserved = CPUStateSize();
+
+    if (reserved > available)
+        return false;
+
+    CPUWriteState((uint8_t*)memory);
+
+    return true;
+}
+
+bool CPUReadMemState(char* memory, int available)
+{
+    if (available < (int)CPUStateSize())
+        return false;
+
+    return CPUReadState((const uint8_t*)memory);
+}
+
+#ifndef __LIBRETRO__
 
 static bool CPUWriteState(gzFile gzFile)
 {
@@ -754,7 +773,7 @@ static bool CPUWriteState(gzFile gzFile)
 
 bool CPUWriteState(const char* file)
 {
-    gzFile gzFile = utilGzOpen(file, "wb");
+    gzFile gzFile = utilGzOpenAsync(file);
 
     if (gzFile == NULL) {
         systemMessage(MSG_ERROR_CREATING_FILE, N_("Error creating file %s"), file);
@@ -768,26 +787,6 @@ bool CPUWriteState(const char* file)
     return res;
 }
 
-bool CPUWriteMemState(char* memory, int available, long& reserved)
-{
-    gzFile gzFile = utilMemGzOpen(memory, available, "w");
-
-    if (gzFile == NULL) {
-        return false;
-    }
-
-    bool res = CPUWriteState(gzFile);
-
-    reserved = utilGzMemTell(gzFile) + 8;
-
-    if (reserved >= (available))
-        res = false;
-
-    utilGzClose(gzFile);
-
-    return res;
-}
-
 static bool CPUReadState(gzFile gzFile)
 {
     int version = utilReadInt(gzFile);
@@ -856,6 +855,7 @@ static bool CPUReadState(gzFile gzFile)
     else
         utilGzRead(gzFile, g_pix, SIZE_PIX);
     utilGzRead(gzFile, g_ioMem, SIZE_IOMEM);
+    gfxMemoryChanged();
 
     if (coreOptions.skipSaveGameBattery) {
         // skip eeprom data
@@ -916,8 +916,6 @@ static bool CPUReadState(gzFile gzFile)
 
     CPUUpdateRender();
     CPUUpdateRenderBuffers(true);
-    CPUUpdateWindow0();
-    CPUUpdateWindow1();
 
     SetSaveType(coreOptions.saveType);
 
@@ -933,17 +931,6 @@ static bool CPUReadState(gzFile gzFile)
     return true;
 }
 
-bool CPUReadMemState(char* memory, int available)
-{
-    gzFile gzFile = utilMemGzOpen(memory, available, "r");
-
-    bool res = CPUReadState(gzFile);
-
-    utilGzClose(gzFile);
-
-    return res;
-}
-
 bool CPUReadState(const char* file)
 {
     gzFile gzFile = utilGzOpen(file, "rb");
@@ -1384,8 +1371,12 @@ void CPUCleanUp()
     }
 #endif
 
+#ifndef __LIBRETRO__
+    gfxThreadStop();
+#endif
+
     if (g_rom != NULL) {
-        free(g_rom);
+        utilFreeImage(g_rom);
         g_rom = NULL;
     }
 
@@ -1433,11 +1424,74 @@ void CPUCleanUp()
     elfCleanUp();
 #endif  // defined(VBAM_ENABLE_DEBUGGER)
 
+    CPUUpdateMemoryPages();
+
     systemSaveUpdateCounter = SYSTEM_SAVE_NOT_UPDATED;
 
     emulating = 0;
 }
 
+#ifdef VBAM_ENABLE_DEBUGGER
+static bool CPUPageHasBreakOnWrite(const uint8_t* freeze)
+{
+    for (int i = 0; i <= CPU_PAGE_MASK; i++) {
+        if (freeze[i])
+            return true;
+    }
+    return false;
+}
+#endif
+
+void CPUUpdateMemoryPages()
+{
+    memset(cpuReadPages, 0, sizeof(cpuReadPages));
+    memset(cpuWritePages, 0, sizeof(cpuWritePages));
+
+    if (g_workRAM == NULL || g_internalRAM == NULL || g_rom == NULL)
+        return;
+
+    // With the debugger, the writes to the pages with a break on write go
+    // through cheatsWriteMemory().
+    bool workRAMWritable[SIZE_WRAM >> CPU_PAGE_SHIFT];
+    for (size_t i = 0; i < sizeof(workRAMWritable); i++) {
+#ifdef VBAM_ENABLE_DEBUGGER
+        workRAMWritable[i] = !CPUPageHasBreakOnWrite(&freezeWorkRAM[i << CPU_PAGE_SHIFT]);
+#else
+        workRAMWritable[i] = true;
+#endif
+    }
+#ifdef VBAM_ENABLE_DEBUGGER
+    const bool internalRAMWritable = !CPUPageHasBreakOnWrite(freezeInternalRAM);
+#else
+    const bool internalRAMWritable = true;
+#endif
+
+    for (uint32_t page = 0; page < CPU_PAGES; page++) {
+        const uint32_t address = page << CPU_PAGE_SHIFT;
+        switch (address >> 24) {
+        case 2:
+            cpuReadPages[page] = &g_workRAM[address & 0x3FFFF];
+            if (workRAMWritable[(address & 0x3FFFF) >> CPU_PAGE_SHIFT])
+                cpuWritePages[page] = cpuReadPages[page];
+            break;
+        case 3:
+            cpuReadPages[page] = g_internalRAM;
+            if (internalRAMWritable)
+                cpuWritePages[page] = cpuReadPages[page];
+            break;
+        case 8:
+        case 9:
+        case 10:
+        case 11:
+        case 12:
+            // The RTC registers are read in the first page.
+            if (address != 0x8000000)
+                cpuReadPages[page] = &g_rom[address & 0x1FFFFFF];
+            break;
+        }
+    }
+}
+
 void SetMapMasks()
 {
     map[0].mask = 0x3FFF;
@@ -1488,7 +1542,24 @@ int CPULoadRom(const char* szFile)
 
     systemSaveUpdateCounter = SYSTEM_SAVE_NOT_UPDATED;
 
-    g_rom = (uint8_t*)malloc(SIZE_ROM);
+#if !defined(__LIBRETRO__)
+    // Plain ROM files can be mapped rather than read, so that the instances
+    // running the same game share the ROM pages.
+    if (szFile != NULL && !CPUIsELF(szFile)) {
+        g_rom = utilMapImage(szFile, utilIsGBAImage, SIZE_ROM, romSize);
+        // utilIsGBAImage() sets cpuIsMultiBoot.
+        if (g_rom != NULL && coreOptions.cpuIsMultiBoot) {
+            // Multiboot images are loaded to WRAM.
+            utilFreeImage(g_rom);
+            g_rom = NULL;
+            romSize = SIZE_ROM;
+        }
+    }
+#endif
+    const bool romMapped = g_rom != NULL;
+
+    if (!romMapped)
+        g_rom = (uint8_t*)malloc(SIZE_ROM);
     if (g_rom == NULL) {
         systemMessage(MSG_OUT_OF_MEMORY, N_("Failed to allocate memory for %s"),
             "ROM");
@@ -1509,7 +1580,7 @@ int CPULoadRom(const char* szFile)
         if (!f) {
             systemMessage(MSG_ERROR_OPENING_IMAGE, N_("Error opening image %s"),
                 szFile);
-            free(g_rom);
+            utilFreeImage(g_rom);
             g_rom = NULL;
             free(g_workRAM);
             g_workRAM = NULL;
@@ -1517,7 +1588,7 @@ int CPULoadRom(const char* szFile)
         }
         bool res = elfRead(szFile, romSize, f);
         if (!res || romSize == 0) {
-            free(g_rom);
+            utilFreeImage(g_rom);
             g_rom = NULL;
             free(g_workRAM);
             g_workRAM = NULL;
@@ -1526,12 +1597,12 @@ int CPULoadRom(const char* szFile)
         }
     } else
 #endif  // defined(VBAM_ENABLE_DEBUGGER)
-        if (szFile != NULL) {
+        if (szFile != NULL && !romMapped) {
         if (!utilLoad(szFile,
                 utilIsGBAImage,
                 whereToLoad,
                 romSize)) {
-            free(g_rom);
+            utilFreeImage(g_rom);
             g_rom = NULL;
             free(g_workRAM);
             g_workRAM = NULL;
@@ -1675,7 +1746,7 @@ int CPULoadRomData(const char* data, int size)
         return 0;
     }
 
-    g_pix = (uint8_t*)calloc(1, 4 * 240 * 160);
+    g_pix = (uint8_t*)calloc(1, SIZE_PIX);
     if (g_pix == NULL) {
         systemMessage(MSG_OUT_OF_MEMORY, N_("Failed to allocate memory for %s"),
             "PIX");
@@ -2856,12 +2927,10 @@ void CPUUpdateRegister(uint32_t address, uint16_t value)
     case 0x40:
         WIN0H = value;
         UPDATE_REG(0x40, WIN0H);
-        CPUUpdateWindow0();
         break;
     case 0x42:
         WIN1H = value;
         UPDATE_REG(0x42, WIN1H);
-        CPUUpdateWindow1();
         break;
     case 0x44:
         WIN0V = value;
@@ -3472,6 +3541,7 @@ void CPUReset()
     memset(g_pix, 0, SIZE_PIX);
     // clean g_vram
     memset(g_vram, 0, SIZE_VRAM);
+    gfxMemoryChanged();
     // clean io memory
     memset(g_ioMem, 0, SIZE_IOMEM);
 
@@ -3656,12 +3726,10 @@ void CPUReset()
     map[14].address = flashSaveMemory;
 
     SetMapMasks();
+    CPUUpdateMemoryPages();
 
     soundReset();
 
-    CPUUpdateWindow0();
-    CPUUpdateWindow1();
-
     // make sure registers are correctly initialized if not using BIOS
     if (!coreOptions.useBios) {
         if (coreOptions.cpuIsMultiBoot)
@@ -3745,7 +3813,79 @@ static void gbaUpdateJoypads(void)
     }
 }
 
-void CPULoop(int ticks)
+// Copies everything the line renderers read for the current line.
+static void CPUCaptureLine(GfxLineState& state)
+{
+    state.renderLine = renderLine;
+    state.vram = g_vram;
+    state.paletteRAM = g_paletteRAM;
+    state.oam = g_oam;
+    state.layerEnable = coreOptions.layerEnable;
+    state.customBackdropColor = customBackdropColor;
+    state.BG2Changed = gfxBG2Changed;
+    state.BG3Changed = gfxBG3Changed;
+    state.clearLines = gfxClearLines;
+    gfxBG2Changed = 0;
+    gfxBG3Changed = 0;
+    gfxClearLines = 0;
+
+    state.DISPCNT = DISPCNT;
+    state.VCOUNT = VCOUNT;
+    state.BG0CNT = BG0CNT;
+    state.BG1CNT = BG1CNT;
+    state.BG2CNT = BG2CNT;
+    state.BG3CNT = BG3CNT;
+    state.BG0HOFS = BG0HOFS;
+    state.BG0VOFS = BG0VOFS;
+    state.BG1HOFS = BG1HOFS;
+    state.BG1VOFS = BG1VOFS;
+    state.BG2HOFS = BG2HOFS;
+    state.BG2VOFS = BG2VOFS;
+    state.BG3HOFS = BG3HOFS;
+    state.BG3VOFS = BG3VOFS;
+    state.BG2PA = BG2PA;
+    state.BG2PB = BG2PB;
+    state.BG2PC = BG2PC;
+    state.BG2PD = BG2PD;
+    state.BG2X_L = BG2X_L;
+    state.BG2X_H = BG2X_H;
+    state.BG2Y_L = BG2Y_L;
+    state.BG2Y_H = BG2Y_H;
+    state.BG3PA = BG3PA;
+    state.BG3PB = BG3PB;
+    state.BG3PC = BG3PC;
+    state.BG3PD = BG3PD;
+    state.BG3X_L = BG3X_L;
+    state.BG3X_H = BG3X_H;
+    state.BG3Y_L = BG3Y_L;
+    state.BG3Y_H = BG3Y_H;
+    state.WIN0H = WIN0H;
+    state.WIN1H = WIN1H;
+    state.WIN0V = WIN0V;
+    state.WIN1V = WIN1V;
+    state.WININ = WININ;
+    state.WINOUT = WINOUT;
+    state.MOSAIC = MOSAIC;
+    state.BLDMOD = BLDMOD;
+    state.COLEV = COLEV;
+    state.COLY = COLY;
+}
+
+// Draws the current line, or queues it for the render thread.
+static void CPUDrawLine()
+{
+#ifndef __LIBRETRO__
+    if (gfxThreadEnabled) {
+        CPUCaptureLine(*gfxThreadNextLine());
+        gfxThreadQueueLine();
+        return;
+    }
+#endif
+    CPUCaptureLine(gfxLine);
+    gfxDrawLine();
+}
+
+static void CPURunLoop(int ticks)
 {
     int clockTicks;
     int timerOverflow = 0;
@@ -3766,13 +3906,11 @@ void CPULoop(int ticks)
     for (;;) {
         if (!holdState && !SWITicks) {
             if (armState) {
-                armOpcodeCount++;
                 if (!armExecute())
                     return;
                 if (debugger)
                     return;
             } else {
-                thumbOpcodeCount++;
                 if (!thumbExecute())
                     return;
                 if (debugger)
@@ -3784,9 +3922,6 @@ void CPULoop(int ticks)
 
         cpuTotalTicks += clockTicks;
 
-        if (rtcIsEnabled())
-            rtcUpdateTime(cpuTotalTicks);
-
         if (cpuTotalTicks >= cpuNextEvent) {
             int remainingTicks = cpuTotalTicks - cpuNextEvent;
 
@@ -3801,6 +3936,9 @@ void CPULoop(int ticks)
 
         updateLoop:
 
+            // Memory may change on events, restart idle loop detection.
+            idleLoopTarget = kNoIdleLoop;
+
             if (IRQTicks) {
                 IRQTicks -= clockTicks;
                 if (IRQTicks < 0)
@@ -3811,6 +3949,14 @@ void CPULoop(int ticks)
 
             soundTicks += clockTicks;
 
+            // The RTC only needs to see elapsed time, so it is advanced here
+            // with the other timed devices rather than after every slice. Its
+            // time is not part of the states, so the hidden frames, which are
+            // discarded or replay frames that were already emulated, leave it
+            // alone.
+            if (rtcIsEnabled() && !RunAhead::IsHiddenFrame())
+                rtcUpdateTime(clockTicks);
+
             if (lcdTicks <= 0) {
                 if (DISPSTAT & 1) { // V-BLANK
                     // if in V-Blank mode, keep computing...
@@ -3877,21 +4023,23 @@ void CPULoop(int ticks)
                         lcdTicks += 1008;
                         DISPSTAT &= 0xFFFD;
                         if (VCOUNT == 160) {
-                            g_count++;
-                            systemFrame();
+                            if (RunAhead::ReportFrame()) {
+                                g_count++;
+                                systemFrame();
 
-                            if ((g_count % 10) == 0) {
-                                system10Frames();
-                            }
-                            if (g_count == 60) {
-                                uint32_t time = systemGetClock();
-                                if (time != lastTime) {
-                                    uint32_t t = 100000 / (time - lastTime);
-                                    systemShowSpeed(t);
-                                } else
-                                    systemShowSpeed(0);
-                                lastTime = time;
-                                g_count = 0;
+                                if ((g_count % 10) == 0) {
+                                    system10Frames();
+                                }
+                                if (g_count == 60) {
+                                    uint32_t time = systemGetClock();
+                                    if (time != lastTime) {
+                                        uint32_t t = 100000 / (time - lastTime);
+                                        systemShowSpeed(t);
+                                    } else
+                                        systemShowSpeed(0);
+                                    lastTime = time;
+                                    g_count = 0;
+                                }
                             }
 
                             uint32_t ext = (joy >> 10);
@@ -3923,12 +4071,17 @@ void CPULoop(int ticks)
 
                             psoundTickfn();
 
-                            if (frameCount >= framesToSkip) {
-                                systemDrawScreen();
-                                frameCount = 0;
-                            } else {
-                                frameCount++;
-                                systemSendScreen();
+                            if (!coreOptions.videoOff) {
+#ifndef __LIBRETRO__
+                                gfxThreadSync();
+#endif
+                                if (frameCount >= framesToSkip) {
+                                    systemDrawScreen();
+                                    frameCount = 0;
+                                } else {
+                                    frameCount++;
+                                    systemSendScreen();
+                                }
                             }
                             if (systemPauseOnFrame())
                                 ticks = 0;
@@ -3940,110 +4093,8 @@ void CPULoop(int ticks)
                         CPUCompareVCOUNT();
 
                     } else {
-                        if (frameCount >= framesToSkip) {
-                            (*renderLine)();
-                            switch (systemColorDepth) {
-                            case 16: {
-#ifdef __LIBRETRO__
-                                uint16_t* dest = (uint16_t*)g_pix + 240 * VCOUNT;
-#else
-                                uint16_t* dest = (uint16_t*)g_pix + 242 * (VCOUNT + 1);
-#endif
-                                for (int x = 0; x < 240;) {
-                                    *dest++ = systemColorMap16[g_lineMix[x++] & 0xFFFF];
-                                    *dest++ = systemColorMap16[g_lineMix[x++] & 0xFFFF];
-                                    *dest++ = systemColorMap16[g_lineMix[x++] & 0xFFFF];
-                                    *dest++ = systemColorMap16[g_lineMix[x++] & 0xFFFF];
-
-                                    *dest++ = systemColorMap16[g_lineMix[x++] & 0xFFFF];
-                                    *dest++ = systemColorMap16[g_lineMix[x++] & 0xFFFF];
-                                    *dest++ = systemColorMap16[g_lineMix[x++] & 0xFFFF];
-                                    *dest++ = systemColorMap16[g_lineMix[x++] & 0xFFFF];
-
-                                    *dest++ = systemColorMap16[g_lineMix[x++] & 0xFFFF];
-                                    *dest++ = systemColorMap16[g_lineMix[x++] & 0xFFFF];
-                                    *dest++ = systemColorMap16[g_lineMix[x++] & 0xFFFF];
-                                    *dest++ = systemColorMap16[g_lineMix[x++] & 0xFFFF];
-
-                                    *dest++ = systemColorMap16[g_lineMix[x++] & 0xFFFF];
-                                    *dest++ = systemColorMap16[g_lineMix[x++] & 0xFFFF];
-                                    *dest++ = systemColorMap16[g_lineMix[x++] & 0xFFFF];
-                                    *dest++ = systemColorMap16[g_lineMix[x++] & 0xFFFF];
-                                }
-// for filters that read past the screen
-#ifndef __LIBRETRO__
-                                *dest++ = 0;
-#endif
-                            } break;
-                            case 24: {
-                                uint8_t* dest = (uint8_t*)g_pix + 240 * VCOUNT * 3;
-                                for (int x = 0; x < 240;) {
-                                    *((uint32_t*)dest) = systemColorMap32[g_lineMix[x++] & 0xFFFF];
-                                    dest += 3;
-                                    *((uint32_t*)dest) = systemColorMap32[g_lineMix[x++] & 0xFFFF];
-                                    dest += 3;
-                                    *((uint32_t*)dest) = systemColorMap32[g_lineMix[x++] & 0xFFFF];
-                                    dest += 3;
-                                    *((uint32_t*)dest) = systemColorMap32[g_lineMix[x++] & 0xFFFF];
-                                    dest += 3;
-
-                                    *((uint32_t*)dest) = systemColorMap32[g_lineMix[x++] & 0xFFFF];
-                                    dest += 3;
-                                    *((uint32_t*)dest) = systemColorMap32[g_lineMix[x++] & 0xFFFF];
-                                    dest += 3;
-                                    *((uint32_t*)dest) = systemColorMap32[g_lineMix[x++] & 0xFFFF];
-                                    dest += 3;
-                                    *((uint32_t*)dest) = systemColorMap32[g_lineMix[x++] & 0xFFFF];
-                                    dest += 3;
-
-                                    *((uint32_t*)dest) = systemColorMap32[g_lineMix[x++] & 0xFFFF];
-                                    dest += 3;
-                                    *((uint32_t*)dest) = systemColorMap32[g_lineMix[x++] & 0xFFFF];
-                                    dest += 3;
-                                    *((uint32_t*)dest) = systemColorMap32[g_lineMix[x++] & 0xFFFF];
-                                    dest += 3;
-                                    *((uint32_t*)dest) = systemColorMap32[g_lineMix[x++] & 0xFFFF];
-                                    dest += 3;
-
-                                    *((uint32_t*)dest) = systemColorMap32[g_lineMix[x++] & 0xFFFF];
-                                    dest += 3;
-                                    *((uint32_t*)dest) = systemColorMap32[g_lineMix[x++] & 0xFFFF];
-                                    dest += 3;
-                                    *((uint32_t*)dest) = systemColorMap32[g_lineMix[x++] & 0xFFFF];
-                                    dest += 3;
-                                    *((uint32_t*)dest) = systemColorMap32[g_lineMix[x++] & 0xFFFF];
-                                    dest += 3;
-                                }
-                            } break;
-                            case 32: {
-#ifdef __LIBRETRO__
-                                uint32_t* dest = (uint32_t*)g_pix + 240 * VCOUNT;
-#else
-                                uint32_t* dest = (uint32_t*)g_pix + 241 * (VCOUNT + 1);
-#endif
-                                for (int x = 0; x < 240;) {
-                                    *dest++ = systemColorMap32[g_lineMix[x++] & 0xFFFF];
-                                    *dest++ = systemColorMap32[g_lineMix[x++] & 0xFFFF];
-                                    *dest++ = systemColorMap32[g_lineMix[x++] & 0xFFFF];
-                                    *dest++ = systemColorMap32[g_lineMix[x++] & 0xFFFF];
-
-                                    *dest++ = systemColorMap32[g_lineMix[x++] & 0xFFFF];
-                                    *dest++ = systemColorMap32[g_lineMix[x++] & 0xFFFF];
-                                    *dest++ = systemColorMap32[g_lineMix[x++] & 0xFFFF];
-                                    *dest++ = systemColorMap32[g_lineMix[x++] & 0xFFFF];
-
-                                    *dest++ = systemColorMap32[g_lineMix[x++] & 0xFFFF];
-                                    *dest++ = systemColorMap32[g_lineMix[x++] & 0xFFFF];
-                                    *dest++ = systemColorMap32[g_lineMix[x++] & 0xFFFF];
-                                    *dest++ = systemColorMap32[g_lineMix[x++] & 0xFFFF];
-
-                                    *dest++ = systemColorMap32[g_lineMix[x++] & 0xFFFF];
-                                    *dest++ = systemColorMap32[g_lineMix[x++] & 0xFFFF];
-                                    *dest++ = systemColorMap32[g_lineMix[x++] & 0xFFFF];
-                                    *dest++ = systemColorMap32[g_lineMix[x++] & 0xFFFF];
-                                }
-                            } break;
-                            }
+                        if (frameCount >= framesToSkip && !coreOptions.videoOff) {
+                            CPUDrawLine();
                         }
                         // entering H-Blank
                         DISPSTAT |= 2;
@@ -4216,7 +4267,7 @@ void CPULoop(int ticks)
 
 #ifndef NO_LINK
             // shuffle2: what's the purpose?
-            if (GetLinkMode() != LINK_DISCONNECTED || gba_joybus_active)
+            if ((GetLinkMode() != LINK_DISCONNECTED && GetLinkMode() != LINK_CABLE_NETPLAY) || gba_joybus_active)
                 cpuNextEvent = 1;
 #endif
 
@@ -4282,6 +4333,20 @@ void CPULoop(int ticks)
 #endif
 }
 
+void CPULoop(int ticks)
+{
+#ifndef __LIBRETRO__
+    // Lines are only drawn in the background while the CPU runs, so the rest
+    // of the emulator is free to access the video memory and g_pix between
+    // two calls.
+    gfxThreadUpdate();
+    CPURunLoop(ticks);
+    gfxThreadSync();
+#else
+    CPURunLoop(ticks);
+#endif
+}
+
 void gbaEmulate(int ticks)
 {
     has_frames = false;
@@ -4310,8 +4375,8 @@ struct EmulatedSystem GBASystem = {
     NULL,           // emuReadState
     CPUReadState,   // emuReadState
     CPUWriteState,  // emuWriteState
-    NULL,           // emuReadMemState
-    NULL,           // emuWriteMemState
+    CPUReadMemState,  // emuReadMemState
+    CPUWriteMemState, // emuWriteMemState
     NULL,           // emuWritePNG
     NULL,           // emuWriteBMP
 #else
@@ -19,6 +19,15 @@ const uint64_t TICKS_PER_SECOND = 16777216;
 #define SAVE_GAME_VERSION_10 10
 #define SAVE_GAME_VERSION SAVE_GAME_VERSION_10
 
+// Version of the raw in-memory states, see CPUWriteState(uint8_t*). They are
+// not compatible with the save game files.
+#define SAVE_GAME_RAW_VERSION_1 0x10001
+#define SAVE_GAME_RAW_VERSION SAVE_GAME_RAW_VERSION_1
+
+// Size of the states written by older libretro builds, which used
+// SAVE_GAME_VERSION and stored the 240x160 frame buffer after the OAM.
+#define SAVE_GAME_LIBRETRO_PIX_SIZE (4 * 240 * 160)
+
 #define gbaWidth  240
 #define gbaHeight 160
 
@@ -100,6 +109,20 @@ typedef union {
 extern memoryMap map[256];
 #endif
 
+// The address space below 0x10000000 in 32 KiB pages.
+enum {
+    CPU_PAGE_SHIFT = 15,
+    CPU_PAGE_MASK = (1 << CPU_PAGE_SHIFT) - 1,
+    CPU_PAGES = 0x10000000 >> CPU_PAGE_SHIFT,
+};
+
+// The host address of the pages that are plain memory, accessed directly by
+// the CPURead* and CPUWrite* functions: EWRAM, IWRAM and the ROM for reads,
+// EWRAM and IWRAM for writes. NULL when the accesses to the page have side
+// effects and go through the handlers of the region.
+extern uint8_t* cpuReadPages[CPU_PAGES];
+extern uint8_t* cpuWritePages[CPU_PAGES];
+
 extern uint8_t biosProtected[4];
 
 extern void (*cpuSaveGameFunc)(uint32_t, uint8_t);
@@ -133,12 +156,20 @@ extern bool CPUWriteBMPFile(const char*);
 extern void CPUCleanUp();
 extern void CPUUpdateRender();
 extern void CPUUpdateRenderBuffers(bool);
+// Rebuilds cpuReadPages and cpuWritePages, after the memory was reallocated
+// or, with the debugger, after a break on write was changed.
+extern void CPUUpdateMemoryPages();
 extern bool CPUReadMemState(char*, int);
-extern bool CPUWriteMemState(char*, int);
-#ifdef __LIBRETRO__
+extern bool CPUWriteMemState(char*, int, long&);
+// Raw in-memory states, without the derived data such as the frame buffer.
+// They have a fixed layout and CPUStateSize() bytes.
+extern unsigned int CPUStateSize();
+// CPUReadState() also loads the states of older libretro builds, which have
+// this size.
+extern unsigned int CPUOldLibretroStateSize();
 extern bool CPUReadState(const uint8_t*);
-extern unsigned int CPUWriteState(uint8_t* data, unsigned int size);
-#else
+extern unsigned int CPUWriteState(uint8_t* data);
+#ifndef __LIBRETRO__
 extern bool CPUReadState(const char*);
 extern bool CPUWriteState(const char*);
 #endif
@@ -2825,6 +2825,23 @@ static uint8_t cheatsGetType(uint32_t address)
 #endif
 
 #ifdef VBAM_ENABLE_DEBUGGER
+// The writes below go straight to memory, tell the renderer about the ones
+// to VRAM, palette RAM and OAM.
+static void cheatsGfxMemoryWrite(uint32_t address, int size)
+{
+    switch (address >> 24) {
+    case 5:
+        gfxMemoryWrite(GFX_MEMORY_PALETTE, address & 0x3ff, size);
+        break;
+    case 6:
+        gfxMemoryWrite(GFX_MEMORY_VRAM, address & 0x1ffff, size);
+        break;
+    case 7:
+        gfxMemoryWrite(GFX_MEMORY_OAM, address & 0x3ff, size);
+        break;
+    }
+}
+
 void cheatsWriteMemory(uint32_t address, uint32_t value)
 {
     if (cheatsNumber == 0) {
@@ -2835,6 +2852,7 @@ void cheatsWriteMemory(uint32_t address, uint32_t value)
             cpuNextEvent = 0;
         }
         debuggerWriteMemory(address, value);
+        cheatsGfxMemoryWrite(address, 4);
     }
 }
 
@@ -2848,6 +2866,7 @@ void cheatsWriteHalfWord(uint32_t address, uint16_t value)
             cpuNextEvent = 0;
         }
         debuggerWriteHalfWord(address, value);
+        cheatsGfxMemoryWrite(address, 2);
     }
 }
 
@@ -2861,6 +2880,7 @@ void cheatsWriteByte(uint32_t address, uint8_t value)
             cpuNextEvent = 0;
         }
         debuggerWriteByte(address, value);
+        cheatsGfxMemoryWrite(address, 1);
     }
 }
 #endif
@@ -54,6 +54,12 @@ extern int cpuNextEvent;
 extern bool holdState;
 extern uint32_t cpuPrefetch[2];
 extern int cpuTotalTicks;
+// Number of ARM and Thumb instructions executed, for profiling purposes.
+extern uint64_t armOpcodeCount;
+extern uint64_t thumbOpcodeCount;
+// Set by every CPU store and by the reads of values that change without a
+// store, used by CPUCheckIdleLoop().
+extern bool cpuIdleLoopVolatile;
 extern uint8_t memoryWait[16];
 extern uint8_t memoryWait32[16];
 extern uint8_t memoryWaitSeq[16];
@@ -63,6 +69,7 @@ extern uint8_t cpuLowestBitSet[256];
 extern void CPUSwitchMode(int mode, bool saveState, bool breakLoop);
 extern void CPUSwitchMode(int mode, bool saveState);
 extern void CPUUpdateCPSR();
+extern bool CPUCheckIdleLoop();
 extern void CPUUpdateFlags(bool breakLoop);
 extern void CPUUpdateFlags();
 extern void CPUUndefinedException();
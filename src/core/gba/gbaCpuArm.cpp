@@ -2914,6 +2914,7 @@ int armExecute()
 
         if (cond_res)
             (*armInsnTable[((opcode >> 16) & 0xFF0) | ((opcode >> 4) & 0x0F)])(opcode);
+        armOpcodeCount++;
 #ifdef INSN_COUNTER
         count(opcode, cond_res);
 #endif
@@ -2960,6 +2961,10 @@ int armExecute()
             clockTicks = 1 + codeTicksAccessSeq32(oldArmNextPC);
         cpuTotalTicks += clockTicks;
 
+        if (UNLIKELY(coreOptions.skipIdleLoops) && armNextPC <= (uint32_t)oldArmNextPC &&
+            !(coreOptions.cheatsEnabled && mastercode) && CPUCheckIdleLoop() && cpuTotalTicks < cpuNextEvent)
+            cpuTotalTicks = cpuNextEvent;
+
     } while (cpuTotalTicks < cpuNextEvent && armState && !holdState && !SWITicks && !debugger);
 
     return 1;
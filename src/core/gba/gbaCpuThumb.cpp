@@ -2037,6 +2037,7 @@ int thumbExecute()
 #endif
 
         (*thumbInsnTable[opcode >> 6])(opcode);
+        thumbOpcodeCount++;
 
 #ifdef VBAM_ENABLE_DEBUGGER
         if (enableRegBreak) {
@@ -2081,6 +2082,10 @@ int thumbExecute()
             clockTicks = codeTicksAccessSeq16(oldArmNextPC) + 1;
         cpuTotalTicks += clockTicks;
 
+        if (UNLIKELY(coreOptions.skipIdleLoops) && armNextPC <= oldArmNextPC &&
+            !(coreOptions.cheatsEnabled && mastercode) && CPUCheckIdleLoop() && cpuTotalTicks < cpuNextEvent)
+            cpuTotalTicks = cpuNextEvent;
+
     } while (cpuTotalTicks < cpuNextEvent && !armState && !holdState && !SWITicks && !debugger);
     return 1;
 }
@@ -44,7 +44,11 @@ void eepromReset()
     eepromAddress = 0;
 }
 
-#ifdef __LIBRETRO__
+unsigned eepromStateSize()
+{
+    return utilDataSize(eepromSaveData) + sizeof(int) + SIZE_EEPROM_8K;
+}
+
 void eepromSaveGame(uint8_t*& data)
 {
     utilWriteDataMem(data, eepromSaveData);
@@ -59,7 +63,7 @@ void eepromReadGame(const uint8_t*& data)
     utilReadMem(eepromData, data, SIZE_EEPROM_8K);
 }
 
-#else // !__LIBRETRO__
+#ifndef __LIBRETRO__
 
 void eepromSaveGame(gzFile gzFile)
 {
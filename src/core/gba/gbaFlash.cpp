@@ -284,7 +284,11 @@ static variable_desc flashSaveData3[] = {
     { NULL, 0 }
 };
 
-#ifdef __LIBRETRO__
+unsigned flashStateSize()
+{
+    return utilDataSize(flashSaveData3);
+}
+
 void flashSaveGame(uint8_t*& data)
 {
     utilWriteDataMem(data, flashSaveData3);
@@ -295,7 +299,7 @@ void flashReadGame(const uint8_t*& data)
     utilReadDataMem(data, flashSaveData3);
 }
 
-#else // !__LIBRETRO__
+#ifndef __LIBRETRO__
 static variable_desc flashSaveData[] = {
     { &flashState, sizeof(int) },
     { &flashReadState, sizeof(int) },
@@ -11,14 +11,14 @@
 
 void flashDetectSaveType(const int size);
 
-#if defined(__LIBRETRO__)
+extern unsigned flashStateSize();
 extern void flashSaveGame(uint8_t*& data);
 extern void flashReadGame(const uint8_t*& data);
-#else  // !defined(__LIBRETRO__)
+#if !defined(__LIBRETRO__)
 extern void flashSaveGame(gzFile _gzFile);
 extern void flashReadGame(gzFile _gzFile, int version);
 extern void flashReadGameSkip(gzFile _gzFile, int version);
-#endif  // defined(__LIBRETRO__)
+#endif  // !defined(__LIBRETRO__)
 extern uint8_t flashSaveMemory[FLASH_128K_SZ];
 extern uint8_t flashRead(uint32_t address);
 extern void flashWrite(uint32_t address, uint8_t byte);
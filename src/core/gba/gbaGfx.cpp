@@ -4,6 +4,12 @@
 #include <cstring>
 #endif  // defined(TILED_RENDERING)
 
+#include "core/base/color_convert.h"
+#include "core/base/system.h"
+#ifndef __LIBRETRO__
+#include "core/gba/gbaGfxThread.h"
+#endif
+
 int g_coeff[32] = {
     0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
     16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16
@@ -20,15 +26,128 @@ bool gfxInWin0[240];
 bool gfxInWin1[240];
 int lineOBJpixleft[128];
 
-int gfxBG2Changed = 0;
-int gfxBG3Changed = 0;
-
 int gfxBG2X = 0;
 int gfxBG2Y = 0;
 int gfxBG3X = 0;
 int gfxBG3Y = 0;
 int gfxLastVCOUNT = 0;
 
+GfxLineState gfxLine;
+
+namespace {
+
+// Last WIN0H and WIN1H values gfxInWin0 and gfxInWin1 were built for.
+int gfxLastWIN0H = -1;
+int gfxLastWIN1H = -1;
+
+void gfxUpdateWindow(bool* inWin, uint16_t winH, int& lastWinH)
+{
+    if (winH == lastWinH)
+        return;
+    lastWinH = winH;
+
+    int x00 = winH >> 8;
+    int x01 = winH & 255;
+
+    if (x00 <= x01) {
+        for (int i = 0; i < 240; i++) {
+            inWin[i] = (i >= x00 && i < x01);
+        }
+    } else {
+        for (int i = 0; i < 240; i++) {
+            inWin[i] = (i >= x00 || i < x01);
+        }
+    }
+}
+
+}  // namespace
+
+void gfxDrawLine()
+{
+    if (gfxLine.clearLines) {
+        uint32_t* const lines[4] = { g_line0, g_line1, g_line2, g_line3 };
+        for (int i = 0; i < 4; i++) {
+            if (gfxLine.clearLines & (1 << i))
+                gfxClearArray(lines[i]);
+        }
+    }
+    gfxUpdateWindow(gfxInWin0, gfxLine.WIN0H, gfxLastWIN0H);
+    gfxUpdateWindow(gfxInWin1, gfxLine.WIN1H, gfxLastWIN1H);
+
+    (*gfxLine.renderLine)();
+
+    switch (systemColorDepth) {
+    case 16: {
+#ifdef __LIBRETRO__
+        uint16_t* dest = (uint16_t*)g_pix + 240 * gfxLine.VCOUNT;
+#else
+        uint16_t* dest = (uint16_t*)g_pix + 242 * (gfxLine.VCOUNT + 1);
+#endif
+        colorConvertLine16(g_lineMix, dest, 240);
+        dest += 240;
+// for filters that read past the screen
+#ifndef __LIBRETRO__
+        *dest++ = 0;
+#endif
+    } break;
+    case 24: {
+        uint8_t* dest = (uint8_t*)g_pix + 240 * gfxLine.VCOUNT * 3;
+        colorConvertLine24(g_lineMix, dest, 240);
+    } break;
+    case 32: {
+#ifdef __LIBRETRO__
+        uint32_t* dest = (uint32_t*)g_pix + 240 * gfxLine.VCOUNT;
+#else
+        uint32_t* dest = (uint32_t*)g_pix + 241 * (gfxLine.VCOUNT + 1);
+#endif
+        colorConvertLine32(g_lineMix, dest, 240);
+    } break;
+    }
+}
+
+void gfxMemoryChanged()
+{
+#ifndef __LIBRETRO__
+    gfxThreadMemoryChanged();
+#endif
+#ifndef TILED_RENDERING
+    gfxTileCacheInvalidate();
+#endif
+}
+
+#ifndef TILED_RENDERING
+GfxTileRow gfxTileRows16[0x10000 / 4];
+GfxTileRow gfxTileRows256[0x10000 / 8];
+// Every palette has its own stamp, so a row decoded with one bank never
+// matches another. A stamp of 0 marks a row as invalid.
+uint32_t gfxTileBankStamps[16] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16 };
+uint32_t gfxTileStamp256 = 17;
+static uint32_t gfxTileLastStamp = 17;
+
+uint32_t gfxTileCacheNewStamp()
+{
+    if (++gfxTileLastStamp == 0) {
+        // The old stamps would be handed out again, drop every row.
+        for (GfxTileRow& row : gfxTileRows16)
+            row.stamp = 0;
+        for (GfxTileRow& row : gfxTileRows256)
+            row.stamp = 0;
+        for (int i = 0; i < 16; i++)
+            gfxTileBankStamps[i] = i + 1;
+        gfxTileStamp256 = 17;
+        gfxTileLastStamp = 18;
+    }
+    return gfxTileLastStamp;
+}
+
+void gfxTileCacheInvalidate()
+{
+    for (int i = 0; i < 16; i++)
+        gfxTileBankStamps[i] = gfxTileCacheNewStamp();
+    gfxTileStamp256 = gfxTileCacheNewStamp();
+}
+#endif  // !TILED_RENDERING
+
 #ifdef TILED_RENDERING
 #ifdef _MSC_VER
 union uint8_th
@@ -179,9 +298,9 @@ template <TileReader readTile>
 static void gfxDrawTextScreen(uint16_t control, uint16_t hofs, uint16_t vofs,
     uint32_t* line)
 {
-    uint16_t* palette = (uint16_t*)g_paletteRAM;
-    uint8_t* charBase = &g_vram[((control >> 2) & 0x03) * 0x4000];
-    uint16_t* screenBase = (uint16_t*)&g_vram[((control >> 8) & 0x1f) * 0x800];
+    uint16_t* palette = (uint16_t*)gfxLine.paletteRAM;
+    uint8_t* charBase = &gfxLine.vram[((control >> 2) & 0x03) * 0x4000];
+    uint16_t* screenBase = (uint16_t*)&gfxLine.vram[((control >> 8) & 0x1f) * 0x800];
     uint32_t prio = ((control & 3) << 25) + 0x1000000;
     int sizeX = 256;
     int sizeY = 256;
@@ -206,13 +325,13 @@ static void gfxDrawTextScreen(uint16_t control, uint16_t hofs, uint16_t vofs,
     bool mosaicOn = (control & 0x40) ? true : false;
 
     int xxx = hofs & maskX;
-    int yyy = (vofs + VCOUNT) & maskY;
-    int mosaicX = (MOSAIC & 0x000F) + 1;
-    int mosaicY = ((MOSAIC & 0x00F0) >> 4) + 1;
+    int yyy = (vofs + gfxLine.VCOUNT) & maskY;
+    int mosaicX = (gfxLine.MOSAIC & 0x000F) + 1;
+    int mosaicY = ((gfxLine.MOSAIC & 0x00F0) >> 4) + 1;
 
     if (mosaicOn) {
-        if ((VCOUNT % mosaicY) != 0) {
-            mosaicY = VCOUNT - (VCOUNT % mosaicY);
+        if ((gfxLine.VCOUNT % mosaicY) != 0) {
+            mosaicY = gfxLine.VCOUNT - (gfxLine.VCOUNT % mosaicY);
             yyy = (vofs + mosaicY) & maskY;
         }
     }
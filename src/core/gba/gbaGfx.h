@@ -62,15 +62,158 @@ extern bool gfxInWin0[240];
 extern bool gfxInWin1[240];
 extern int lineOBJpixleft[128];
 
-extern int gfxBG2Changed;
-extern int gfxBG3Changed;
-
 extern int gfxBG2X;
 extern int gfxBG2Y;
 extern int gfxBG3X;
 extern int gfxBG3Y;
 extern int gfxLastVCOUNT;
 
+// Everything the line renderers read from the rest of the core. The CPU loop
+// captures it before each line is drawn, which lets lines be drawn on another
+// thread while emulation goes on, see gbaGfxThread.h.
+struct GfxLineState {
+    void (*renderLine)();
+    uint8_t* vram;
+    uint8_t* paletteRAM;
+    uint8_t* oam;
+    int layerEnable;
+    int customBackdropColor;
+    // Affine reference point registers written since the previous line.
+    int BG2Changed;
+    int BG3Changed;
+    // BG line buffers to clear before drawing, bit 0 for g_line0.
+    int clearLines;
+
+    uint16_t DISPCNT;
+    uint16_t VCOUNT;
+    uint16_t BG0CNT;
+    uint16_t BG1CNT;
+    uint16_t BG2CNT;
+    uint16_t BG3CNT;
+    uint16_t BG0HOFS;
+    uint16_t BG0VOFS;
+    uint16_t BG1HOFS;
+    uint16_t BG1VOFS;
+    uint16_t BG2HOFS;
+    uint16_t BG2VOFS;
+    uint16_t BG3HOFS;
+    uint16_t BG3VOFS;
+    uint16_t BG2PA;
+    uint16_t BG2PB;
+    uint16_t BG2PC;
+    uint16_t BG2PD;
+    uint16_t BG2X_L;
+    uint16_t BG2X_H;
+    uint16_t BG2Y_L;
+    uint16_t BG2Y_H;
+    uint16_t BG3PA;
+    uint16_t BG3PB;
+    uint16_t BG3PC;
+    uint16_t BG3PD;
+    uint16_t BG3X_L;
+    uint16_t BG3X_H;
+    uint16_t BG3Y_L;
+    uint16_t BG3Y_H;
+    uint16_t WIN0H;
+    uint16_t WIN1H;
+    uint16_t WIN0V;
+    uint16_t WIN1V;
+    uint16_t WININ;
+    uint16_t WINOUT;
+    uint16_t MOSAIC;
+    uint16_t BLDMOD;
+    uint16_t COLEV;
+    uint16_t COLY;
+};
+
+// The line being drawn.
+extern GfxLineState gfxLine;
+
+// Draws gfxLine to its row of g_pix.
+void gfxDrawLine();
+
+enum GfxMemory {
+    GFX_MEMORY_VRAM,
+    GFX_MEMORY_PALETTE,
+    GFX_MEMORY_OAM,
+};
+
+#ifndef TILED_RENDERING
+// Decoded text background tile rows, indexed by their offset in BG VRAM.
+// Pixels are palette colors, with 0x80000000 for transparent pixels. A row is
+// valid while its stamp matches the stamp of the palette it was decoded with,
+// gfxTileBankStamps[bank] for 16 color rows and gfxTileStamp256 for 256 color
+// rows. VRAM writes clear the stamp of the rows they touch, BG palette writes
+// renew the stamps of the palettes they touch, and any other change to VRAM
+// renews all the stamps.
+struct GfxTileRow {
+    uint32_t stamp;
+    uint32_t pixels[8];
+};
+
+extern GfxTileRow gfxTileRows16[0x10000 / 4];
+extern GfxTileRow gfxTileRows256[0x10000 / 8];
+extern uint32_t gfxTileBankStamps[16];
+extern uint32_t gfxTileStamp256;
+
+// Returns a stamp that no row has.
+uint32_t gfxTileCacheNewStamp();
+// Invalidates all the decoded tile rows.
+void gfxTileCacheInvalidate();
+#endif  // !TILED_RENDERING
+
+// Updates the renderer state derived from the memory it reads, after size
+// bytes were written at address.
+static inline void gfxMemoryWritten(GfxMemory memory, uint32_t address, int size)
+{
+#ifndef TILED_RENDERING
+    if (memory == GFX_MEMORY_VRAM) {
+        if (address < 0x10000) {
+            gfxTileRows16[address >> 2].stamp = 0;
+            gfxTileRows256[address >> 3].stamp = 0;
+        }
+    } else if (memory == GFX_MEMORY_PALETTE) {
+        if (address < 0x200) {
+            // Color 0 of a 16 color bank is transparent, so it is not part of
+            // the rows, and neither is color 0 of the 256 color palette. This
+            // keeps the cache when a game changes the backdrop every line.
+            const int bank = address >> 5;
+            const bool firstColor = (address & 0x1f) + size <= 2;
+            if (!firstColor)
+                gfxTileBankStamps[bank] = gfxTileCacheNewStamp();
+            if (!firstColor || bank != 0)
+                gfxTileStamp256 = gfxTileCacheNewStamp();
+        }
+    }
+#else
+    (void)memory;
+    (void)address;
+    (void)size;
+#endif
+}
+
+#ifndef __LIBRETRO__
+extern bool gfxThreadEnabled;
+void gfxThreadMemoryWrite(GfxMemory memory, uint32_t address, int size);
+#endif
+
+// Called by the CPU write functions after size bytes were written at address
+// in VRAM, palette RAM or OAM.
+static inline void gfxMemoryWrite(GfxMemory memory, uint32_t address, int size)
+{
+#ifndef __LIBRETRO__
+    if (gfxThreadEnabled) {
+        gfxThreadMemoryWrite(memory, address, size);
+        return;
+    }
+#endif
+    gfxMemoryWritten(memory, address, size);
+}
+
+// Must be called when VRAM, palette RAM or OAM are changed without going
+// through the CPU write functions.
+void gfxMemoryChanged();
+
 static inline void gfxClearArray(uint32_t* array)
 {
     for (int i = 0; i < 240; i++) {
@@ -79,11 +222,66 @@ static inline void gfxClearArray(uint32_t* array)
 }
 
 #ifndef TILED_RENDERING
+static const uint32_t gfxTransparentTileRow[8] = {
+    0x80000000, 0x80000000, 0x80000000, 0x80000000,
+    0x80000000, 0x80000000, 0x80000000, 0x80000000
+};
+
+// Returns the pixels of the 16 color tile row at offset in BG VRAM, decoding
+// it with the given palette bank if it is not cached yet.
+static inline const uint32_t* gfxReadTileRow16(size_t offset, int bank)
+{
+    if (offset >= 0x10000) {
+        // Adapted from https://github.com/mgba-emu/mgba/commit/4ce9b83362ad66b1421afea7372adfc753bce97c
+        // Real hardware PPU uses the most recently read from background
+        // VRAM. This can't be easily emulated in vba-m, so we simply
+        // use 0 here.
+        return gfxTransparentTileRow;
+    }
+
+    GfxTileRow& row = gfxTileRows16[offset >> 2];
+    const uint32_t stamp = gfxTileBankStamps[bank];
+    if (row.stamp != stamp) {
+        uint16_t* palette = &((uint16_t*)gfxLine.paletteRAM)[bank << 4];
+        for (int i = 0; i < 8; i++) {
+            uint8_t color = gfxLine.vram[offset + (i >> 1)];
+            if (i & 1) {
+                color = (color >> 4);
+            } else {
+                color &= 0x0F;
+            }
+            row.pixels[i] = color ? READ16LE(&palette[color]) : 0x80000000;
+        }
+        row.stamp = stamp;
+    }
+    return row.pixels;
+}
+
+// Returns the pixels of the 256 color tile row at offset in BG VRAM, decoding
+// it if it is not cached yet.
+static inline const uint32_t* gfxReadTileRow256(size_t offset)
+{
+    if (offset >= 0x10000) {
+        // See gfxReadTileRow16().
+        return gfxTransparentTileRow;
+    }
+
+    GfxTileRow& row = gfxTileRows256[offset >> 3];
+    if (row.stamp != gfxTileStamp256) {
+        uint16_t* palette = (uint16_t*)gfxLine.paletteRAM;
+        for (int i = 0; i < 8; i++) {
+            uint8_t color = gfxLine.vram[offset + i];
+            row.pixels[i] = color ? READ16LE(&palette[color]) : 0x80000000;
+        }
+        row.stamp = gfxTileStamp256;
+    }
+    return row.pixels;
+}
+
 static inline void gfxDrawTextScreen(uint16_t control, uint16_t hofs, uint16_t vofs, uint32_t* line)
 {
-    uint16_t* palette = (uint16_t*)g_paletteRAM;
     const size_t charBankBaseOffset = ((control >> 2) & 0x03) * 0x4000;
-    uint16_t* screenBase = (uint16_t*)&g_vram[((control >> 8) & 0x1f) * 0x800];
+    uint16_t* screenBase = (uint16_t*)&gfxLine.vram[((control >> 8) & 0x1f) * 0x800];
     uint32_t prio = ((control & 3) << 25) + 0x1000000;
     int sizeX = 256;
     int sizeY = 256;
@@ -108,13 +306,13 @@ static inline void gfxDrawTextScreen(uint16_t control, uint16_t hofs, uint16_t v
     bool mosaicOn = (control & 0x40) ? true : false;
 
     int xxx = hofs & maskX;
-    int yyy = (vofs + VCOUNT) & maskY;
-    int mosaicX = (MOSAIC & 0x000F) + 1;
-    int mosaicY = ((MOSAIC & 0x00F0) >> 4) + 1;
+    int yyy = (vofs + gfxLine.VCOUNT) & maskY;
+    int mosaicX = (gfxLine.MOSAIC & 0x000F) + 1;
+    int mosaicY = ((gfxLine.MOSAIC & 0x00F0) >> 4) + 1;
 
     if (mosaicOn) {
-        if ((VCOUNT % mosaicY) != 0) {
-            mosaicY = VCOUNT - (VCOUNT % mosaicY);
+        if ((gfxLine.VCOUNT % mosaicY) != 0) {
+            mosaicY = gfxLine.VCOUNT - (gfxLine.VCOUNT % mosaicY);
             yyy = (vofs + mosaicY) & maskY;
         }
     }
@@ -127,103 +325,55 @@ static inline void gfxDrawTextScreen(uint16_t control, uint16_t hofs, uint16_t v
     }
 
     int yshift = ((yyy >> 3) << 5);
-    if ((control)&0x80) {
-        uint16_t* screenSource = screenBase + 0x400 * (xxx >> 8) + ((xxx & 255) >> 3) + yshift;
-        for (int x = 0; x < 240; x++) {
-            uint16_t data = READ16LE(screenSource);
-
-            int tile = data & 0x3FF;
-            int tileX = (xxx & 7);
-            int tileY = yyy & 7;
-
-            if (tileX == 7)
-                screenSource++;
-
-            if (data & 0x0400)
-                tileX = 7 - tileX;
-            if (data & 0x0800)
-                tileY = 7 - tileY;
-
-            const size_t charBankOffset = tile * 64 + tileY * 8 + tileX;
-            const size_t charBankTotalOffset = charBankOffset + charBankBaseOffset;
-            uint8_t color;
-            if (charBankTotalOffset >= 0x10000) {
-                // Adapted from https://github.com/mgba-emu/mgba/commit/4ce9b83362ad66b1421afea7372adfc753bce97c
-                // Real hardware PPU uses the most recently read from background
-                // VRAM. This can't be easily emulated in vba-m, so we simply
-                // use 0 here.
-                color = 0;
-            } else {
-                color = g_vram[charBankTotalOffset];
-            }
-
-            line[x] = color ? (READ16LE(&palette[color]) | prio) : 0x80000000;
-
-            xxx++;
-            if (xxx == 256) {
-                if (sizeX > 256)
-                    screenSource = screenBase + 0x400 + yshift;
-                else {
-                    screenSource = screenBase + yshift;
-                    xxx = 0;
-                }
-            } else if (xxx >= sizeX) {
-                xxx = 0;
-                screenSource = screenBase + yshift;
-            }
+    int tileY = yyy & 7;
+
+    // Whole tiles are drawn to tiles[], starting with the one under the first
+    // pixel, and the visible 240 pixels are copied to the line afterwards.
+    uint32_t tiles[248];
+    const int firstTileX = xxx & 7;
+    xxx &= ~7;
+
+    uint16_t* screenSource = screenBase + 0x400 * (xxx >> 8) + ((xxx & 255) >> 3) + yshift;
+    for (int x = 0; x < 240 + firstTileX; x += 8) {
+        uint16_t data = READ16LE(screenSource);
+
+        int tile = data & 0x3FF;
+        int tileRow = (data & 0x0800) ? 7 - tileY : tileY;
+
+        const uint32_t* pixels;
+        if (control & 0x80)
+            pixels = gfxReadTileRow256(charBankBaseOffset + tile * 64 + tileRow * 8);
+        else
+            pixels = gfxReadTileRow16(charBankBaseOffset + (tile << 5) + (tileRow << 2), data >> 12);
+
+        if (data & 0x0400) {
+            for (int i = 0; i < 8; i++)
+                tiles[x + i] = pixels[7 - i];
+        } else {
+            for (int i = 0; i < 8; i++)
+                tiles[x + i] = pixels[i];
         }
-    } else {
-        uint16_t* screenSource = screenBase + 0x400 * (xxx >> 8) + ((xxx & 255) >> 3) + yshift;
-        for (int x = 0; x < 240; x++) {
-            uint16_t data = READ16LE(screenSource);
-
-            int tile = data & 0x3FF;
-            int tileX = (xxx & 7);
-            int tileY = yyy & 7;
-
-            if (tileX == 7)
-                screenSource++;
-
-            if (data & 0x0400)
-                tileX = 7 - tileX;
-            if (data & 0x0800)
-                tileY = 7 - tileY;
-
-            const size_t charBankOffset = (tile << 5) + (tileY << 2) + (tileX >> 1);
-            const size_t charBankTotalOffset = charBankOffset + charBankBaseOffset;
-            uint8_t color;
-            if (charBankTotalOffset >= 0x10000) {
-                // Adapted from https://github.com/mgba-emu/mgba/commit/4ce9b83362ad66b1421afea7372adfc753bce97c
-                // Real hardware PPU uses the most recently read from background
-                // VRAM. This can't be easily emulated in vba-m, so we simply
-                // use 0 here.
-                color = 0;
-            } else {
-                color = g_vram[charBankTotalOffset];
-                if (tileX & 1) {
-                    color = (color >> 4);
-                } else {
-                    color &= 0x0F;
-                }
-            }
 
-            int pal = (data >> 8) & 0xF0;
-            line[x] = color ? (READ16LE(&palette[pal + color]) | prio) : 0x80000000;
-
-            xxx++;
-            if (xxx == 256) {
-                if (sizeX > 256)
-                    screenSource = screenBase + 0x400 + yshift;
-                else {
-                    screenSource = screenBase + yshift;
-                    xxx = 0;
-                }
-            } else if (xxx >= sizeX) {
-                xxx = 0;
+        screenSource++;
+        xxx += 8;
+        if (xxx == 256) {
+            if (sizeX > 256)
+                screenSource = screenBase + 0x400 + yshift;
+            else {
                 screenSource = screenBase + yshift;
+                xxx = 0;
             }
+        } else if (xxx >= sizeX) {
+            xxx = 0;
+            screenSource = screenBase + yshift;
         }
     }
+
+    for (int x = 0; x < 240; x++) {
+        uint32_t color = tiles[firstTileX + x];
+        line[x] = (color & 0x80000000) ? color : (color | prio);
+    }
+
     if (mosaicOn) {
         if (mosaicX > 1) {
             int m = 1;
@@ -244,9 +394,9 @@ static inline void gfxDrawRotScreen(uint16_t control, uint16_t x_l, uint16_t x_h
     uint16_t pc, uint16_t pd, int& currentX, int& currentY, int changed,
     uint32_t* line)
 {
-    uint16_t* palette = (uint16_t*)g_paletteRAM;
-    uint8_t* charBase = &g_vram[((control >> 2) & 0x03) * 0x4000];
-    uint8_t* screenBase = (uint8_t*)&g_vram[((control >> 8) & 0x1f) * 0x800];
+    uint16_t* palette = (uint16_t*)gfxLine.paletteRAM;
+    uint8_t* charBase = &gfxLine.vram[((control >> 2) & 0x03) * 0x4000];
+    uint8_t* screenBase = (uint8_t*)&gfxLine.vram[((control >> 8) & 0x1f) * 0x800];
     int prio = ((control & 3) << 25) + 0x1000000;
 
     int sizeX = 128;
@@ -283,7 +433,7 @@ static inline void gfxDrawRotScreen(uint16_t control, uint16_t x_l, uint16_t x_h
     if (pd & 0x8000)
         dmy |= 0xFFFF8000;
 
-    if (VCOUNT == 0)
+    if (gfxLine.VCOUNT == 0)
         changed = 3;
 
     if (changed & 1) {
@@ -306,8 +456,8 @@ static inline void gfxDrawRotScreen(uint16_t control, uint16_t x_l, uint16_t x_h
     int realY = currentY;
 
     if (control & 0x40) {
-        int mosaicY = ((MOSAIC & 0xF0) >> 4) + 1;
-        int y = (VCOUNT % mosaicY);
+        int mosaicY = ((gfxLine.MOSAIC & 0xF0) >> 4) + 1;
+        int y = (gfxLine.VCOUNT % mosaicY);
         realX -= y * dmx;
         realY -= y * dmy;
     }
@@ -352,7 +502,7 @@ static inline void gfxDrawRotScreen(uint16_t control, uint16_t x_l, uint16_t x_h
     }
 
     if (control & 0x40) {
-        int mosaicX = (MOSAIC & 0xF) + 1;
+        int mosaicX = (gfxLine.MOSAIC & 0xF) + 1;
         if (mosaicX > 1) {
             int m = 1;
             for (int i = 0; i < 239; i++) {
@@ -371,7 +521,7 @@ static inline void gfxDrawRotScreen16Bit(uint16_t control, uint16_t x_l, uint16_
     uint16_t pb, uint16_t pc, uint16_t pd, int& currentX, int& currentY,
     int changed, uint32_t* line)
 {
-    uint16_t* screenBase = (uint16_t*)&g_vram[0];
+    uint16_t* screenBase = (uint16_t*)&gfxLine.vram[0];
     int prio = ((control & 3) << 25) + 0x1000000;
     int sizeX = 240;
     int sizeY = 160;
@@ -396,7 +546,7 @@ static inline void gfxDrawRotScreen16Bit(uint16_t control, uint16_t x_l, uint16_
     if (pd & 0x8000)
         dmy |= 0xFFFF8000;
 
-    if (VCOUNT == 0)
+    if (gfxLine.VCOUNT == 0)
         changed = 3;
 
     if (changed & 1) {
@@ -418,8 +568,8 @@ static inline void gfxDrawRotScreen16Bit(uint16_t control, uint16_t x_l, uint16_
     int realY = currentY;
 
     if (control & 0x40) {
-        int mosaicY = ((MOSAIC & 0xF0) >> 4) + 1;
-        int y = (VCOUNT % mosaicY);
+        int mosaicY = ((gfxLine.MOSAIC & 0xF0) >> 4) + 1;
+        int y = (gfxLine.VCOUNT % mosaicY);
         realX -= y * dmx;
         realY -= y * dmy;
     }
@@ -441,7 +591,7 @@ static inline void gfxDrawRotScreen16Bit(uint16_t control, uint16_t x_l, uint16_
     }
 
     if (control & 0x40) {
-        int mosaicX = (MOSAIC & 0xF) + 1;
+        int mosaicX = (gfxLine.MOSAIC & 0xF) + 1;
         if (mosaicX > 1) {
             int m = 1;
             for (int i = 0; i < 239; i++) {
@@ -460,8 +610,8 @@ static inline void gfxDrawRotScreen256(uint16_t control, uint16_t x_l, uint16_t
     uint16_t pb, uint16_t pc, uint16_t pd, int& currentX, int& currentY,
     int changed, uint32_t* line)
 {
-    uint16_t* palette = (uint16_t*)g_paletteRAM;
-    uint8_t* screenBase = (DISPCNT & 0x0010) ? &g_vram[0xA000] : &g_vram[0x0000];
+    uint16_t* palette = (uint16_t*)gfxLine.paletteRAM;
+    uint8_t* screenBase = (gfxLine.DISPCNT & 0x0010) ? &gfxLine.vram[0xA000] : &gfxLine.vram[0x0000];
     int prio = ((control & 3) << 25) + 0x1000000;
     int sizeX = 240;
     int sizeY = 160;
@@ -486,7 +636,7 @@ static inline void gfxDrawRotScreen256(uint16_t control, uint16_t x_l, uint16_t
     if (pd & 0x8000)
         dmy |= 0xFFFF8000;
 
-    if (VCOUNT == 0)
+    if (gfxLine.VCOUNT == 0)
         changed = 3;
 
     if (changed & 1) {
@@ -509,8 +659,8 @@ static inline void gfxDrawRotScreen256(uint16_t control, uint16_t x_l, uint16_t
     int realY = currentY;
 
     if (control & 0x40) {
-        int mosaicY = ((MOSAIC & 0xF0) >> 4) + 1;
-        int y = VCOUNT - (VCOUNT % mosaicY);
+        int mosaicY = ((gfxLine.MOSAIC & 0xF0) >> 4) + 1;
+        int y = gfxLine.VCOUNT - (gfxLine.VCOUNT % mosaicY);
         realX = startX + y * dmx;
         realY = startY + y * dmy;
     }
@@ -534,7 +684,7 @@ static inline void gfxDrawRotScreen256(uint16_t control, uint16_t x_l, uint16_t
     }
 
     if (control & 0x40) {
-        int mosaicX = (MOSAIC & 0xF) + 1;
+        int mosaicX = (gfxLine.MOSAIC & 0xF) + 1;
         if (mosaicX > 1) {
             int m = 1;
             for (int i = 0; i < 239; i++) {
@@ -553,7 +703,7 @@ static inline void gfxDrawRotScreen16Bit160(uint16_t control, uint16_t x_l, uint
     uint16_t pb, uint16_t pc, uint16_t pd, int& currentX, int& currentY,
     int changed, uint32_t* line)
 {
-    uint16_t* screenBase = (DISPCNT & 0x0010) ? (uint16_t*)&g_vram[0xa000] : (uint16_t*)&g_vram[0];
+    uint16_t* screenBase = (gfxLine.DISPCNT & 0x0010) ? (uint16_t*)&gfxLine.vram[0xa000] : (uint16_t*)&gfxLine.vram[0];
     int prio = ((control & 3) << 25) + 0x1000000;
     int sizeX = 160;
     int sizeY = 128;
@@ -578,7 +728,7 @@ static inline void gfxDrawRotScreen16Bit160(uint16_t control, uint16_t x_l, uint
     if (pd & 0x8000)
         dmy |= 0xFFFF8000;
 
-    if (VCOUNT == 0)
+    if (gfxLine.VCOUNT == 0)
         changed = 3;
 
     if (changed & 1) {
@@ -601,8 +751,8 @@ static inline void gfxDrawRotScreen16Bit160(uint16_t control, uint16_t x_l, uint
     int realY = currentY;
 
     if (control & 0x40) {
-        int mosaicY = ((MOSAIC & 0xF0) >> 4) + 1;
-        int y = VCOUNT - (VCOUNT % mosaicY);
+        int mosaicY = ((gfxLine.MOSAIC & 0xF0) >> 4) + 1;
+        int y = gfxLine.VCOUNT - (gfxLine.VCOUNT % mosaicY);
         realX = startX + y * dmx;
         realY = startY + y * dmy;
     }
@@ -624,7 +774,7 @@ static inline void gfxDrawRotScreen16Bit160(uint16_t control, uint16_t x_l, uint
     }
 
     if (control & 0x40) {
-        int mosaicX = (MOSAIC & 0xF) + 1;
+        int mosaicX = (gfxLine.MOSAIC & 0xF) + 1;
         if (mosaicX > 1) {
             int m = 1;
             for (int i = 0; i < 239; i++) {
@@ -644,14 +794,14 @@ static inline void gfxDrawSprites(uint32_t* lineOBJ)
     // lineOBJpix is used to keep track of the drawn OBJs
     // and to stop drawing them if the 'maximum number of OBJ per line'
     // has been reached.
-    int lineOBJpix = (DISPCNT & 0x20) ? 954 : 1226;
+    int lineOBJpix = (gfxLine.DISPCNT & 0x20) ? 954 : 1226;
     int m = 0;
     gfxClearArray(lineOBJ);
-    if (coreOptions.layerEnable & 0x1000) {
-        uint16_t* sprites = (uint16_t*)g_oam;
-        uint16_t* spritePalette = &((uint16_t*)g_paletteRAM)[256];
-        int mosaicY = ((MOSAIC & 0xF000) >> 12) + 1;
-        int mosaicX = ((MOSAIC & 0xF00) >> 8) + 1;
+    if (gfxLine.layerEnable & 0x1000) {
+        uint16_t* sprites = (uint16_t*)gfxLine.oam;
+        uint16_t* spritePalette = &((uint16_t*)gfxLine.paletteRAM)[256];
+        int mosaicY = ((gfxLine.MOSAIC & 0xF000) >> 12) + 1;
+        int mosaicX = ((gfxLine.MOSAIC & 0xF00) >> 8) + 1;
         for (int x = 0; x < 128; x++) {
             uint16_t a0 = READ16LE(sprites++);
             uint16_t a1 = READ16LE(sprites++);
@@ -696,7 +846,7 @@ static inline void gfxDrawSprites(uint32_t* lineOBJ)
             int sx = (a1 & 0x1FF);
 
             // computes ticks used by OBJ-WIN if OBJWIN is enabled
-            if (((a0 & 0x0c00) == 0x0800) && (coreOptions.layerEnable & 0x8000)) {
+            if (((a0 & 0x0c00) == 0x0800) && (gfxLine.layerEnable & 0x8000)) {
                 if ((a0 & 0x0300) == 0x0300) {
                     sizeX <<= 1;
                     sizeY <<= 1;
@@ -710,7 +860,7 @@ static inline void gfxDrawSprites(uint32_t* lineOBJ)
                     sx = 0;
                 } else if ((sx + sizeX) > 240)
                     sizeX = 240 - sx;
-                if ((VCOUNT >= sy) && (VCOUNT < sy + sizeY) && (sx < 240)) {
+                if ((gfxLine.VCOUNT >= sy) && (gfxLine.VCOUNT < sy + sizeY) && (sx < 240)) {
                     if (a0 & 0x0100)
                         lineOBJpix -= 8 + 2 * sizeX;
                     else
@@ -734,7 +884,7 @@ static inline void gfxDrawSprites(uint32_t* lineOBJ)
                 }
                 if ((sy + fieldY) > 256)
                     sy -= 256;
-                int t = VCOUNT - sy;
+                int t = gfxLine.VCOUNT - sy;
                 if ((t >= 0) && (t < fieldY)) {
                     int startpix = 0;
                     if ((sx + fieldX) > 512) {
@@ -745,7 +895,7 @@ static inline void gfxDrawSprites(uint32_t* lineOBJ)
                             lineOBJpix -= 8;
                             // int t2 = t - (fieldY >> 1);
                             int rot = (a1 >> 9) & 0x1F;
-                            uint16_t* OAM = (uint16_t*)g_oam;
+                            uint16_t* OAM = (uint16_t*)gfxLine.oam;
                             int dx = READ16LE(&OAM[3 + (rot << 4)]);
                             if (dx & 0x8000)
                                 dx |= 0xFFFF8000;
@@ -770,10 +920,10 @@ static inline void gfxDrawSprites(uint32_t* lineOBJ)
 
                             if (a0 & 0x2000) {
                                 int c = (a2 & 0x3FF);
-                                if ((DISPCNT & 7) > 2 && (c < 512))
+                                if ((gfxLine.DISPCNT & 7) > 2 && (c < 512))
                                     continue;
                                 int inc = 32;
-                                if (DISPCNT & 0x40)
+                                if (gfxLine.DISPCNT & 0x40)
                                     inc = sizeX >> 2;
                                 else
                                     c &= 0x3FE;
@@ -788,7 +938,7 @@ static inline void gfxDrawSprites(uint32_t* lineOBJ)
                                     if (xxx < 0 || xxx >= sizeX || yyy < 0 || yyy >= sizeY || sx >= 240)
                                         ;
                                     else {
-                                        uint32_t color = g_vram
+                                        uint32_t color = gfxLine.vram
                                             [0x10000 + ((((c + (yyy >> 3) * inc)
                                                              << 5)
                                                             + ((yyy & 7)
@@ -839,11 +989,11 @@ static inline void gfxDrawSprites(uint32_t* lineOBJ)
                                 }
                             } else {
                                 int c = (a2 & 0x3FF);
-                                if ((DISPCNT & 7) > 2 && (c < 512))
+                                if ((gfxLine.DISPCNT & 7) > 2 && (c < 512))
                                     continue;
 
                                 int inc = 32;
-                                if (DISPCNT & 0x40)
+                                if (gfxLine.DISPCNT & 0x40)
                                     inc = sizeX >> 3;
                                 int palette = (a2 >> 8) & 0xF0;
                                 for (int y = 0; y < fieldX; y++) {
@@ -856,7 +1006,7 @@ static inline void gfxDrawSprites(uint32_t* lineOBJ)
                                     if (xxx < 0 || xxx >= sizeX || yyy < 0 || yyy >= sizeY || sx >= 240)
                                         ;
                                     else {
-                                        uint32_t color = g_vram
+                                        uint32_t color = gfxLine.vram
                                             [0x10000 + ((((c + (yyy >> 3) * inc)
                                                              << 5)
                                                             + ((yyy & 7)
@@ -916,7 +1066,7 @@ static inline void gfxDrawSprites(uint32_t* lineOBJ)
             } else {
                 if (sy + sizeY > 256)
                     sy -= 256;
-                int t = VCOUNT - sy;
+                int t = gfxLine.VCOUNT - sy;
                 if ((t >= 0) && (t < sizeY)) {
                     int startpix = 0;
                     if ((sx + sizeX) > 512) {
@@ -928,11 +1078,11 @@ static inline void gfxDrawSprites(uint32_t* lineOBJ)
                             if (a1 & 0x2000)
                                 t = sizeY - t - 1;
                             int c = (a2 & 0x3FF);
-                            if ((DISPCNT & 7) > 2 && (c < 512))
+                            if ((gfxLine.DISPCNT & 7) > 2 && (c < 512))
                                 continue;
 
                             int inc = 32;
-                            if (DISPCNT & 0x40) {
+                            if (gfxLine.DISPCNT & 0x40) {
                                 inc = sizeX >> 2;
                             } else {
                                 c &= 0x3FE;
@@ -957,7 +1107,7 @@ static inline void gfxDrawSprites(uint32_t* lineOBJ)
                                 if (lineOBJpix < 0)
                                     continue;
                                 if (sx < 240) {
-                                    uint8_t color = g_vram[address];
+                                    uint8_t color = gfxLine.vram[address];
                                     if ((color == 0) && (((prio >> 25) & 3) < ((lineOBJ[sx] >> 25) & 3))) {
                                         lineOBJ[sx] = (lineOBJ[sx] & 0xF9FFFFFF) | prio;
                                         if ((a0 & 0x1000) && m)
@@ -1014,11 +1164,11 @@ static inline void gfxDrawSprites(uint32_t* lineOBJ)
                             if (a1 & 0x2000)
                                 t = sizeY - t - 1;
                             int c = (a2 & 0x3FF);
-                            if ((DISPCNT & 7) > 2 && (c < 512))
+                            if ((gfxLine.DISPCNT & 7) > 2 && (c < 512))
                                 continue;
 
                             int inc = 32;
-                            if (DISPCNT & 0x40) {
+                            if (gfxLine.DISPCNT & 0x40) {
                                 inc = sizeX >> 3;
                             }
                             int xxx = 0;
@@ -1041,7 +1191,7 @@ static inline void gfxDrawSprites(uint32_t* lineOBJ)
                                     if (lineOBJpix < 0)
                                         continue;
                                     if (sx < 240) {
-                                        uint8_t color = g_vram[address];
+                                        uint8_t color = gfxLine.vram[address];
                                         if (xx & 1) {
                                             color = (color >> 4);
                                         } else
@@ -1100,7 +1250,7 @@ static inline void gfxDrawSprites(uint32_t* lineOBJ)
                                     if (lineOBJpix < 0)
                                         continue;
                                     if (sx < 240) {
-                                        uint8_t color = g_vram[address];
+                                        uint8_t color = gfxLine.vram[address];
                                         if (xx & 1) {
                                             color = (color >> 4);
                                         } else
@@ -1164,9 +1314,9 @@ static inline void gfxDrawSprites(uint32_t* lineOBJ)
 static inline void gfxDrawOBJWin(uint32_t* lineOBJWin)
 {
     gfxClearArray(lineOBJWin);
-    if ((coreOptions.layerEnable & 0x9000) == 0x9000) {
-        uint16_t* sprites = (uint16_t*)g_oam;
-        // uint16_t *spritePalette = &((uint16_t *)g_paletteRAM)[256];
+    if ((gfxLine.layerEnable & 0x9000) == 0x9000) {
+        uint16_t* sprites = (uint16_t*)gfxLine.oam;
+        // uint16_t *spritePalette = &((uint16_t *)gfxLine.paletteRAM)[256];
         for (int x = 0; x < 128; x++) {
             int lineOBJpix = lineOBJpixleft[x];
             uint16_t a0 = READ16LE(sprites++);
@@ -1215,7 +1365,7 @@ static inline void gfxDrawOBJWin(uint32_t* lineOBJWin)
                 }
                 if ((sy + fieldY) > 256)
                     sy -= 256;
-                int t = VCOUNT - sy;
+                int t = gfxLine.VCOUNT - sy;
                 if ((t >= 0) && (t < fieldY)) {
                     int sx = (a1 & 0x1FF);
                     int startpix = 0;
@@ -1226,7 +1376,7 @@ static inline void gfxDrawOBJWin(uint32_t* lineOBJWin)
                         lineOBJpix -= 8;
                         // int t2 = t - (fieldY >> 1);
                         int rot = (a1 >> 9) & 0x1F;
-                        uint16_t* OAM = (uint16_t*)g_oam;
+                        uint16_t* OAM = (uint16_t*)gfxLine.oam;
                         int dx = READ16LE(&OAM[3 + (rot << 4)]);
                         if (dx & 0x8000)
                             dx |= 0xFFFF8000;
@@ -1248,10 +1398,10 @@ static inline void gfxDrawOBJWin(uint32_t* lineOBJWin)
 
                         if (a0 & 0x2000) {
                             int c = (a2 & 0x3FF);
-                            if ((DISPCNT & 7) > 2 && (c < 512))
+                            if ((gfxLine.DISPCNT & 7) > 2 && (c < 512))
                                 continue;
                             int inc = 32;
-                            if (DISPCNT & 0x40)
+                            if (gfxLine.DISPCNT & 0x40)
                                 inc = sizeX >> 2;
                             else
                                 c &= 0x3FE;
@@ -1265,7 +1415,7 @@ static inline void gfxDrawOBJWin(uint32_t* lineOBJWin)
 
                                 if (xxx < 0 || xxx >= sizeX || yyy < 0 || yyy >= sizeY || sx >= 240) {
                                 } else {
-                                    uint32_t color = g_vram
+                                    uint32_t color = gfxLine.vram
                                         [0x10000 + ((((c + (yyy >> 3) * inc)
                                                          << 5)
                                                         + ((yyy & 7) << 3) + ((xxx >> 3) << 6) + (xxx & 7))
@@ -1280,11 +1430,11 @@ static inline void gfxDrawOBJWin(uint32_t* lineOBJWin)
                             }
                         } else {
                             int c = (a2 & 0x3FF);
-                            if ((DISPCNT & 7) > 2 && (c < 512))
+                            if ((gfxLine.DISPCNT & 7) > 2 && (c < 512))
                                 continue;
 
                             int inc = 32;
-                            if (DISPCNT & 0x40)
+                            if (gfxLine.DISPCNT & 0x40)
                                 inc = sizeX >> 3;
                             // int palette = (a2 >> 8) & 0xF0;
                             for (int y = 0; y < fieldX; y++) {
@@ -1304,7 +1454,7 @@ static inline void gfxDrawOBJWin(uint32_t* lineOBJWin)
                                 //              } else {
                                 if (xxx < 0 || xxx >= sizeX || yyy < 0 || yyy >= sizeY || sx >= 240) {
                                 } else {
-                                    uint32_t color = g_vram
+                                    uint32_t color = gfxLine.vram
                                         [0x10000 + ((((c + (yyy >> 3) * inc)
                                                          << 5)
                                                         + ((yyy & 7) << 2) + ((xxx >> 3) << 5) + ((xxx & 7) >> 1))
@@ -1329,7 +1479,7 @@ static inline void gfxDrawOBJWin(uint32_t* lineOBJWin)
             } else {
                 if ((sy + sizeY) > 256)
                     sy -= 256;
-                int t = VCOUNT - sy;
+                int t = gfxLine.VCOUNT - sy;
                 if ((t >= 0) && (t < sizeY)) {
                     int sx = (a1 & 0x1FF);
                     int startpix = 0;
@@ -1342,11 +1492,11 @@ static inline void gfxDrawOBJWin(uint32_t* lineOBJWin)
                             if (a1 & 0x2000)
                                 t = sizeY - t - 1;
                             int c = (a2 & 0x3FF);
-                            if ((DISPCNT & 7) > 2 && (c < 512))
+                            if ((gfxLine.DISPCNT & 7) > 2 && (c < 512))
                                 continue;
 
                             int inc = 32;
-                            if (DISPCNT & 0x40) {
+                            if (gfxLine.DISPCNT & 0x40) {
                                 inc = sizeX >> 2;
                             } else {
                                 c &= 0x3FE;
@@ -1365,7 +1515,7 @@ static inline void gfxDrawOBJWin(uint32_t* lineOBJWin)
                                 if (lineOBJpix < 0)
                                     continue;
                                 if (sx < 240) {
-                                    uint8_t color = g_vram[address];
+                                    uint8_t color = gfxLine.vram[address];
                                     if (color) {
                                         lineOBJWin[sx] = 1;
                                     }
@@ -1396,11 +1546,11 @@ static inline void gfxDrawOBJWin(uint32_t* lineOBJWin)
                             if (a1 & 0x2000)
                                 t = sizeY - t - 1;
                             int c = (a2 & 0x3FF);
-                            if ((DISPCNT & 7) > 2 && (c < 512))
+                            if ((gfxLine.DISPCNT & 7) > 2 && (c < 512))
                                 continue;
 
                             int inc = 32;
-                            if (DISPCNT & 0x40) {
+                            if (gfxLine.DISPCNT & 0x40) {
                                 inc = sizeX >> 3;
                             }
                             int xxx = 0;
@@ -1419,7 +1569,7 @@ static inline void gfxDrawOBJWin(uint32_t* lineOBJWin)
                                     if (lineOBJpix < 0)
                                         continue;
                                     if (sx < 240) {
-                                        uint8_t color = g_vram[address];
+                                        uint8_t color = gfxLine.vram[address];
                                         if (xx & 1) {
                                             color = (color >> 4);
                                         } else
@@ -1449,7 +1599,7 @@ static inline void gfxDrawOBJWin(uint32_t* lineOBJWin)
                                     if (lineOBJpix < 0)
                                         continue;
                                     if (sx < 240) {
-                                        uint8_t color = g_vram[address];
+                                        uint8_t color = gfxLine.vram[address];
                                         if (xx & 1) {
                                             color = (color >> 4);
                                         } else
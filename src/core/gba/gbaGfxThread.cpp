@@ -0,0 +1,235 @@
+#include "core/gba/gbaGfxThread.h"
+
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#include "core/base/system.h"
+#include "core/gba/gba.h"
+#include "core/gba/gbaGlobals.h"
+
+bool gfxThreadEnabled = false;
+
+namespace {
+
+// Both sizes must be powers of 2. There are fewer lines in a frame than jobs,
+// and the CPU waits for the queue to drain at every VBlank.
+constexpr size_t kJobCount = 256;
+constexpr size_t kWriteLogSize = 1 << 16;
+
+struct GfxJob {
+    GfxLineState state;
+    // Position in the write log of the first write made after this line.
+    size_t writesEnd;
+    // False for jobs that only apply the logged writes.
+    bool draw;
+};
+
+struct GfxWrite {
+    uint32_t value;
+    uint32_t address;
+    uint8_t memory;
+    uint8_t size;
+};
+
+uint8_t gfxThreadVRAM[SIZE_VRAM];
+uint8_t gfxThreadPaletteRAM[SIZE_PRAM];
+uint8_t gfxThreadOAM[SIZE_OAM];
+
+GfxJob gfxJobs[kJobCount];
+GfxWrite gfxWriteLog[kWriteLogSize];
+
+std::thread gfxThread;
+std::mutex gfxMutex;
+// Signaled by the CPU when a job is queued and the render thread is idle.
+std::condition_variable gfxWork;
+// Signaled by the render thread when a job is done.
+std::condition_variable gfxDone;
+
+// Guarded by gfxMutex.
+size_t gfxJobsQueued = 0;
+size_t gfxJobsDone = 0;
+size_t gfxWritesApplied = 0;
+bool gfxThreadIdle = false;
+bool gfxThreadStopping = false;
+
+// Only used by the CPU.
+size_t gfxWritesLogged = 0;
+size_t gfxWritesLimit = kWriteLogSize;
+
+uint8_t* gfxCoreMemory(uint8_t memory)
+{
+    switch (memory) {
+    case GFX_MEMORY_VRAM:
+        return g_vram;
+    case GFX_MEMORY_PALETTE:
+        return g_paletteRAM;
+    default:
+        return g_oam;
+    }
+}
+
+uint8_t* gfxThreadMemory(uint8_t memory)
+{
+    switch (memory) {
+    case GFX_MEMORY_VRAM:
+        return gfxThreadVRAM;
+    case GFX_MEMORY_PALETTE:
+        return gfxThreadPaletteRAM;
+    default:
+        return gfxThreadOAM;
+    }
+}
+
+void gfxThreadRun()
+{
+    std::unique_lock<std::mutex> lock(gfxMutex);
+    for (;;) {
+        gfxThreadIdle = true;
+        gfxWork.wait(lock, [] { return gfxThreadStopping || gfxJobsDone != gfxJobsQueued; });
+        gfxThreadIdle = false;
+        if (gfxJobsDone == gfxJobsQueued)
+            return;
+
+        GfxJob& job = gfxJobs[gfxJobsDone & (kJobCount - 1)];
+        size_t write = gfxWritesApplied;
+        lock.unlock();
+
+        for (; write != job.writesEnd; write++) {
+            const GfxWrite& entry = gfxWriteLog[write & (kWriteLogSize - 1)];
+            memcpy(gfxThreadMemory(entry.memory) + entry.address, &entry.value, entry.size);
+            gfxMemoryWritten((GfxMemory)entry.memory, entry.address, entry.size);
+        }
+
+        if (job.draw) {
+            gfxLine = job.state;
+            gfxLine.vram = gfxThreadVRAM;
+            gfxLine.paletteRAM = gfxThreadPaletteRAM;
+            gfxLine.oam = gfxThreadOAM;
+            gfxDrawLine();
+        }
+
+        lock.lock();
+        gfxWritesApplied = write;
+        gfxJobsDone++;
+        gfxDone.notify_one();
+    }
+}
+
+void gfxThreadStart()
+{
+    memcpy(gfxThreadVRAM, g_vram, SIZE_VRAM);
+    memcpy(gfxThreadPaletteRAM, g_paletteRAM, SIZE_PRAM);
+    memcpy(gfxThreadOAM, g_oam, SIZE_OAM);
+
+    gfxJobsQueued = 0;
+    gfxJobsDone = 0;
+    gfxWritesApplied = 0;
+    gfxWritesLogged = 0;
+    gfxWritesLimit = kWriteLogSize;
+    gfxThreadStopping = false;
+
+    gfxThread = std::thread(gfxThreadRun);
+    gfxThreadEnabled = true;
+}
+
+// Queues a job that only applies the logged writes, and waits for it.
+void gfxThreadFlushWrites()
+{
+    gfxThreadSync();
+    gfxJobs[gfxJobsQueued & (kJobCount - 1)].draw = false;
+    gfxThreadQueueLine();
+    gfxThreadSync();
+    gfxWritesLimit = gfxWritesLogged + kWriteLogSize;
+}
+
+// Stops the render thread when the emulator exits without a CPUCleanUp().
+struct GfxThreadGuard {
+    ~GfxThreadGuard() { gfxThreadStop(); }
+} gfxThreadGuard;
+
+}  // namespace
+
+void gfxThreadUpdate()
+{
+    if (coreOptions.threadedRender != gfxThreadEnabled) {
+        if (gfxThreadEnabled)
+            gfxThreadStop();
+        else
+            gfxThreadStart();
+    }
+}
+
+void gfxThreadStop()
+{
+    if (!gfxThreadEnabled)
+        return;
+
+    gfxThreadFlushWrites();
+    {
+        std::lock_guard<std::mutex> lock(gfxMutex);
+        gfxThreadStopping = true;
+    }
+    gfxWork.notify_one();
+    gfxThread.join();
+    gfxThreadEnabled = false;
+}
+
+void gfxThreadSync()
+{
+    if (!gfxThreadEnabled)
+        return;
+
+    std::unique_lock<std::mutex> lock(gfxMutex);
+    gfxDone.wait(lock, [] { return gfxJobsDone == gfxJobsQueued; });
+}
+
+GfxLineState* gfxThreadNextLine()
+{
+    {
+        std::unique_lock<std::mutex> lock(gfxMutex);
+        gfxDone.wait(lock, [] { return gfxJobsQueued - gfxJobsDone < kJobCount; });
+    }
+    GfxJob& job = gfxJobs[gfxJobsQueued & (kJobCount - 1)];
+    job.draw = true;
+    return &job.state;
+}
+
+void gfxThreadQueueLine()
+{
+    std::lock_guard<std::mutex> lock(gfxMutex);
+    gfxJobs[gfxJobsQueued & (kJobCount - 1)].writesEnd = gfxWritesLogged;
+    gfxJobsQueued++;
+    if (gfxThreadIdle)
+        gfxWork.notify_one();
+}
+
+void gfxThreadMemoryWrite(GfxMemory memory, uint32_t address, int size)
+{
+    if (gfxWritesLogged == gfxWritesLimit)
+        gfxThreadFlushWrites();
+
+    GfxWrite& write = gfxWriteLog[gfxWritesLogged & (kWriteLogSize - 1)];
+    memcpy(&write.value, gfxCoreMemory(memory) + address, size);
+    write.address = address;
+    write.memory = (uint8_t)memory;
+    write.size = (uint8_t)size;
+    gfxWritesLogged++;
+}
+
+void gfxThreadMemoryChanged()
+{
+    if (!gfxThreadEnabled)
+        return;
+
+    gfxThreadSync();
+    memcpy(gfxThreadVRAM, g_vram, SIZE_VRAM);
+    memcpy(gfxThreadPaletteRAM, g_paletteRAM, SIZE_PRAM);
+    memcpy(gfxThreadOAM, g_oam, SIZE_OAM);
+
+    // The copy supersedes the writes logged so far.
+    std::lock_guard<std::mutex> lock(gfxMutex);
+    gfxWritesApplied = gfxWritesLogged;
+    gfxWritesLimit = gfxWritesLogged + kWriteLogSize;
+}
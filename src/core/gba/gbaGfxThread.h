@@ -0,0 +1,33 @@
+#ifndef VBAM_CORE_GBA_GBAGFXTHREAD_H_
+#define VBAM_CORE_GBA_GBAGFXTHREAD_H_
+
+#include "core/gba/gbaGfx.h"
+
+// Draws the GBA lines on a separate thread, when coreOptions.threadedRender
+// is set.
+//
+// The CPU loop captures the renderer inputs of every line into a queue and
+// goes on emulating. The render thread keeps its own copy of VRAM, palette
+// RAM and OAM, which it updates from a log of the CPU writes as it catches
+// up, so every line is drawn from the memory contents it had when the CPU
+// reached it. Lines are only drawn in the background while CPULoop() runs.
+
+extern bool gfxThreadEnabled;
+
+// Starts or stops the render thread to follow coreOptions.threadedRender.
+void gfxThreadUpdate();
+// Waits for all the queued lines to be drawn, then stops the render thread.
+void gfxThreadStop();
+// Waits for all the queued lines to be drawn.
+void gfxThreadSync();
+
+// Returns the state to fill for the next line, then queues it.
+GfxLineState* gfxThreadNextLine();
+void gfxThreadQueueLine();
+
+// Logs a write to the memory read by the renderer, see gfxMemoryWrite().
+void gfxThreadMemoryWrite(GfxMemory memory, uint32_t address, int size);
+// Reloads the render thread copy of the memory, see gfxMemoryChanged().
+void gfxThreadMemoryChanged();
+
+#endif  // VBAM_CORE_GBA_GBAGFXTHREAD_H_
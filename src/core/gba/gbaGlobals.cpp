@@ -7,6 +7,8 @@ char oldbuffer[10];
 
 reg_pair reg[45];
 memoryMap map[256];
+uint8_t* cpuReadPages[CPU_PAGES];
+uint8_t* cpuWritePages[CPU_PAGES];
 bool ioReadable[0x400];
 bool N_FLAG = 0;
 bool C_FLAG = 0;
@@ -9,6 +9,7 @@
 #include "core/gba/gbaCpu.h"
 #include "core/gba/gbaEeprom.h"
 #include "core/gba/gbaFlash.h"
+#include "core/gba/gbaGfx.h"
 #include "core/gba/gbaPrint.h"
 #include "core/gba/gbaRtc.h"
 #include "core/gba/gbaSound.h"
@@ -86,6 +87,10 @@ static inline uint32_t CPUReadMemory(uint32_t address)
         }
     }
 #endif
+    const uint32_t page = address >> CPU_PAGE_SHIFT;
+    if (page < CPU_PAGES && cpuReadPages[page] && !(address & 3))
+        return READ32LE(((uint32_t*)&cpuReadPages[page][address & CPU_PAGE_MASK]));
+
     uint32_t value = 0;
 
     switch (address >> 24) {
@@ -116,9 +121,11 @@ static inline uint32_t CPUReadMemory(uint32_t address)
         if ((address < 0x4000400) && ioReadable[address & 0x3fc]) {
             if (ioReadable[(address & 0x3fc) + 2]) {
                 value = READ32LE(((uint32_t*)&g_ioMem[address & 0x3fC]));
-                if ((address & 0x3fc) == COMM_JOY_RECV_L)
+                if ((address & 0x3fc) == COMM_JOY_RECV_L) {
+                    cpuIdleLoopVolatile = true;
                     UPDATE_REG(COMM_JOYSTAT,
                         READ16LE(&g_ioMem[COMM_JOYSTAT]) & ~JOYSTAT_RECV);
+                }
             } else {
                 value = READ16LE(((uint16_t*)&g_ioMem[address & 0x3fc]));
             }
@@ -150,12 +157,14 @@ static inline uint32_t CPUReadMemory(uint32_t address)
         value = READ32LE(((uint32_t*)&g_rom[address & 0x1FFFFFC]));
         break;
     case 13:
+        cpuIdleLoopVolatile = true;
         if (cpuEEPROMEnabled)
             // no need to swap this
             return eepromRead(address);
         goto unreadable;
     case 14:
     case 15:
+        cpuIdleLoopVolatile = true;
         if (cpuFlashEnabled | cpuSramEnabled) { // no need to swap this
             value = flashRead(address) * 0x01010101;
             break;
@@ -228,6 +237,10 @@ static inline uint32_t CPUReadHalfWord(uint32_t address)
     }
 #endif
 
+    const uint32_t page = address >> CPU_PAGE_SHIFT;
+    if (page < CPU_PAGES && cpuReadPages[page] && !(address & 1))
+        return READ16LE(((uint16_t*)&cpuReadPages[page][address & CPU_PAGE_MASK]));
+
     uint32_t value = 0;
 
     switch (address >> 24) {
@@ -257,6 +270,8 @@ static inline uint32_t CPUReadHalfWord(uint32_t address)
         if ((address < 0x4000400) && ioReadable[address & 0x3fe]) {
             value = READ16LE(((uint16_t*)&g_ioMem[address & 0x3fe]));
             if (((address & 0x3fe) > 0xFF) && ((address & 0x3fe) < 0x10E)) {
+                // The counters are computed from cpuTotalTicks.
+                cpuIdleLoopVolatile = true;
                 if (((address & 0x3fe) == 0x100) && timer0On)
                     value = 0xFFFF - ((timer0Ticks - cpuTotalTicks) >> timer0ClockReload);
                 else if (((address & 0x3fe) == 0x104) && timer1On && !(TM1CNT & 4))
@@ -293,18 +308,21 @@ static inline uint32_t CPUReadHalfWord(uint32_t address)
     case 10:
     case 11:
     case 12:
-        if (address == 0x80000c4 || address == 0x80000c6 || address == 0x80000c8)
+        if (address == 0x80000c4 || address == 0x80000c6 || address == 0x80000c8) {
+            cpuIdleLoopVolatile = true;
             value = rtcRead(address);
-        else
+        } else
             value = READ16LE(((uint16_t*)&g_rom[address & 0x1FFFFFE]));
         break;
     case 13:
+        cpuIdleLoopVolatile = true;
         if (cpuEEPROMEnabled)
             // no need to swap this
             return eepromRead(address);
         goto unreadable;
     case 14:
     case 15:
+        cpuIdleLoopVolatile = true;
         if (cpuFlashEnabled | cpuSramEnabled) {
             // no need to swap this
             value = flashRead(address) * 0x0101;
@@ -375,6 +393,10 @@ static inline uint8_t CPUReadByte(uint32_t address)
     }
 #endif
 
+    const uint32_t page = address >> CPU_PAGE_SHIFT;
+    if (page < CPU_PAGES && cpuReadPages[page])
+        return cpuReadPages[page][address & CPU_PAGE_MASK];
+
     switch (address >> 24) {
     case 0:
         if (reg[15].I >> 24) {
@@ -418,11 +440,13 @@ static inline uint8_t CPUReadByte(uint32_t address)
     case 12:
         return g_rom[address & 0x1FFFFFF];
     case 13:
+        cpuIdleLoopVolatile = true;
         if (cpuEEPROMEnabled)
             return DowncastU8(eepromRead(address));
         goto unreadable;
     case 14:
     case 15:
+        cpuIdleLoopVolatile = true;
         if (cpuSramEnabled | cpuFlashEnabled)
             return flashRead(address);
 
@@ -460,6 +484,8 @@ static inline uint8_t CPUReadByte(uint32_t address)
 
 static inline void CPUWriteMemory(uint32_t address, uint32_t value)
 {
+    cpuIdleLoopVolatile = true;
+
 #ifdef GBA_LOGGING
     if (address & 3) {
         if (systemVerbose & VERBOSE_UNALIGNED_MEMORY) {
@@ -480,6 +506,12 @@ static inline void CPUWriteMemory(uint32_t address, uint32_t value)
     }
 #endif
 
+    const uint32_t page = address >> CPU_PAGE_SHIFT;
+    if (page < CPU_PAGES && cpuWritePages[page]) {
+        WRITE32LE(((uint32_t*)&cpuWritePages[page][address & (CPU_PAGE_MASK & ~3)]), value);
+        return;
+    }
+
     switch (address >> 24) {
     case 0x02:
 #ifdef VBAM_ENABLE_DEBUGGER
@@ -511,6 +543,7 @@ static inline void CPUWriteMemory(uint32_t address, uint32_t value)
         else
 #endif
             WRITE32LE(((uint32_t*)&g_paletteRAM[address & 0x3FC]), value);
+        gfxMemoryWrite(GFX_MEMORY_PALETTE, address & 0x3FC, 4);
         break;
     case 0x06:
         address = (address & 0x1fffc);
@@ -526,6 +559,7 @@ static inline void CPUWriteMemory(uint32_t address, uint32_t value)
 #endif
 
             WRITE32LE(((uint32_t*)&g_vram[address]), value);
+        gfxMemoryWrite(GFX_MEMORY_VRAM, address, 4);
         break;
     case 0x07:
 #ifdef VBAM_ENABLE_DEBUGGER
@@ -534,6 +568,7 @@ static inline void CPUWriteMemory(uint32_t address, uint32_t value)
         else
 #endif
             WRITE32LE(((uint32_t*)&g_oam[address & 0x3fc]), value);
+        gfxMemoryWrite(GFX_MEMORY_OAM, address & 0x3fc, 4);
         break;
     case 0x0D:
         if (cpuEEPROMEnabled) {
@@ -565,6 +600,8 @@ static inline void CPUWriteMemory(uint32_t address, uint32_t value)
 
 static inline void CPUWriteHalfWord(uint32_t address, uint16_t value)
 {
+    cpuIdleLoopVolatile = true;
+
 #ifdef GBA_LOGGING
     if (address & 1) {
         if (systemVerbose & VERBOSE_UNALIGNED_MEMORY) {
@@ -585,6 +622,12 @@ static inline void CPUWriteHalfWord(uint32_t address, uint16_t value)
     }
 #endif
 
+    const uint32_t page = address >> CPU_PAGE_SHIFT;
+    if (page < CPU_PAGES && cpuWritePages[page]) {
+        WRITE16LE(((uint16_t*)&cpuWritePages[page][address & (CPU_PAGE_MASK & ~1)]), value);
+        return;
+    }
+
     switch (address >> 24) {
     case 2:
 #ifdef VBAM_ENABLE_DEBUGGER
@@ -615,6 +658,7 @@ static inline void CPUWriteHalfWord(uint32_t address, uint16_t value)
         else
 #endif
             WRITE16LE(((uint16_t*)&g_paletteRAM[address & 0x3fe]), value);
+        gfxMemoryWrite(GFX_MEMORY_PALETTE, address & 0x3fe, 2);
         break;
     case 6:
         address = (address & 0x1fffe);
@@ -628,6 +672,7 @@ static inline void CPUWriteHalfWord(uint32_t address, uint16_t value)
         else
 #endif
             WRITE16LE(((uint16_t*)&g_vram[address]), value);
+        gfxMemoryWrite(GFX_MEMORY_VRAM, address, 2);
         break;
     case 7:
 #ifdef VBAM_ENABLE_DEBUGGER
@@ -636,6 +681,7 @@ static inline void CPUWriteHalfWord(uint32_t address, uint16_t value)
         else
 #endif
             WRITE16LE(((uint16_t*)&g_oam[address & 0x3fe]), value);
+        gfxMemoryWrite(GFX_MEMORY_OAM, address & 0x3fe, 2);
         break;
     case 8:
     case 9:
@@ -674,6 +720,8 @@ static inline void CPUWriteHalfWord(uint32_t address, uint16_t value)
 
 static inline void CPUWriteByte(uint32_t address, uint8_t b)
 {
+    cpuIdleLoopVolatile = true;
+
 #ifdef VBAM_ENABLE_DEBUGGER
     memoryMap* m = &map[address >> 24];
     if (m->breakPoints && BreakWriteCheck(m->breakPoints, address & m->mask)) {
@@ -683,6 +731,12 @@ static inline void CPUWriteByte(uint32_t address, uint8_t b)
     }
 #endif
 
+    const uint32_t page = address >> CPU_PAGE_SHIFT;
+    if (page < CPU_PAGES && cpuWritePages[page]) {
+        cpuWritePages[page][address & CPU_PAGE_MASK] = b;
+        return;
+    }
+
     switch (address >> 24) {
     case 2:
 #ifdef VBAM_ENABLE_DEBUGGER
@@ -769,6 +823,7 @@ static inline void CPUWriteByte(uint32_t address, uint8_t b)
     case 5:
         // no need to switch
         *((uint16_t*)&g_paletteRAM[address & 0x3FE]) = (b << 8) | b;
+        gfxMemoryWrite(GFX_MEMORY_PALETTE, address & 0x3FE, 2);
         break;
     case 6:
         address = (address & 0x1fffe);
@@ -786,6 +841,7 @@ static inline void CPUWriteByte(uint32_t address, uint8_t b)
             else
 #endif
                 *((uint16_t*)&g_vram[address]) = (b << 8) | b;
+            gfxMemoryWrite(GFX_MEMORY_VRAM, address, 2);
         }
         break;
     case 7:
@@ -37,6 +37,10 @@
 #include "core/gba/gbaCpu.h"
 #include "core/gba/internal/gbaSockClient.h"
 
+#if defined(VBAM_ENABLE_NETPLAY)
+#include "core/gba/internal/gbaNetplay.h"
+#endif  // defined(VBAM_ENABLE_NETPLAY)
+
 #ifdef _MSC_VER
 #define snprintf _snprintf
 #endif
@@ -207,6 +211,14 @@ static ConnectionState ConnectUpdateSocket(char* const message, size_t size);
 static void UpdateCableSocket(int ticks);
 static void CloseSocket();
 
+#if defined(VBAM_ENABLE_NETPLAY)
+static ConnectionState InitNetplay();
+static ConnectionState ConnectUpdateNetplay(char* const message, size_t size);
+static void StartCableNetplay(uint16_t siocnt);
+static void EmulateFrameNetplay(const EmulatedSystem& system);
+static void CloseNetplay();
+#endif  // defined(VBAM_ENABLE_NETPLAY)
+
 const uint64_t TICKS_PER_FRAME = TICKS_PER_SECOND / 60;
 const uint64_t BITS_PER_SECOND = 115200;
 const uint64_t BYTES_PER_SECOND = BITS_PER_SECOND / 8;
@@ -352,6 +364,7 @@ struct LinkDriver {
     typedef void(StartFunc)(uint16_t siocnt);
     typedef void(UpdateFunc)(int ticks);
     typedef void(CloseFunc)();
+    typedef void(FrameFunc)(const EmulatedSystem& system);
 
     LinkMode mode;
     ConnectFunc* connect;
@@ -360,6 +373,8 @@ struct LinkDriver {
     UpdateFunc* update;
     CloseFunc* close;
     bool uses_socket;
+    // Emulates a frame in place of the frontend, if set.
+    FrameFunc* frame;
 };
 
 static const LinkDriver* linkDriver = NULL;
@@ -372,14 +387,17 @@ static sf::IpAddress joybusHostAddr = sf::IpAddress::LocalHost;
 
 static const LinkDriver linkDrivers[] = {
 #if (defined __WIN32__ || defined _WIN32)
-    { LINK_CABLE_IPC, InitIPC, NULL, StartCableIPC, UpdateCableIPC, CloseIPC, false },
-    { LINK_RFU_IPC, InitIPC, NULL, StartRFU, UpdateRFUIPC, CloseIPC, false },
-    { LINK_GAMEBOY_IPC, InitIPC, NULL, NULL, NULL, CloseIPC, false },
+    { LINK_CABLE_IPC, InitIPC, NULL, StartCableIPC, UpdateCableIPC, CloseIPC, false, NULL },
+    { LINK_RFU_IPC, InitIPC, NULL, StartRFU, UpdateRFUIPC, CloseIPC, false, NULL },
+    { LINK_GAMEBOY_IPC, InitIPC, NULL, NULL, NULL, CloseIPC, false, NULL },
 #endif
-    { LINK_CABLE_SOCKET, InitSocket, ConnectUpdateSocket, StartCableSocket, UpdateCableSocket, CloseSocket, true },
-    { LINK_RFU_SOCKET, InitSocket, ConnectUpdateRFUSocket, StartRFUSocket, UpdateRFUSocket, CloseSocket, true },
-    { LINK_GAMECUBE_DOLPHIN, JoyBusConnect, NULL, NULL, JoyBusUpdate, JoyBusShutdown, false },
-    { LINK_GAMEBOY_SOCKET, InitSocket, ConnectUpdateSocket, NULL, NULL, CloseSocket, true },
+    { LINK_CABLE_SOCKET, InitSocket, ConnectUpdateSocket, StartCableSocket, UpdateCableSocket, CloseSocket, true, NULL },
+    { LINK_RFU_SOCKET, InitSocket, ConnectUpdateRFUSocket, StartRFUSocket, UpdateRFUSocket, CloseSocket, true, NULL },
+    { LINK_GAMECUBE_DOLPHIN, JoyBusConnect, NULL, NULL, JoyBusUpdate, JoyBusShutdown, false, NULL },
+    { LINK_GAMEBOY_SOCKET, InitSocket, ConnectUpdateSocket, NULL, NULL, CloseSocket, true, NULL },
+#if defined(VBAM_ENABLE_NETPLAY)
+    { LINK_CABLE_NETPLAY, InitNetplay, ConnectUpdateNetplay, StartCableNetplay, NULL, CloseNetplay, true, EmulateFrameNetplay },
+#endif  // defined(VBAM_ENABLE_NETPLAY)
 };
 
 enum {
@@ -742,6 +760,15 @@ void LinkUpdate(int ticks)
     linkDriver->update(ticks);
 }
 
+bool LinkEmulateFrame(const EmulatedSystem& system)
+{
+    if (GetLinkMode() == LINK_DISCONNECTED || !linkDriver->frame)
+        return false;
+
+    linkDriver->frame(system);
+    return true;
+}
+
 void CheckLinkConnection()
 {
     if (GetLinkMode() == LINK_CABLE_SOCKET) {
@@ -1272,6 +1299,263 @@ static void CloseSocket()
     lanlink.tcpsocket.disconnect();
 }
 
+#if defined(VBAM_ENABLE_NETPLAY)
+
+// The netplay packets over UDP. The slave sends hellos to the master until it
+// gets a welcome, the master then knows its address.
+class NetplayUdpTransport : public NetplayTransport {
+public:
+    ConnectionState Open(bool master, const sf::IpAddress& server, unsigned short port,
+                         const sf::IpAddress& bind_address);
+    ConnectionState ConnectUpdate(char* const message, size_t size);
+    void Close();
+
+    void Send(const std::vector<uint8_t>& packet) override;
+    bool Receive(std::vector<uint8_t>& packet, int wait_ms) override;
+
+private:
+    static const sf::Uint32 kMagic = 0x56424e50; // "VBNP"
+    // How long every connection update waits for the other player.
+    static const int kConnectWaitMs = 150;
+
+    enum PacketType : sf::Uint8 {
+        kHello,
+        kWelcome,
+        kEvents,
+    };
+
+    void SendType(PacketType type);
+
+    bool master_ = false;
+    bool connected_ = false;
+    sf::UdpSocket socket_;
+    sf::IpAddress remote_address_;
+    unsigned short remote_port_ = 0;
+};
+
+ConnectionState NetplayUdpTransport::Open(bool master, const sf::IpAddress& server,
+                                          unsigned short port, const sf::IpAddress& bind_address)
+{
+    Close();
+
+    master_ = master;
+    socket_.setBlocking(false);
+
+    if (master_) {
+        if (socket_.bind(port, bind_address) != sf::Socket::Done)
+            return LINK_ERROR;
+    } else {
+        if (server == sf::IpAddress::None || socket_.bind(sf::Socket::AnyPort) != sf::Socket::Done)
+            return LINK_ERROR;
+
+        remote_address_ = server;
+        remote_port_ = port;
+    }
+
+    return LINK_NEEDS_UPDATE;
+}
+
+ConnectionState NetplayUdpTransport::ConnectUpdate(char* const message, size_t size)
+{
+    if (!master_)
+        SendType(kHello);
+
+    // The events received before the connection are sent again.
+    std::vector<uint8_t> packet;
+    int wait_ms = kConnectWaitMs;
+    while (Receive(packet, wait_ms))
+        wait_ms = 0;
+
+    if (!connected_) {
+        snprintf(message, size, master_ ? N_("Waiting for player 2") : N_("Waiting for the server"));
+        return LINK_NEEDS_UPDATE;
+    }
+
+    snprintf(message, size, master_ ? N_("Player 2 connected") : N_("Connected as #2"));
+    return LINK_OK;
+}
+
+void NetplayUdpTransport::Close()
+{
+    socket_.unbind();
+
+    connected_ = false;
+    remote_address_ = sf::IpAddress::None;
+    remote_port_ = 0;
+}
+
+void NetplayUdpTransport::Send(const std::vector<uint8_t>& packet)
+{
+    sf::Packet out;
+    out << kMagic << static_cast<sf::Uint8>(kEvents);
+    out.append(packet.data(), packet.size());
+    socket_.send(out, remote_address_, remote_port_);
+}
+
+void NetplayUdpTransport::SendType(PacketType type)
+{
+    sf::Packet out;
+    out << kMagic << static_cast<sf::Uint8>(type);
+    socket_.send(out, remote_address_, remote_port_);
+}
+
+bool NetplayUdpTransport::Receive(std::vector<uint8_t>& packet, int wait_ms)
+{
+    if (wait_ms > 0) {
+        sf::SocketSelector selector;
+        selector.add(socket_);
+        selector.wait(sf::milliseconds(wait_ms));
+    }
+
+    for (;;) {
+        sf::Packet in;
+        sf::IpAddress address;
+        unsigned short port;
+        if (socket_.receive(in, address, port) != sf::Socket::Done)
+            return false;
+
+        sf::Uint32 magic;
+        sf::Uint8 type;
+        if (!(in >> magic >> type) || magic != kMagic)
+            continue;
+
+        const bool from_remote = address == remote_address_ && port == remote_port_;
+
+        switch (type) {
+        case kHello:
+            // Also sent again when the welcome was lost.
+            if (!master_ || (connected_ && !from_remote))
+                break;
+
+            remote_address_ = address;
+            remote_port_ = port;
+            connected_ = true;
+            SendType(kWelcome);
+            break;
+
+        case kWelcome:
+            if (!master_ && from_remote)
+                connected_ = true;
+            break;
+
+        case kEvents:
+            if (connected_ && from_remote) {
+                // The magic and the type come first.
+                const uint8_t* data = static_cast<const uint8_t*>(in.getData());
+                packet.assign(data + 5, data + in.getDataSize());
+                return true;
+            }
+            break;
+        }
+    }
+}
+
+static void ApplyNetplayTransfer(const NetplayFrame& master, const NetplayFrame& slave);
+static NetplayFrame CaptureNetplayFrame();
+
+static NetplayUdpTransport netplay_transport;
+static NetplaySession netplay({ ApplyNetplayTransfer, CaptureNetplayFrame });
+// Transfer started by the master during the current frame
+static bool netplay_start = false;
+static uint16_t netplay_start_data = 0xffff;
+
+static ConnectionState InitNetplay()
+{
+    if (lanlink.server && lanlink.numslaves != 1) {
+        systemMessage(0, N_("Netplay only supports 2 players"));
+        return LINK_ERROR;
+    }
+
+    linkid = lanlink.server ? 0 : 1;
+    netplay_start = false;
+
+    sf::IpAddress bind_ip = IP_LINK_BIND_ADDRESS == "*" ? sf::IpAddress::Any : IP_LINK_BIND_ADDRESS;
+
+    return netplay_transport.Open(lanlink.server, lc.serveraddr, IP_LINK_PORT, bind_ip);
+}
+
+static ConnectionState ConnectUpdateNetplay(char* const message, size_t size)
+{
+    const ConnectionState state = netplay_transport.ConnectUpdate(message, size);
+    if (state == LINK_OK)
+        netplay.Start(lanlink.server, &netplay_transport);
+    return state;
+}
+
+static void StartCableNetplay(uint16_t value)
+{
+    if (GetSIOMode(value, READ16LE(&g_ioMem[COMM_RCNT])) != MULTIPLAYER) {
+        UPDATE_REG(COMM_SIOCNT, value);
+        return;
+    }
+
+    // The transfer is in progress until the start of the next frame
+    bool busy = (READ16LE(&g_ioMem[COMM_SIOCNT]) & 0x80) != 0;
+    bool start = (value & 0x80) && !linkid && !busy;
+    // clear start, seqno, si (RO on slave, start = pulse on master)
+    value &= 0xff4b;
+    if (start) {
+        netplay_start = true;
+        netplay_start_data = READ16LE(&g_ioMem[COMM_SIODATA8]);
+        busy = true;
+        value &= ~0x40;
+    }
+    value |= (busy ? 1 : 0) << 7;
+    value |= (linkid && !busy) ? 0x0c : 0x08; // set SD (high), SI (low on master)
+    value |= linkid << 4; // set seq
+    UPDATE_REG(COMM_SIOCNT, value);
+}
+
+static void ApplyNetplayTransfer(const NetplayFrame& master, const NetplayFrame& slave)
+{
+    const NetplayFrame& self = linkid ? slave : master;
+    if (!(master.flags & NetplayFrame::kStart) || !(self.flags & NetplayFrame::kMultiplayer))
+        return;
+
+    UPDATE_REG(COMM_SIOMULTI0, master.data);
+    UPDATE_REG(COMM_SIOMULTI1, (slave.flags & NetplayFrame::kMultiplayer) ? slave.data : 0xffff);
+    UPDATE_REG(COMM_SIOMULTI2, 0xffff);
+    UPDATE_REG(COMM_SIOMULTI3, 0xffff);
+
+    uint16_t siocnt = READ16LE(&g_ioMem[COMM_SIOCNT]);
+    if (siocnt & 0x4000) {
+        IF |= 0x80;
+        UPDATE_REG(0x202, IF);
+    }
+    UPDATE_REG(COMM_SIOCNT, (siocnt & 0xff0f) | (linkid << 4));
+}
+
+static NetplayFrame CaptureNetplayFrame()
+{
+    NetplayFrame frame;
+    if (netplay_start) {
+        frame.data = netplay_start_data;
+        frame.flags |= NetplayFrame::kStart;
+    } else {
+        frame.data = READ16LE(&g_ioMem[COMM_SIODATA8]);
+    }
+    if (GetSIOMode(READ16LE(&g_ioMem[COMM_SIOCNT]), READ16LE(&g_ioMem[COMM_RCNT])) == MULTIPLAYER)
+        frame.flags |= NetplayFrame::kMultiplayer;
+
+    netplay_start = false;
+    return frame;
+}
+
+static void EmulateFrameNetplay(const EmulatedSystem& system)
+{
+    if (!netplay.EmulateFrame(system, linktimeout))
+        CloseLink();
+}
+
+static void CloseNetplay()
+{
+    netplay.Stop();
+    netplay_transport.Close();
+    linkid = 0;
+}
+
+#endif  // defined(VBAM_ENABLE_NETPLAY)
+
 // call this to clean up crashed program's shared state
 // or to use TCP on same machine (for testing)
 // this may be necessary under MSW as well, but I wouldn't know how
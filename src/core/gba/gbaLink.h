@@ -8,6 +8,8 @@
 #error "This file should not be included with NO_LINK."
 #endif  // defined(NO_LINK)
 
+struct EmulatedSystem;
+
 extern uint16_t IP_LINK_PORT;
 
 extern std::string IP_LINK_BIND_ADDRESS;
@@ -23,7 +25,8 @@ enum LinkMode {
     LINK_RFU_SOCKET,
     LINK_GAMECUBE_DOLPHIN,
     LINK_GAMEBOY_IPC,
-    LINK_GAMEBOY_SOCKET
+    LINK_GAMEBOY_SOCKET,
+    LINK_CABLE_NETPLAY
 };
 
 /**
@@ -133,6 +136,14 @@ extern void StartGPLink(uint16_t rcnt);
  */
 extern void LinkUpdate(int);
 
+/**
+ * Emulate a frame, for the link modes that drive the emulation themselves
+ *
+ * @param system The emulated system
+ * @return false if the frame should be emulated as usual
+ */
+extern bool LinkEmulateFrame(const EmulatedSystem& system);
+
 /**
  * Clean up IPC shared memory
  */
@@ -0,0 +1,300 @@
+#include "core/gba/gbaGfx.h"
+
+#include "core/gba/gbaGlobals.h"
+
+// Line renderers for all the video modes.
+//
+// Every renderer draws the backgrounds used by its mode into g_line0..3, the
+// sprites into g_lineOBJ, and then composites the layers into g_lineMix. The
+// compositing step comes in 3 flavors, selected by CPUUpdateRender():
+// - Normal: no windows and no special effects, except for semi-transparent
+//   sprites which are always blended.
+// - NoWindow: special effects enabled, no windows.
+// - All: windows and special effects enabled.
+
+namespace {
+
+enum GfxCompose {
+    GFX_COMPOSE_NORMAL,
+    GFX_COMPOSE_NO_WINDOW,
+    GFX_COMPOSE_ALL,
+};
+
+// Backgrounds used by each mode, as a mask of BG0-BG3.
+constexpr int kModeLayers[6] = { 0x0F, 0x07, 0x0C, 0x04, 0x04, 0x04 };
+
+uint32_t* const kLines[4] = { g_line0, g_line1, g_line2, g_line3 };
+
+// Affine reference point registers written since the last affine line.
+int gfxBG2Changed = 0;
+int gfxBG3Changed = 0;
+
+// Lower priority values are drawn on top.
+inline bool gfxIsAbove(uint32_t pixel, uint32_t other)
+{
+    return (uint8_t)(pixel >> 24) < (uint8_t)(other >> 24);
+}
+
+inline bool gfxInWindow(uint16_t winV)
+{
+    uint8_t v0 = winV >> 8;
+    uint8_t v1 = winV & 255;
+    bool inWindow = ((v0 == v1) && (v0 >= 0xe8));
+    if (v1 >= v0)
+        inWindow |= (gfxLine.VCOUNT >= v0 && gfxLine.VCOUNT < v1);
+    else
+        inWindow |= (gfxLine.VCOUNT >= v0 || gfxLine.VCOUNT < v1);
+    return inWindow;
+}
+
+template <int kMode>
+inline void gfxDrawLayers()
+{
+    if (kMode == 0) {
+        if (gfxLine.layerEnable & 0x0100) {
+            gfxDrawTextScreen(gfxLine.BG0CNT, gfxLine.BG0HOFS, gfxLine.BG0VOFS, g_line0);
+        }
+
+        if (gfxLine.layerEnable & 0x0200) {
+            gfxDrawTextScreen(gfxLine.BG1CNT, gfxLine.BG1HOFS, gfxLine.BG1VOFS, g_line1);
+        }
+
+        if (gfxLine.layerEnable & 0x0400) {
+            gfxDrawTextScreen(gfxLine.BG2CNT, gfxLine.BG2HOFS, gfxLine.BG2VOFS, g_line2);
+        }
+
+        if (gfxLine.layerEnable & 0x0800) {
+            gfxDrawTextScreen(gfxLine.BG3CNT, gfxLine.BG3HOFS, gfxLine.BG3VOFS, g_line3);
+        }
+        return;
+    }
+
+    if (kMode == 1) {
+        if (gfxLine.layerEnable & 0x0100) {
+            gfxDrawTextScreen(gfxLine.BG0CNT, gfxLine.BG0HOFS, gfxLine.BG0VOFS, g_line0);
+        }
+
+        if (gfxLine.layerEnable & 0x0200) {
+            gfxDrawTextScreen(gfxLine.BG1CNT, gfxLine.BG1HOFS, gfxLine.BG1VOFS, g_line1);
+        }
+    }
+
+    if (gfxLine.layerEnable & 0x0400) {
+        int changed = gfxBG2Changed;
+        if (gfxLastVCOUNT > gfxLine.VCOUNT)
+            changed = 3;
+
+        switch (kMode) {
+        case 1:
+        case 2:
+            gfxDrawRotScreen(gfxLine.BG2CNT, gfxLine.BG2X_L, gfxLine.BG2X_H, gfxLine.BG2Y_L, gfxLine.BG2Y_H,
+                gfxLine.BG2PA, gfxLine.BG2PB, gfxLine.BG2PC, gfxLine.BG2PD,
+                gfxBG2X, gfxBG2Y, changed, g_line2);
+            break;
+        case 3:
+            gfxDrawRotScreen16Bit(gfxLine.BG2CNT, gfxLine.BG2X_L, gfxLine.BG2X_H, gfxLine.BG2Y_L, gfxLine.BG2Y_H,
+                gfxLine.BG2PA, gfxLine.BG2PB, gfxLine.BG2PC, gfxLine.BG2PD,
+                gfxBG2X, gfxBG2Y, changed, g_line2);
+            break;
+        case 4:
+            gfxDrawRotScreen256(gfxLine.BG2CNT, gfxLine.BG2X_L, gfxLine.BG2X_H, gfxLine.BG2Y_L, gfxLine.BG2Y_H,
+                gfxLine.BG2PA, gfxLine.BG2PB, gfxLine.BG2PC, gfxLine.BG2PD,
+                gfxBG2X, gfxBG2Y, changed, g_line2);
+            break;
+        case 5:
+            gfxDrawRotScreen16Bit160(gfxLine.BG2CNT, gfxLine.BG2X_L, gfxLine.BG2X_H, gfxLine.BG2Y_L, gfxLine.BG2Y_H,
+                gfxLine.BG2PA, gfxLine.BG2PB, gfxLine.BG2PC, gfxLine.BG2PD,
+                gfxBG2X, gfxBG2Y, changed, g_line2);
+            break;
+        }
+    }
+
+    if (kMode == 2 && (gfxLine.layerEnable & 0x0800)) {
+        int changed = gfxBG3Changed;
+        if (gfxLastVCOUNT > gfxLine.VCOUNT)
+            changed = 3;
+
+        gfxDrawRotScreen(gfxLine.BG3CNT, gfxLine.BG3X_L, gfxLine.BG3X_H, gfxLine.BG3Y_L, gfxLine.BG3Y_H,
+            gfxLine.BG3PA, gfxLine.BG3PB, gfxLine.BG3PC, gfxLine.BG3PD,
+            gfxBG3X, gfxBG3Y, changed, g_line3);
+    }
+}
+
+// Applies brightness effects to the top pixel, if enabled for its layer.
+inline uint32_t gfxBrightness(uint32_t color, uint8_t top)
+{
+    switch ((gfxLine.BLDMOD >> 6) & 3) {
+    case 2:
+        if (gfxLine.BLDMOD & top)
+            color = gfxIncreaseBrightness(color, g_coeff[gfxLine.COLY & 0x1F]);
+        break;
+    case 3:
+        if (gfxLine.BLDMOD & top)
+            color = gfxDecreaseBrightness(color, g_coeff[gfxLine.COLY & 0x1F]);
+        break;
+    }
+    return color;
+}
+
+template <int kLayers, GfxCompose kCompose>
+inline void gfxComposeLine(uint32_t backdrop, bool inWindow0, bool inWindow1)
+{
+    const uint8_t inWin0Mask = gfxLine.WININ & 0xFF;
+    const uint8_t inWin1Mask = gfxLine.WININ >> 8;
+    const uint8_t outMask = gfxLine.WINOUT & 0xFF;
+    const uint8_t objWinMask = gfxLine.WINOUT >> 8;
+    const int effect = (gfxLine.BLDMOD >> 6) & 3;
+    const uint8_t blendTargets = gfxLine.BLDMOD >> 8;
+    const int ca = g_coeff[gfxLine.COLEV & 0x1F];
+    const int cb = g_coeff[(gfxLine.COLEV >> 8) & 0x1F];
+
+    for (int x = 0; x < 240; x++) {
+        uint8_t mask = 0x3F;
+        if (kCompose == GFX_COMPOSE_ALL) {
+            mask = outMask;
+            if (!(g_lineOBJWin[x] & 0x80000000))
+                mask = objWinMask;
+            if (inWindow1 && gfxInWin1[x])
+                mask = inWin1Mask;
+            if (inWindow0 && gfxInWin0[x])
+                mask = inWin0Mask;
+        }
+
+        // Find the top pixel.
+        uint32_t color = backdrop;
+        uint8_t top = 0x20;
+        for (int i = 0; i < 4; i++) {
+            if ((kLayers & (1 << i)) && (mask & (1 << i)) && gfxIsAbove(kLines[i][x], color)) {
+                color = kLines[i][x];
+                top = 1 << i;
+            }
+        }
+        if ((mask & 0x10) && gfxIsAbove(g_lineOBJ[x], color)) {
+            color = g_lineOBJ[x];
+            top = 0x10;
+        }
+
+        if (kCompose == GFX_COMPOSE_NORMAL && !(top & 0x10)) {
+            g_lineMix[x] = color;
+            continue;
+        }
+
+        if (color & 0x00010000) {
+            // semi-transparent OBJ, blended with the top background
+            uint32_t back = backdrop;
+            uint8_t top2 = 0x20;
+            for (int i = 0; i < 4; i++) {
+                if ((kLayers & (1 << i)) && (mask & (1 << i)) && gfxIsAbove(kLines[i][x], back)) {
+                    back = kLines[i][x];
+                    top2 = 1 << i;
+                }
+            }
+
+            if (top2 & blendTargets)
+                color = gfxAlphaBlend(color, back, ca, cb);
+            else
+                color = gfxBrightness(color, top);
+        } else if (kCompose != GFX_COMPOSE_NORMAL && (mask & 0x20)) {
+            // special FX on in the window
+            if (effect == 1) {
+                if (top & gfxLine.BLDMOD) {
+                    uint32_t back = backdrop;
+                    uint8_t top2 = 0x20;
+                    for (int i = 0; i < 4; i++) {
+                        if ((kLayers & (1 << i)) && (mask & (1 << i)) && top != (1 << i) &&
+                            gfxIsAbove(kLines[i][x], back)) {
+                            back = kLines[i][x];
+                            top2 = 1 << i;
+                        }
+                    }
+                    if ((mask & 0x10) && top != 0x10 && gfxIsAbove(g_lineOBJ[x], back)) {
+                        back = g_lineOBJ[x];
+                        top2 = 0x10;
+                    }
+
+                    if (top2 & blendTargets)
+                        color = gfxAlphaBlend(color, back, ca, cb);
+                }
+            } else {
+                color = gfxBrightness(color, top);
+            }
+        }
+
+        g_lineMix[x] = color;
+    }
+}
+
+template <int kMode, GfxCompose kCompose>
+void gfxRenderLine()
+{
+    uint16_t* palette = (uint16_t*)gfxLine.paletteRAM;
+
+    gfxBG2Changed |= gfxLine.BG2Changed;
+    gfxBG3Changed |= gfxLine.BG3Changed;
+
+    if (gfxLine.DISPCNT & 0x80) {
+        for (int x = 0; x < 240; x++) {
+            g_lineMix[x] = 0x7fff;
+        }
+        if (kMode != 0)
+            gfxLastVCOUNT = gfxLine.VCOUNT;
+        return;
+    }
+
+    bool inWindow0 = false;
+    bool inWindow1 = false;
+    if (kCompose == GFX_COMPOSE_ALL) {
+        if (gfxLine.layerEnable & 0x2000)
+            inWindow0 = gfxInWindow(gfxLine.WIN0V);
+        if (gfxLine.layerEnable & 0x4000)
+            inWindow1 = gfxInWindow(gfxLine.WIN1V);
+    }
+
+    gfxDrawLayers<kMode>();
+
+    gfxDrawSprites(g_lineOBJ);
+    if (kCompose == GFX_COMPOSE_ALL)
+        gfxDrawOBJWin(g_lineOBJWin);
+
+    uint32_t backdrop;
+    if (gfxLine.customBackdropColor == -1) {
+        backdrop = (READ16LE(&palette[0]) | 0x30000000);
+    } else {
+        backdrop = ((gfxLine.customBackdropColor & 0x7FFF) | 0x30000000);
+    }
+
+    gfxComposeLine<kModeLayers[kMode], kCompose>(backdrop, inWindow0, inWindow1);
+
+    if (kMode != 0) {
+        gfxBG2Changed = 0;
+        if (kMode == 2)
+            gfxBG3Changed = 0;
+        gfxLastVCOUNT = gfxLine.VCOUNT;
+    }
+}
+
+}  // namespace
+
+void mode0RenderLine() { gfxRenderLine<0, GFX_COMPOSE_NORMAL>(); }
+void mode0RenderLineNoWindow() { gfxRenderLine<0, GFX_COMPOSE_NO_WINDOW>(); }
+void mode0RenderLineAll() { gfxRenderLine<0, GFX_COMPOSE_ALL>(); }
+
+void mode1RenderLine() { gfxRenderLine<1, GFX_COMPOSE_NORMAL>(); }
+void mode1RenderLineNoWindow() { gfxRenderLine<1, GFX_COMPOSE_NO_WINDOW>(); }
+void mode1RenderLineAll() { gfxRenderLine<1, GFX_COMPOSE_ALL>(); }
+
+void mode2RenderLine() { gfxRenderLine<2, GFX_COMPOSE_NORMAL>(); }
+void mode2RenderLineNoWindow() { gfxRenderLine<2, GFX_COMPOSE_NO_WINDOW>(); }
+void mode2RenderLineAll() { gfxRenderLine<2, GFX_COMPOSE_ALL>(); }
+
+void mode3RenderLine() { gfxRenderLine<3, GFX_COMPOSE_NORMAL>(); }
+void mode3RenderLineNoWindow() { gfxRenderLine<3, GFX_COMPOSE_NO_WINDOW>(); }
+void mode3RenderLineAll() { gfxRenderLine<3, GFX_COMPOSE_ALL>(); }
+
+void mode4RenderLine() { gfxRenderLine<4, GFX_COMPOSE_NORMAL>(); }
+void mode4RenderLineNoWindow() { gfxRenderLine<4, GFX_COMPOSE_NO_WINDOW>(); }
+void mode4RenderLineAll() { gfxRenderLine<4, GFX_COMPOSE_ALL>(); }
+
+void mode5RenderLine() { gfxRenderLine<5, GFX_COMPOSE_NORMAL>(); }
+void mode5RenderLineNoWindow() { gfxRenderLine<5, GFX_COMPOSE_NO_WINDOW>(); }
+void mode5RenderLineAll() { gfxRenderLine<5, GFX_COMPOSE_ALL>(); }
@@ -44,6 +44,7 @@
 
 #include "core/gba/gba.h"
 #include "core/gba/gbaElf.h"
+#include "core/gba/gbaGfx.h"
 #include "core/gba/gbaGlobals.h"
 #include "core/gba/gbaRemote.h"
 #include "core/gba/internal/gbaBreakpoint.h"
@@ -80,14 +81,16 @@ void remoteSetSockets(SOCKET l, SOCKET r)
 #define debuggerReadByte(addr) \
     map[(addr) >> 24].address[(addr)&map[(addr) >> 24].mask]
 
+// Writes bypass the CPU write functions, so the decoded tile cache has to be
+// flushed on each of them.
 #define debuggerWriteMemory(addr, value) \
-    *(uint32_t*)&map[(addr) >> 24].address[(addr)&map[(addr) >> 24].mask] = (value)
+    (*(uint32_t*)&map[(addr) >> 24].address[(addr)&map[(addr) >> 24].mask] = (value), gfxMemoryChanged())
 
 #define debuggerWriteHalfWord(addr, value) \
-    *(uint16_t*)&map[(addr) >> 24].address[(addr)&map[(addr) >> 24].mask] = (value)
+    (*(uint16_t*)&map[(addr) >> 24].address[(addr)&map[(addr) >> 24].mask] = (value), gfxMemoryChanged())
 
 #define debuggerWriteByte(addr, value) \
-    map[(addr) >> 24].address[(addr)&map[(addr) >> 24].mask] = (value)
+    (map[(addr) >> 24].address[(addr)&map[(addr) >> 24].mask] = (value), gfxMemoryChanged())
 
 bool dontBreakNow = false;
 int debuggerNumOfDontBreak = 0;
@@ -3972,6 +3975,7 @@ void remoteWriteWatch(char* p, bool active)
             freezeInternalRAM[address & 0x7fff] = active;
         address++;
     }
+    CPUUpdateMemoryPages();
 #endif
 
     remotePutPacket("OK");
@@ -307,7 +307,11 @@ void rtcReset()
     SetGBATime();
 }
 
-#ifdef __LIBRETRO__
+unsigned rtcStateSize()
+{
+    return sizeof(rtcClockData);
+}
+
 void rtcSaveGame(uint8_t*& data)
 {
     utilWriteMem(data, &rtcClockData, sizeof(rtcClockData));
@@ -317,7 +321,8 @@ void rtcReadGame(const uint8_t*& data)
 {
     utilReadMem(&rtcClockData, data, sizeof(rtcClockData));
 }
-#else
+
+#ifndef __LIBRETRO__
 void rtcSaveGame(gzFile gzFile)
 {
     utilGzWrite(gzFile, &rtcClockData, sizeof(rtcClockData));
@@ -15,12 +15,12 @@ void rtcEnableRumble(bool e);
 bool rtcIsEnabled();
 void rtcReset();
 
-#if defined(__LIBRETRO__)
+unsigned rtcStateSize();
 void rtcReadGame(const uint8_t*& data);
 void rtcSaveGame(uint8_t*& data);
-#else  // !defined(__LIBRETRO__)
+#if !defined(__LIBRETRO__)
 void rtcReadGame(gzFile gzFile);
 void rtcSaveGame(gzFile gzFile);
-#endif  // defined(__LIBRETRO__)
+#endif  // !defined(__LIBRETRO__)
 
 #endif // VBAM_CORE_GBA_GBARTC_H_
@@ -1,7 +1,10 @@
 #include "core/gba/gbaSound.h"
 
+#include <algorithm>
 #include <array>
+#include <cmath>
 #include <cstring>
+#include <vector>
 
 #include "core/apu/Gb_Apu.h"
 #include "core/apu/Multi_Buffer.h"
@@ -40,7 +43,12 @@ extern bool stopState; // TODO: silence sound when true
 
 int const SOUND_CLOCK_TICKS_ = 280896; // ~1074 samples per frame
 
+#ifdef __LIBRETRO__
 static uint16_t soundFinalWave[1600];
+#else
+// Grows to the largest number of samples flushed at once.
+static std::vector<uint16_t> soundFinalWave;
+#endif
 long soundSampleRate = 44100;
 bool g_gbaSoundInterpolation = true;
 bool soundPaused = true;
@@ -52,6 +60,8 @@ static float soundVolume = 1.0f;
 static int soundEnableFlag = 0x3ff; // emulator channels enabled
 static float soundFiltering_ = -1.0f;
 static float soundVolume_ = -1.0f;
+// coreOptions.audioOff, as last applied by apply_muting()
+static bool soundAudioOff_ = false;
 
 void interp_rate() { /* empty for now */}
 
@@ -96,6 +106,17 @@ static Stereo_Buffer* stereo_buffer;
 
 static Blip_Synth<blip_best_quality, 1> pcm_synth[3]; // 32 kHz, 16 kHz, 8 kHz
 
+static void apply_muting();
+
+// All the channels are muted while coreOptions.audioOff is set. They keep
+// running, so the registers, the FIFOs and their DMA requests behave the
+// same, but nothing is synthesized, mixed or resampled.
+static inline void sync_audio_off()
+{
+    if (soundAudioOff_ != coreOptions.audioOff)
+        apply_muting();
+}
+
 void Gba_Pcm::init()
 {
     output = 0;
@@ -109,7 +130,7 @@ void Gba_Pcm::apply_control(int idx)
     shift = ~g_ioMem[SGCNT0_H] >> (2 + idx) & 1;
 
     int ch = 0;
-    if ((soundEnableFlag >> idx & 0x100) && (g_ioMem[NR52] & 0x80))
+    if ((soundEnableFlag >> idx & 0x100) && (g_ioMem[NR52] & 0x80) && !soundAudioOff_)
         ch = g_ioMem[SGCNT0_H + 1] >> (idx * 4) & 3;
 
     Blip_Buffer* out = 0;
@@ -253,6 +274,8 @@ static int gba_to_gb_sound(int addr)
 
 void soundEvent8(uint32_t address, uint8_t data)
 {
+    sync_audio_off();
+
     int gb_addr = gba_to_gb_sound(address);
     if (gb_addr) {
         g_ioMem[address] = data;
@@ -293,6 +316,8 @@ static void write_SGCNT0_H(int data)
 
 void soundEvent16(uint32_t address, uint16_t data)
 {
+    sync_audio_off();
+
     switch (address) {
     case SGCNT0_H:
         write_SGCNT0_H(data);
@@ -324,6 +349,8 @@ void soundEvent16(uint32_t address, uint16_t data)
 
 void soundTimerOverflow(int timer)
 {
+    sync_audio_off();
+
     pcm[0].timer_overflowed(timer);
     pcm[1].timer_overflowed(timer);
 }
@@ -334,40 +361,84 @@ static void end_frame(blip_time_t time)
     pcm[1].pcm.end_frame(time);
 
     gb_apu->end_frame(time);
-    stereo_buffer->end_frame(time);
+    if (!soundAudioOff_)
+        stereo_buffer->end_frame(time);
 }
 
 #ifdef __LIBRETRO__
 void flush_samples(Multi_Buffer* buffer)
 {
+    // Nothing was synthesized, see sync_audio_off().
+    if (coreOptions.audioOff)
+        return;
+
     int numSamples = buffer->read_samples((blip_sample_t*)soundFinalWave, buffer->samples_avail());
     soundDriver->write(soundFinalWave, numSamples);
     systemOnWriteDataToSoundBuffer(soundFinalWave, numSamples);
 }
 #else
+// Maximum change of the resampling ratio by the dynamic rate control.
+static double const RATE_CONTROL_MAX = 0.005;
+// The part of the resampling ratio that could not be applied yet.
+static double rate_control_error = 0.0;
+static bool rate_control_active = false;
+
+// Resamples slightly faster when the driver buffer is more than half full, and
+// slightly slower when it is less.
+static void apply_rate_control(Multi_Buffer* buffer)
+{
+    double fill = coreOptions.audioRateControl ? soundDriver->bufferFill() : -1.0;
+    if (fill < 0.0) {
+        if (rate_control_active) {
+            buffer->clock_rate(Gb_Apu::clock_rate);
+            rate_control_active = false;
+        }
+        return;
+    }
+    fill = std::min(std::max(fill, 0.0), 1.0);
+
+    double const one = 1L << BLIP_BUFFER_ACCURACY;
+    double const ratio = (double)buffer->sample_rate() / Gb_Apu::clock_rate *
+                         (1.0 + RATE_CONTROL_MAX * (1.0 - 2.0 * fill));
+
+    // The resampling ratio only has BLIP_BUFFER_ACCURACY bits, its steps are
+    // about 0.5% at 48 kHz. Alternate between the closest ones to get the
+    // requested ratio on average.
+    double const factor = ratio * one + rate_control_error;
+    long const rounded = std::max(1L, (long)floor(factor + 0.5));
+    rate_control_error = factor - rounded;
+
+    buffer->clock_rate((long)floor(buffer->sample_rate() * one / rounded + 0.5));
+    rate_control_active = true;
+}
+
 void flush_samples(Multi_Buffer* buffer)
 {
-    // We want to write the data frame by frame to support legacy audio drivers
-    // that don't use the length parameter of the write method.
-    // TODO: Update the Win32 audio drivers (DS, OAL, XA2), and flush all the
-    // samples at once to help reducing the audio delay on all platforms.
-    int soundBufferLen = (soundSampleRate / 60) * 4;
+    // Nothing was synthesized, see sync_audio_off().
+    if (coreOptions.audioOff)
+        return;
 
-    // soundBufferLen should have a whole number of sample pairs
-    assert(soundBufferLen % (2 * sizeof *soundFinalWave) == 0);
+    apply_rate_control(buffer);
 
-    // number of samples in output buffer
-    int const out_buf_size = soundBufferLen / sizeof *soundFinalWave;
+    // Write all the samples at once, the drivers take any length, so that
+    // none of them waits for the next frame.
+    long const avail = buffer->samples_avail();
+    if (avail <= 0)
+        return;
 
-    // Keep filling and writing soundFinalWave until it can't be fully filled
-    while (buffer->samples_avail() >= out_buf_size) {
-        buffer->read_samples((blip_sample_t*)soundFinalWave, out_buf_size);
-        if (soundPaused)
-            soundResume();
+    if (soundFinalWave.size() < (size_t)avail)
+        soundFinalWave.resize(avail);
 
-        soundDriver->write(soundFinalWave, soundBufferLen);
-        systemOnWriteDataToSoundBuffer(soundFinalWave, soundBufferLen);
-    }
+    int const numSamples = buffer->read_samples((blip_sample_t*)soundFinalWave.data(), avail);
+    int const length = numSamples * sizeof soundFinalWave[0];
+    if (length == 0)
+        return;
+
+    if (soundPaused)
+        soundResume();
+
+    soundDriver->write(soundFinalWave.data(), length);
+    systemOnWriteDataToSoundBuffer(soundFinalWave.data(), length);
 }
 #endif // ! __LIBRETRO__
 
@@ -389,6 +460,8 @@ static void apply_filtering()
 void psoundTickfn()
 {
     if (gb_apu && stereo_buffer) {
+        sync_audio_off();
+
         // Run sound hardware to present
         end_frame(soundTicks);
 
@@ -409,19 +482,26 @@ static void apply_muting()
     if (!stereo_buffer || !g_ioMem)
         return;
 
+    bool const audio_off_changed = soundAudioOff_ != coreOptions.audioOff;
+    soundAudioOff_ = coreOptions.audioOff;
+
     // PCM
     apply_control();
 
     if (gb_apu) {
         // APU
         for (int i = 0; i < 4; i++) {
-            if (soundEnableFlag >> i & 1)
+            if (soundEnableFlag >> i & 1 && !soundAudioOff_)
                 gb_apu->set_output(stereo_buffer->center(),
                     stereo_buffer->left(), stereo_buffer->right(), i);
             else
                 gb_apu->set_output(0, 0, 0, i);
         }
     }
+
+    // The buffer stops or restarts, drop the samples of the current frame
+    if (audio_off_changed)
+        stereo_buffer->clear();
 }
 
 static void reset_apu()
@@ -818,7 +898,11 @@ void soundReadGame(gzFile in, int version)
 }
 #endif // !__LIBRETRO__
 
-#ifdef __LIBRETRO__
+unsigned soundStateSize()
+{
+    return utilDataSize(gba_state);
+}
+
 void soundSaveGame(uint8_t*& out)
 {
     gb_apu->save_state(&state.apu);
@@ -842,4 +926,3 @@ void soundReadGame(const uint8_t*& in)
 
     apply_muting();
 }
-#endif // __LIBRETRO__
@@ -80,10 +80,10 @@ extern int SOUND_CLOCK_TICKS; // Number of 16.8 MHz clocks between calls to soun
 extern int soundTicks;
 
 // Saves/loads emulator state
-#ifdef __LIBRETRO__
+unsigned soundStateSize();
 void soundSaveGame(uint8_t*&);
 void soundReadGame(const uint8_t*& in);
-#else
+#ifndef __LIBRETRO__
 void soundSaveGame(gzFile);
 void soundReadGame(gzFile, int version);
 #endif
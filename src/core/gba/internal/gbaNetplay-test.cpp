@@ -0,0 +1,333 @@
+#include "core/gba/internal/gbaNetplay.h"
+
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "core/base/run_ahead.h"
+#include "core/base/system.h"
+
+// Used by the other parts of vbam-core-base.
+struct CoreOptions coreOptions;
+
+namespace {
+
+// A GBA stand-in: every frame mixes some player input into a hash, from
+// which the data and the transfers published by the frame are derived.
+// The transfers mix the data of both players into the hash, so a wrong
+// prediction changes all the frames after it.
+struct Machine {
+    int player = 0;
+    int frame = 0;
+    uint32_t hash = 0;
+    uint16_t send = 0xffff;
+    bool start = false;
+};
+
+uint32_t Mix(uint32_t hash, uint32_t value) {
+    hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    return hash * 0x85ebca6b;
+}
+
+// The hash of every frame emulated by each player, the last time it was.
+struct Player {
+    Machine machine;
+    std::vector<uint32_t> hashes;
+};
+
+// The player whose core is running, the hooks and the system have no context.
+Player* g_player = nullptr;
+
+void EmuMain(int) {
+    Machine& m = g_player->machine;
+    m.hash = Mix(m.hash, m.player * 1000003 + m.frame);
+    m.send = (uint16_t)(m.hash >> 8);
+    if (m.player == 0 && m.hash % 3 == 0)
+        m.start = true;
+
+    if ((int)g_player->hashes.size() <= m.frame)
+        g_player->hashes.resize(m.frame + 1);
+    g_player->hashes[m.frame] = m.hash;
+    m.frame++;
+
+    RunAhead::ReportFrame();
+}
+
+bool WriteMemState(char* memory, int available, long& reserved) {
+    reserved = sizeof(Machine);
+    if (reserved > available)
+        return false;
+    memcpy(memory, &g_player->machine, sizeof(Machine));
+    return true;
+}
+
+bool ReadMemState(char* memory, int available) {
+    if (available != (int)sizeof(Machine))
+        return false;
+    memcpy(&g_player->machine, memory, sizeof(Machine));
+    return true;
+}
+
+void Apply(const NetplayFrame& master, const NetplayFrame& slave) {
+    Machine& m = g_player->machine;
+    if (master.flags & NetplayFrame::kStart)
+        m.hash = Mix(Mix(m.hash, master.data), slave.data | (slave.flags << 16));
+}
+
+NetplayFrame Capture() {
+    Machine& m = g_player->machine;
+    NetplayFrame frame;
+    frame.data = m.send;
+    frame.flags = NetplayFrame::kMultiplayer;
+    if (m.start)
+        frame.flags |= NetplayFrame::kStart;
+    m.start = false;
+    return frame;
+}
+
+EmulatedSystem MakeSystem() {
+    EmulatedSystem system = {};
+    system.emuMain = EmuMain;
+    system.emuReadMemState = ReadMemState;
+    system.emuWriteMemState = WriteMemState;
+    system.emuCount = 1;
+    return system;
+}
+
+// The hashes of `frames` frames of both players, emulated in lockstep with
+// the actual events of the other player.
+std::vector<uint32_t> Reference(int player, int frames) {
+    Player players[2];
+    players[1].machine.player = 1;
+    NetplayFrame events[2];
+    for (int frame = 0; frame < frames; frame++) {
+        for (int i = 0; i < 2; i++) {
+            g_player = &players[i];
+            if (frame > 0)
+                Apply(events[0], events[1]);
+            EmuMain(1);
+        }
+        for (int i = 0; i < 2; i++) {
+            g_player = &players[i];
+            events[i] = Capture();
+        }
+    }
+    return players[player].hashes;
+}
+
+// A lossy link between the 2 players, driven by a step counter. The packets
+// are lost, duplicated, delayed and reordered at random.
+class Network {
+public:
+    struct Config {
+        int loss_percent = 0;
+        int duplicate_percent = 0;
+        int max_delay = 0;
+    };
+
+    class Endpoint : public NetplayTransport {
+    public:
+        Endpoint(Network* network, int index) : network_(network), index_(index) {}
+
+        void Send(const std::vector<uint8_t>& packet) override {
+            network_->Send(1 - index_, packet);
+        }
+
+        bool Receive(std::vector<uint8_t>& packet, int) override {
+            return network_->Receive(index_, packet);
+        }
+
+    private:
+        Network* network_;
+        int index_;
+    };
+
+    Network(uint32_t seed, Config config) : rng_(seed), config_(config) {}
+
+    void Step() { now_++; }
+    void set_config(Config config) { config_ = config; }
+    Endpoint* endpoint(int index) { return &endpoints_[index]; }
+    int sent(int index) const { return sent_[index]; }
+    // The frame count of the last events packet sent to `index`.
+    int last_count(int index) const { return last_count_[index]; }
+
+private:
+    struct Packet {
+        int deliver_at;
+        std::vector<uint8_t> data;
+    };
+
+    void Send(int to, const std::vector<uint8_t>& packet) {
+        sent_[1 - to]++;
+        // The frame count follows the 4 32-bit header fields.
+        last_count_[to] = packet.size() > 16 ? packet[16] : -1;
+        if ((int)(rng_() % 100) < config_.loss_percent)
+            return;
+        const int copies = (int)(rng_() % 100) < config_.duplicate_percent ? 2 : 1;
+        for (int i = 0; i < copies; i++) {
+            const int delay = config_.max_delay ? (int)(rng_() % (config_.max_delay + 1)) : 0;
+            queues_[to].push_back({now_ + delay, packet});
+        }
+    }
+
+    bool Receive(int index, std::vector<uint8_t>& packet) {
+        std::vector<Packet>& queue = queues_[index];
+        // Any of the packets due can come first.
+        std::vector<size_t> due;
+        for (size_t i = 0; i < queue.size(); i++) {
+            if (queue[i].deliver_at <= now_)
+                due.push_back(i);
+        }
+        if (due.empty())
+            return false;
+
+        const size_t i = due[rng_() % due.size()];
+        packet = std::move(queue[i].data);
+        queue.erase(queue.begin() + i);
+        return true;
+    }
+
+    std::mt19937 rng_;
+    Config config_;
+    int now_ = 0;
+    std::vector<Packet> queues_[2];
+    int sent_[2] = {};
+    int last_count_[2] = {-1, -1};
+    Endpoint endpoints_[2] = {{this, 0}, {this, 1}};
+};
+
+class NetplaySessionTest : public ::testing::Test {
+protected:
+    NetplaySessionTest() {
+        players_[1].machine.player = 1;
+        for (int i = 0; i < 2; i++) {
+            sessions_[i] = std::make_unique<NetplaySession>(NetplaySession::Hooks{Apply, Capture});
+        }
+    }
+
+    void Start(Network* network) {
+        for (int i = 0; i < 2; i++) {
+            sessions_[i]->Start(i == 0, network->endpoint(i));
+        }
+    }
+
+    // Lets player `i` emulate its next frame, returns false when the session
+    // gives up.
+    bool EmulateFrame(int i) {
+        g_player = &players_[i];
+        return sessions_[i]->EmulateFrame(system_, 1000);
+    }
+
+    // Runs both players until they reach `frames`, the slave missing some
+    // steps when `uneven`.
+    void Run(Network* network, std::mt19937* rng, int frames, bool uneven) {
+        for (int step = 0; step < 100 * frames; step++) {
+            if (sessions_[0]->frame() >= frames && sessions_[1]->frame() >= frames)
+                return;
+            network->Step();
+            ASSERT_TRUE(EmulateFrame(0)) << "step " << step;
+            if (!uneven || (*rng)() % 4 != 0) {
+                ASSERT_TRUE(EmulateFrame(1)) << "step " << step;
+            }
+        }
+        FAIL() << "The players did not reach frame " << frames;
+    }
+
+    const EmulatedSystem system_ = MakeSystem();
+    Player players_[2];
+    std::unique_ptr<NetplaySession> sessions_[2];
+};
+
+}  // namespace
+
+TEST_F(NetplaySessionTest, PerfectLinkMatchesLockstep) {
+    constexpr int kFrames = 300;
+    Network network(1, {});
+    std::mt19937 rng(1);
+    Start(&network);
+
+    Run(&network, &rng, kFrames, false);
+
+    for (int i = 0; i < 2; i++) {
+        const std::vector<uint32_t> reference = Reference(i, kFrames);
+        ASSERT_GE(players_[i].hashes.size(), (size_t)kFrames);
+        for (int frame = 0; frame < kFrames; frame++) {
+            ASSERT_EQ(players_[i].hashes[frame], reference[frame])
+                << "player " << i << " frame " << frame;
+        }
+    }
+}
+
+TEST_F(NetplaySessionTest, RollbacksMatchLockstep) {
+    constexpr int kFrames = 600;
+    const Network::Config configs[] = {
+        {0, 0, 3},
+        {25, 10, 4},
+        {50, 20, 2},
+    };
+
+    for (uint32_t seed = 1; seed <= 3; seed++) {
+        for (const Network::Config& config : configs) {
+            SCOPED_TRACE(testing::Message() << "seed " << seed << " loss " << config.loss_percent);
+            players_[0] = Player();
+            players_[1] = Player();
+            players_[1].machine.player = 1;
+            Network network(seed, config);
+            std::mt19937 rng(seed);
+            Start(&network);
+
+            Run(&network, &rng, kFrames, true);
+            // Deliver everything, so that the last predictions are checked.
+            network.set_config({});
+            Run(&network, &rng, kFrames + 20, false);
+
+            for (int i = 0; i < 2; i++) {
+                const std::vector<uint32_t> reference = Reference(i, kFrames);
+                for (int frame = 0; frame < kFrames; frame++) {
+                    ASSERT_EQ(players_[i].hashes[frame], reference[frame])
+                        << "player " << i << " frame " << frame;
+                }
+            }
+        }
+    }
+}
+
+TEST_F(NetplaySessionTest, StallsWithoutTheOtherPlayer) {
+    Network network(1, {100, 0, 0});
+    Start(&network);
+
+    for (int i = 0; i < 20; i++) {
+        network.Step();
+        ASSERT_TRUE(EmulateFrame(0));
+    }
+    const int frame = sessions_[0]->frame();
+    const int sent = network.sent(0);
+    for (int i = 0; i < 20; i++) {
+        network.Step();
+        ASSERT_TRUE(EmulateFrame(0));
+    }
+
+    EXPECT_GT(frame, 0);
+    EXPECT_LT(frame, 20);
+    EXPECT_EQ(sessions_[0]->frame(), frame);
+    // The events are sent again while stalled.
+    EXPECT_EQ(network.sent(0), sent + 20);
+}
+
+TEST_F(NetplaySessionTest, AckedEventsAreNotSentAgain) {
+    Network network(1, {});
+    std::mt19937 rng(1);
+    Start(&network);
+
+    Run(&network, &rng, 100, false);
+
+    // Without the acks, the events of the last 2 * kMaxAhead (16) frames are
+    // sent. With them, only the ones the other player did not receive yet.
+    EXPECT_GT(network.last_count(0), 0);
+    EXPECT_LT(network.last_count(0), 16);
+    EXPECT_GT(network.last_count(1), 0);
+    EXPECT_LT(network.last_count(1), 16);
+}
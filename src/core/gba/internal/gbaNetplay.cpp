@@ -0,0 +1,266 @@
+#include "core/gba/internal/gbaNetplay.h"
+
+#include <algorithm>
+#include <climits>
+
+#include "core/base/message.h"
+#include "core/base/run_ahead.h"
+#include "core/base/system.h"
+
+namespace {
+
+constexpr int kNoRollback = INT_MAX;
+
+// How long a stalled frame waits for the other player.
+constexpr int kStallWaitMs = 16;
+
+// The events packets, in little-endian:
+//   uint32_t  sequence number
+//   uint32_t  last remote sequence number received
+//   uint32_t  final frames
+//   uint32_t  first frame
+//   uint8_t   frame count
+//   count times:
+//     uint16_t  data
+//     uint8_t   flags
+constexpr size_t kHeaderSize = 17;
+constexpr size_t kFrameSize = 3;
+
+void Put8(std::vector<uint8_t>& packet, uint8_t value) {
+    packet.push_back(value);
+}
+
+void Put16(std::vector<uint8_t>& packet, uint16_t value) {
+    Put8(packet, (uint8_t)value);
+    Put8(packet, (uint8_t)(value >> 8));
+}
+
+void Put32(std::vector<uint8_t>& packet, uint32_t value) {
+    Put16(packet, (uint16_t)value);
+    Put16(packet, (uint16_t)(value >> 16));
+}
+
+uint16_t Get16(const uint8_t* data) {
+    return (uint16_t)(data[0] | (data[1] << 8));
+}
+
+uint32_t Get32(const uint8_t* data) {
+    return Get16(data) | ((uint32_t)Get16(data + 2) << 16);
+}
+
+}  // namespace
+
+NetplaySession::NetplaySession(Hooks hooks) : hooks_(hooks), rollback_frame_(kNoRollback) {}
+
+void NetplaySession::Start(bool master, NetplayTransport* transport) {
+    Stop();
+
+    master_ = master;
+    transport_ = transport;
+    last_receive_time_ = systemGetClock();
+}
+
+void NetplaySession::Stop() {
+    transport_ = nullptr;
+    frame_ = 0;
+    remote_frames_ = 0;
+    remote_final_frames_ = 0;
+    sequence_ = 0;
+    remote_sequence_ = 0;
+    acked_sequence_ = 0;
+    rollback_frame_ = kNoRollback;
+    desync_ = false;
+    for (int i = 0; i < kStates; i++) {
+        states_[i].clear();
+        states_[i].shrink_to_fit();
+    }
+}
+
+bool NetplaySession::EmulateFrame(const EmulatedSystem& system, int timeout_ms) {
+    Receive(0);
+
+    if (rollback_frame_ != kNoRollback) {
+        const int frame = rollback_frame_;
+        rollback_frame_ = kNoRollback;
+        if (!Rollback(system, frame))
+            desync_ = true;
+    }
+
+    if (desync_) {
+        systemMessage(0, N_("Link lost synchronization with player %d"), master_ ? 2 : 1);
+        return false;
+    }
+
+    if (frame_ - remote_final_frames_ >= kMaxAhead) {
+        // Give the other player some time to catch up, and resend the events
+        // in case they were lost.
+        Receive(kStallWaitMs);
+        SendEvents();
+
+        if ((int)(systemGetClock() - last_receive_time_) > timeout_ms) {
+            systemMessage(0, N_("Link timed out waiting for player %d"), master_ ? 2 : 1);
+            return false;
+        }
+        return true;
+    }
+
+    if (!Emulate(system, false))
+        return false;
+
+    SendEvents();
+    return true;
+}
+
+void NetplaySession::Receive(int wait_ms) {
+    while (transport_->Receive(packet_, wait_ms)) {
+        wait_ms = 0;
+        last_receive_time_ = systemGetClock();
+        OnEvents(packet_);
+    }
+}
+
+void NetplaySession::OnEvents(const std::vector<uint8_t>& packet) {
+    if (packet.size() < kHeaderSize)
+        return;
+
+    const uint32_t sequence = Get32(&packet[0]);
+    const uint32_t acked = Get32(&packet[4]);
+    const uint32_t final_frames = Get32(&packet[8]);
+    const uint32_t first = Get32(&packet[12]);
+    const int count = packet[16];
+    if (sequence <= remote_sequence_ || acked > sequence_ || first > (uint32_t)(INT_MAX - count) ||
+        packet.size() < kHeaderSize + count * kFrameSize) {
+        return;
+    }
+
+    remote_sequence_ = sequence;
+    acked_sequence_ = std::max(acked_sequence_, acked);
+
+    for (int i = 0; i < count; i++) {
+        const int frame = (int)first + i;
+        const uint8_t* data = &packet[kHeaderSize + i * kFrameSize];
+        NetplayFrame event;
+        event.data = Get16(data);
+        event.flags = data[2];
+
+        if (frame < remote_final_frames_ || frame > remote_frames_)
+            continue;
+
+        remote_[frame % kFrames] = event;
+        if (frame == remote_frames_)
+            remote_frames_++;
+
+        // The next frame was emulated with a wrong prediction.
+        if (frame + 1 < frame_ && event != used_[frame % kFrames]) {
+            if (frame + 1 < frame_ - kStates)
+                desync_ = true;
+            else
+                rollback_frame_ = std::min(rollback_frame_, frame + 1);
+        }
+    }
+
+    // The packets before held the current events of the frames before `first`.
+    remote_final_frames_ =
+        std::max(remote_final_frames_, (int)std::min<uint32_t>(final_frames, remote_frames_));
+}
+
+void NetplaySession::SendEvents() {
+    sequence_++;
+
+    // The events are sent again until a packet with their current value was
+    // received. The other player is never more than 2 * kMaxAhead frames
+    // behind, and ignores the older frames.
+    int first = std::max(0, frame_ - 2 * kMaxAhead);
+    while (first < frame_ && local_sequence_[first % kFrames] != kNotSent &&
+           local_sequence_[first % kFrames] <= acked_sequence_) {
+        first++;
+    }
+
+    // A frame no longer changes once all the remote frames before it are
+    // final, and it was emulated again with them.
+    const int final_frames = std::min({frame_, remote_final_frames_ + 1, rollback_frame_});
+
+    packet_.clear();
+    Put32(packet_, sequence_);
+    Put32(packet_, remote_sequence_);
+    Put32(packet_, (uint32_t)final_frames);
+    Put32(packet_, (uint32_t)first);
+    Put8(packet_, (uint8_t)(frame_ - first));
+    for (int frame = first; frame < frame_; frame++) {
+        const NetplayFrame& event = local_[frame % kFrames];
+        Put16(packet_, event.data);
+        Put8(packet_, event.flags);
+        if (local_sequence_[frame % kFrames] == kNotSent)
+            local_sequence_[frame % kFrames] = sequence_;
+    }
+
+    transport_->Send(packet_);
+}
+
+NetplayFrame NetplaySession::RemoteFrame(int frame) const {
+    if (frame < remote_frames_)
+        return remote_[frame % kFrames];
+
+    if (remote_frames_ == 0)
+        return NetplayFrame();
+
+    // Predict the same events as in the last frame received, without starting
+    // a new transfer.
+    NetplayFrame prediction = remote_[(remote_frames_ - 1) % kFrames];
+    prediction.flags &= ~NetplayFrame::kStart;
+    return prediction;
+}
+
+bool NetplaySession::Emulate(const EmulatedSystem& system, bool replay) {
+    std::vector<char>& state = states_[frame_ % kStates];
+    long size = 0;
+    if (!system.emuWriteMemState(state.data(), (int)state.size(), size)) {
+        state.resize(size);
+        if (!system.emuWriteMemState(state.data(), (int)state.size(), size))
+            return false;
+    }
+
+    if (frame_ > 0) {
+        const NetplayFrame& local = local_[(frame_ - 1) % kFrames];
+        const NetplayFrame remote = RemoteFrame(frame_ - 1);
+        used_[(frame_ - 1) % kFrames] = remote;
+        hooks_.apply(master_ ? local : remote, master_ ? remote : local);
+    }
+
+    if (replay)
+        RunAhead::EmulateHiddenFrame(system, false);
+    else
+        RunAhead::EmulateUntilFrameDone(system);
+
+    // The events of a frame emulated again are only sent again if they
+    // changed.
+    const NetplayFrame local = hooks_.capture();
+    if (!replay || local != local_[frame_ % kFrames]) {
+        local_[frame_ % kFrames] = local;
+        local_sequence_[frame_ % kFrames] = kNotSent;
+    }
+    frame_++;
+
+    return true;
+}
+
+bool NetplaySession::Rollback(const EmulatedSystem& system, int frame) {
+    const int end = frame_;
+    // Restoring the state resets the battery save counter.
+    const int save_update_counter = systemSaveUpdateCounter;
+
+    std::vector<char>& state = states_[frame % kStates];
+    if (!system.emuReadMemState(state.data(), (int)state.size()))
+        return false;
+
+    frame_ = frame;
+    while (frame_ < end) {
+        if (!Emulate(system, true))
+            return false;
+    }
+
+    if (systemSaveUpdateCounter == SYSTEM_SAVE_NOT_UPDATED)
+        systemSaveUpdateCounter = save_update_counter;
+
+    return true;
+}
@@ -0,0 +1,139 @@
+#ifndef VBAM_CORE_GBA_INTERNAL_GBANETPLAY_H_
+#define VBAM_CORE_GBA_INTERNAL_GBANETPLAY_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct EmulatedSystem;
+
+// The link events of one GBA during one frame.
+struct NetplayFrame {
+    enum Flags : uint8_t {
+        // The master started a transfer during the frame.
+        kStart = 1,
+        // The serial port was in multiplayer mode at the end of the frame.
+        kMultiplayer = 2,
+    };
+
+    // SIOMLT_SEND when the transfer started on the master, at the end of the
+    // frame otherwise.
+    uint16_t data = 0xffff;
+    uint8_t flags = 0;
+
+    bool operator==(const NetplayFrame& other) const {
+        return data == other.data && flags == other.flags;
+    }
+    bool operator!=(const NetplayFrame& other) const { return !(*this == other); }
+};
+
+// Carries the packets of a NetplaySession to the other player, once
+// connected. The packets may be lost, duplicated or reordered.
+class NetplayTransport {
+public:
+    virtual ~NetplayTransport() = default;
+
+    virtual void Send(const std::vector<uint8_t>& packet) = 0;
+
+    // Receives the next packet of the other player, waiting up to `wait_ms`
+    // for one. Returns false if there is none.
+    virtual bool Receive(std::vector<uint8_t>& packet, int wait_ms) = 0;
+};
+
+// Rollback netplay between 2 GBAs.
+//
+// The transfers are latched to the frames: a transfer started by the master
+// during a frame completes at the start of the next one on both GBAs, with
+// the data both of them published for that frame. The emulation does not wait
+// for the events of the other player. They are predicted to be the same as in
+// the last frame received, and when they turn out to be different, the frames
+// emulated since are emulated again from a saved state.
+//
+// As the data published depends on the data received, a correction can lead
+// to a correction on the other side, a frame later. A frame is final once all
+// the remote frames before it are, and the emulation stalls when it gets too
+// far ahead of the last final remote frame, so that the frames to emulate
+// again always have a saved state.
+class NetplaySession {
+public:
+    struct Hooks {
+        // Completes the transfer of the previous frame, if any, before a frame
+        // is emulated.
+        void (*apply)(const NetplayFrame& master, const NetplayFrame& slave);
+        // Returns the events of the frame that was just emulated.
+        NetplayFrame (*capture)();
+    };
+
+    explicit NetplaySession(Hooks hooks);
+
+    // Starts a session with the other player, connected through `transport`.
+    void Start(bool master, NetplayTransport* transport);
+    void Stop();
+
+    // Emulates the next frame, unless too far ahead of the other player.
+    // Returns false when the connection is lost.
+    bool EmulateFrame(const EmulatedSystem& system, int timeout_ms);
+
+    // The next frame to emulate.
+    int frame() const { return frame_; }
+
+private:
+    // Frames emulated ahead of the last final remote frame before stalling.
+    static constexpr int kMaxAhead = 8;
+    // Saved states, the oldest frame that can be emulated again.
+    static constexpr int kStates = kMaxAhead + 2;
+    // Frames of events kept, they cover the saved states, the remote frames
+    // received ahead and the local frames not received yet.
+    static constexpr int kFrames = 32;
+    // The local events that were not sent since they last changed.
+    static constexpr uint32_t kNotSent = UINT32_MAX;
+
+    void Receive(int wait_ms);
+    void OnEvents(const std::vector<uint8_t>& packet);
+    void SendEvents();
+
+    // The remote events for `frame`, predicted if not received yet.
+    NetplayFrame RemoteFrame(int frame) const;
+
+    // Emulates `frame_`. The frames emulated again are not presented.
+    bool Emulate(const EmulatedSystem& system, bool replay);
+    // Emulates again from `frame` to `frame_`.
+    bool Rollback(const EmulatedSystem& system, int frame);
+
+    const Hooks hooks_;
+
+    bool master_ = false;
+    NetplayTransport* transport_ = nullptr;
+    uint32_t last_receive_time_ = 0;
+
+    // The next frame to emulate.
+    int frame_ = 0;
+    // All the remote frames before this one were received.
+    int remote_frames_ = 0;
+    // The remote frames before this one can no longer change.
+    int remote_final_frames_ = 0;
+    // The packets are numbered, the older ones received after a newer one
+    // are dropped, as their events may have been corrected since.
+    uint32_t sequence_ = 0;
+    uint32_t remote_sequence_ = 0;
+    // The last local packet that the other player received.
+    uint32_t acked_sequence_ = 0;
+    // The oldest frame that has to be emulated again, kNoRollback if none.
+    int rollback_frame_;
+    // A frame that can no longer be emulated again turned out to be wrong.
+    bool desync_ = false;
+
+    // Indexed by frame % kFrames.
+    NetplayFrame local_[kFrames];
+    // The first packet with the current local events, kNotSent if none.
+    uint32_t local_sequence_[kFrames];
+    NetplayFrame remote_[kFrames];
+    // The remote events used to emulate the frame after.
+    NetplayFrame used_[kFrames];
+    // Indexed by frame % kStates, the state at the start of the frame.
+    std::vector<char> states_[kStates];
+    // Kept to reuse its allocation.
+    std::vector<uint8_t> packet_;
+};
+
+#endif  // VBAM_CORE_GBA_INTERNAL_GBANETPLAY_H_
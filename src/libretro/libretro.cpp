@@ -12,14 +12,17 @@
 #include "components/filters_agb/filters_agb.h"
 #include "components/filters_interframe/interframe.h"
 #include "core/base/check.h"
+#include "core/base/color_convert.h"
 #include "core/base/system.h"
 #include "core/base/file_util.h"
+#include "core/base/run_ahead.h"
 #include "core/base/sizes.h"
 #include "core/gb/gb.h"
 #include "core/gb/gbCheats.h"
 #include "core/gb/gbGlobals.h"
 #include "core/gb/gbMemory.h"
 #include "core/gb/gbSound.h"
+#include "core/gba/gba.h"
 #include "core/gba/gbaCheats.h"
 #include "core/gba/gbaEeprom.h"
 #include "core/gba/gbaFlash.h"
@@ -55,6 +58,9 @@ static bool option_forceRTCenable = false;
 static double option_sndFiltering = 0.5;
 static unsigned option_gbPalette = 0;
 static bool option_lcdfilter = false;
+static int option_runAhead = 0;
+
+static RunAhead run_ahead;
 
 // filters
 typedef void (*IFBFilterFunc)(uint8_t*, uint32_t, int, int);
@@ -1006,6 +1012,14 @@ static int option_analogDeadzone;
 static int option_gyroSensitivity, option_tiltSensitivity;
 static bool option_swapAnalogSticks;
 
+// Rebuilds the color maps. Without the LCD filter, the maps are plain shifts
+// and scanlines can be converted without going through them.
+static void update_colors(void)
+{
+    gbafilter_update_colors(option_lcdfilter);
+    colorConvertSetMode(option_lcdfilter ? ColorConvertMode::kColorMap : ColorConvertMode::kShift);
+}
+
 static void update_variables(bool startup)
 {
     struct retro_variable var = { NULL, NULL };
@@ -1145,6 +1159,13 @@ static void update_variables(bool startup)
         option_turboDelay = atoi(var.value);
     }
 
+    var.key = "vbam_runahead";
+    var.value = NULL;
+
+    if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value) {
+        option_runAhead = atoi(var.value);
+    }
+
     var.key = "vbam_astick_deadzone";
     var.value = NULL;
 
@@ -1216,7 +1237,7 @@ static void update_variables(bool startup)
         bool prev_lcdfilter = option_lcdfilter;
         option_lcdfilter = (!strcmp(var.value, "enabled")) ? true : false;
         if (prev_lcdfilter != option_lcdfilter)
-            gbafilter_update_colors(option_lcdfilter);
+            update_colors();
     }
 
     var.key = "vbam_interframeblending";
@@ -1473,8 +1494,12 @@ void retro_run(void)
 
     has_frame = 0;
 
-    while (!has_frame)
-        core->emuMain(core->emuCount);
+    if (option_runAhead > 0) {
+        run_ahead.EmulateFrame(*core, option_runAhead);
+    } else {
+        while (!has_frame)
+            core->emuMain(core->emuCount);
+    }
 }
 
 static unsigned serialize_size = 0;
@@ -1495,6 +1520,9 @@ bool retro_unserialize(const void* data, size_t size)
 {
     if (size == serialize_size)
         return core->emuReadState((uint8_t*)data);
+    // States saved by older builds still had the frame buffer.
+    if (type == IMAGE_GBA && size == CPUOldLibretroStateSize())
+        return core->emuReadState((uint8_t*)data);
     return false;
 }
 
@@ -1605,7 +1633,7 @@ bool retro_load_game(const struct retro_game_info *game)
       return false;
    }
 
-   gbafilter_update_colors(option_lcdfilter);
+   update_colors();
    update_variables(true);
    soundInit();
 
@@ -1726,9 +1754,7 @@ bool retro_load_game(const struct retro_game_info *game)
 
    update_input_descriptors();    // Initialize input descriptors and info
    update_variables(false);
-   uint8_t* state_buf = (uint8_t*)malloc(2000000);
-   serialize_size = core->emuWriteState(state_buf);
-   free(state_buf);
+   serialize_size = (type == IMAGE_GBA) ? CPUStateSize() : gbStateSize();
 
    emulating = 1;
 
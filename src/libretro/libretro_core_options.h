@@ -296,6 +296,23 @@ struct retro_core_option_v2_definition option_defs_us[] = {
         },
         "3"
     },
+    {
+        "vbam_runahead",
+        "Run-Ahead (in frames)",
+        NULL,
+        "Shows the frame this many frames ahead of the emulated one to hide the input latency of the games. 0 disables it. Every frame ahead costs a full frame of emulation.",
+        NULL,
+        "input",
+        {
+            { "0", NULL },
+            { "1", NULL },
+            { "2", NULL },
+            { "3", NULL },
+            { "4", NULL },
+            { NULL, NULL },
+        },
+        "0"
+    },
     {
         "vbam_solarsensor",
         "Solar Sensor Level",
@@ -106,7 +106,7 @@ enum named_opts
 #define SOUND_STEREO     0.15
 
 #define REWIND_NUM 8
-#define REWIND_SIZE 400000
+#define REWIND_SIZE 1000000
 
 char path[2048];
 
@@ -300,6 +300,7 @@ void ValidateConfig()
 void LoadConfig()
 {
 	agbPrint = ReadPrefHex("agbPrint");
+	coreOptions.audioRateControl = ReadPref("audioRateControl", 0);
 	autoFireMaxCount = fromDec(ReadPrefString("autoFireMaxCount"));
 	autoFrameSkip = ReadPref("autoFrameSkip", 0);
 	autoPatch = ReadPref("autoPatch", 1);
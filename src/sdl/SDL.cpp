@@ -223,7 +223,7 @@ static int sdlSoundToggledOff = 0;
 extern int autoFireMaxCount;
 
 #define REWIND_NUM 8
-#define REWIND_SIZE 400000
+#define REWIND_SIZE 1000000
 
 enum VIDEO_SIZE {
     VIDEO_1X,
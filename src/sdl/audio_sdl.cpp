@@ -45,74 +45,44 @@ bool SoundSDL::should_wait() {
     return emulating && !coreOptions.speedup && current_rate && !gba_joybus_active;
 }
 
-std::size_t SoundSDL::buffer_size() {
-    SDL_LockMutex(mutex);
-    std::size_t size = samples_buf.used();
-    SDL_UnlockMutex(mutex);
-
-    return size;
-}
-
 void SoundSDL::read(uint16_t* stream, int length) {
     if (length <= 0)
         return;
 
-    SDL_memset(stream, 0, length);
-
-    // if not initialzed, paused or shutting down, do nothing
-    if (!initialized || !emulating)
-        return;
-
-    if (!buffer_size()) {
-        if (should_wait())
-            SDL_SemWait(data_available);
-        else
-            return;
-    }
-
-    SDL_LockMutex(mutex);
-
-    samples_buf.read(stream, std::min((std::size_t)(length / 2), samples_buf.used()));
-
-    SDL_UnlockMutex(mutex);
-
-    SDL_SemPost(data_read);
+    // Never wait for the emulation, an underrun plays silence.
+    std::size_t samples = samples_buf.read(stream, length / 2);
+    SDL_memset(stream + samples, 0, length - samples * 2);
 }
 
 void SoundSDL::write(uint16_t * finalWave, int length) {
     if (!initialized)
         return;
 
-    SDL_LockMutex(mutex);
-
-    if (SDL_GetAudioDeviceStatus(sound_device) != SDL_AUDIO_PLAYING)
-	SDL_PauseAudioDevice(sound_device, 0);
-
-    std::size_t samples = length / 4;
-    std::size_t avail;
-
-    while ((avail = samples_buf.avail() / 2) < samples) {
-	samples_buf.write(finalWave, avail * 2);
+    if (!device_playing) {
+        SDL_PauseAudioDevice(sound_device, 0);
+        device_playing = true;
+    }
 
-	finalWave += avail * 2;
-	samples -= avail;
+    // Both threads move whole stereo frames, so the free space is always a
+    // whole number of frames.
+    std::size_t samples = length / 2;
 
-	SDL_UnlockMutex(mutex);
+    while (true) {
+        std::size_t written = samples_buf.write(finalWave, samples);
+        finalWave += written;
+        samples -= written;
 
-	SDL_SemPost(data_available);
+        if (!samples)
+            return;
 
-	if (should_wait())
-	    SDL_SemWait(data_read);
-	else
-	    // Drop the remainder of the audio data
-	    return;
+        if (!should_wait())
+            // Drop the remainder of the audio data
+            return;
 
-	SDL_LockMutex(mutex);
+        // The emulation is ahead of the audio, the ring is full: wait for
+        // the callback to play some of it. This is the throttling.
+        SDL_Delay(1);
     }
-
-    samples_buf.write(finalWave, samples * 2);
-
-    SDL_UnlockMutex(mutex);
 }
 
 
@@ -133,6 +103,8 @@ bool SoundSDL::init(long sampleRate) {
 
     if (!SDL_WasInit(SDL_INIT_AUDIO)) SDL_Init(SDL_INIT_AUDIO);
 
+    samples_buf.reset(static_cast<size_t>(std::ceil(buftime * sampleRate * 2)));
+
     sound_device = SDL_OpenAudioDevice(NULL, 0, &audio, NULL, 0);
 
     if(sound_device == 0) {
@@ -140,11 +112,7 @@ bool SoundSDL::init(long sampleRate) {
         return false;
     }
 
-    samples_buf.reset(static_cast<size_t>(std::ceil(buftime * sampleRate * 2)));
-
-    mutex          = SDL_CreateMutex();
-    data_available = SDL_CreateSemaphore(0);
-    data_read      = SDL_CreateSemaphore(1);
+    device_playing = false;
 
     // turn off audio events because we are not processing them
 #if SDL_VERSION_ATLEAST(2, 0, 4)
@@ -161,26 +129,10 @@ void SoundSDL::deinit() {
 
     initialized = false;
 
-    SDL_LockMutex(mutex);
-    int is_emulating = emulating;
-    emulating = 0;
-    SDL_SemPost(data_available);
-    SDL_SemPost(data_read);
-    SDL_UnlockMutex(mutex);
-
-    SDL_Delay(100);
-
-    SDL_DestroySemaphore(data_available);
-    data_available = nullptr;
-    SDL_DestroySemaphore(data_read);
-    data_read      = nullptr;
-
-    SDL_DestroyMutex(mutex);
-    mutex = nullptr;
-
+    // Waits for the callback to return, it is not called after.
     SDL_CloseAudioDevice(sound_device);
-
-    emulating = is_emulating;
+    sound_device = 0;
+    device_playing = false;
 }
 
 SoundSDL::~SoundSDL() {
@@ -194,6 +146,13 @@ void SoundSDL::reset() {
     init(soundGetSampleRate());
 }
 
+double SoundSDL::bufferFill() {
+    if (!initialized)
+        return -1.0;
+
+    return (double)samples_buf.size() / samples_buf.capacity();
+}
+
 void SoundSDL::setThrottle(unsigned short throttle_) {
     current_rate = throttle_;
     reset();
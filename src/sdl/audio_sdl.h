@@ -20,8 +20,8 @@
 
 #include <SDL.h>
 
-#include "core/base/ringbuffer.h"
 #include "core/base/sound_driver.h"
+#include "core/base/spsc_ring.h"
 
 class SoundSDL final : public SoundDriver {
 public:
@@ -32,7 +32,6 @@ private:
         static void soundCallback(void* data, uint8_t* stream, int length);
         void read(uint16_t* stream, int length);
         bool should_wait();
-        std::size_t buffer_size();
         void deinit();
 
         // SoundDriver implementation.
@@ -42,15 +41,14 @@ private:
         void resume() override;
         void write(uint16_t *finalWave, int length) override;
         void setThrottle(unsigned short throttle_) override;
+        double bufferFill() override;
 
-        RingBuffer<uint16_t> samples_buf;
+        // Written by the emulation thread, read by the audio callback. None
+        // of them waits for the other.
+        SpscRing<uint16_t> samples_buf;
 
         SDL_AudioDeviceID sound_device = 0;
-
-        SDL_mutex* mutex;
-        SDL_sem* data_available;
-        SDL_sem* data_read;
-        SDL_AudioSpec audio_spec;
+        bool device_playing = false;
 
         unsigned short current_rate;
 
@@ -27,6 +27,7 @@
 #include "core/gba/gbaCpu.h"
 #include "core/gba/gbaCpuArmDis.h"
 #include "core/gba/gbaElf.h"
+#include "core/gba/gbaGfx.h"
 #include "core/gba/gbaSound.h"
 #include "sdl/exprNode.h"
 
@@ -46,14 +47,23 @@ extern struct EmulatedSystem emulator;
 #define debuggerReadByte(addr) \
     map[(addr) >> 24].address[(addr)&map[(addr) >> 24].mask]
 
-#define debuggerWriteMemory(addr, value) \
-    WRITE32LE(&map[(addr) >> 24].address[(addr)&map[(addr) >> 24].mask], value)
+#define debuggerWriteMemory(addr, value)                                            \
+    do {                                                                             \
+        WRITE32LE(&map[(addr) >> 24].address[(addr)&map[(addr) >> 24].mask], value); \
+        gfxMemoryChanged();                                                          \
+    } while (0)
 
-#define debuggerWriteHalfWord(addr, value) \
-    WRITE16LE(&map[(addr) >> 24].address[(addr)&map[(addr) >> 24].mask], value)
+#define debuggerWriteHalfWord(addr, value)                                           \
+    do {                                                                             \
+        WRITE16LE(&map[(addr) >> 24].address[(addr)&map[(addr) >> 24].mask], value); \
+        gfxMemoryChanged();                                                          \
+    } while (0)
 
-#define debuggerWriteByte(addr, value) \
-    map[(addr) >> 24].address[(addr)&map[(addr) >> 24].mask] = (value)
+#define debuggerWriteByte(addr, value)                                              \
+    do {                                                                            \
+        map[(addr) >> 24].address[(addr)&map[(addr) >> 24].mask] = (value);         \
+        gfxMemoryChanged();                                                         \
+    } while (0)
 
 struct breakpointInfo {
     uint32_t address;
@@ -1113,6 +1123,7 @@ static void debuggerBreakWriteClear(int n, char** args)
                 0x7000000 + address, 0x7000000 + final);
         } break;
         }
+        CPUUpdateMemoryPages();
     } else if (n == 1) {
         int i;
         for (i = 0; i < 0x40000; i++)
@@ -1132,6 +1143,7 @@ static void debuggerBreakWriteClear(int n, char** args)
                 freezeOAM[i] = 0;
 
         printf("Cleared all break on write\n");
+        CPUUpdateMemoryPages();
     } else
         debuggerUsage("bpwc");
 }
@@ -1197,7 +1209,7 @@ static void debuggerBreakWrite(int n, char** args)
                 freezeOAM[(address + i) & 0x3ff] = 1;
             break;
         }
-
+        CPUUpdateMemoryPages();
     } else
         debuggerUsage("bpw");
 }
@@ -1268,6 +1280,7 @@ static void debuggerBreakChangeClear(int n, char** args)
                 0x7000000 + address, 0x7000000 + final);
         } break;
         }
+        CPUUpdateMemoryPages();
     } else if (n == 1) {
         int i;
         for (i = 0; i < 0x40000; i++)
@@ -1287,6 +1300,7 @@ static void debuggerBreakChangeClear(int n, char** args)
                 freezeOAM[i] = 0;
 
         printf("Cleared all break on change\n");
+        CPUUpdateMemoryPages();
     } else
         debuggerUsage("bpcc");
 }
@@ -1348,7 +1362,7 @@ static void debuggerBreakChange(int n, char** args)
                 freezeOAM[(address + i) & 0x3ff] = 2;
             break;
         }
-
+        CPUUpdateMemoryPages();
     } else
         debuggerUsage("bpc");
 }
@@ -257,10 +257,15 @@ void DirectSound::resume() {
     }
 }
 
-void DirectSound::write(uint16_t* finalWave, int) {
+void DirectSound::write(uint16_t* finalWave, int length) {
     if (!pDirectSound)
         return;
 
+    // Leave room for the part of the secondary buffer being played, drop the
+    // rest of the data.
+    if (length > soundBufferTotalLen - soundBufferLen)
+        length = soundBufferTotalLen - soundBufferLen;
+
     HRESULT hr;
     DWORD status = 0;
     DWORD play = 0;
@@ -280,7 +285,7 @@ void DirectSound::write(uint16_t* finalWave, int) {
                                           ? play - soundNextPosition
                                           : soundBufferTotalLen - soundNextPosition + play);
 
-                    if (BufferLeft > soundBufferLen) {
+                    if (BufferLeft > length) {
                         if (BufferLeft > soundBufferTotalLen - (soundBufferLen * 3))
                             soundBufferLow = true;
 
@@ -303,15 +308,15 @@ void DirectSound::write(uint16_t* finalWave, int) {
 
     // Obtain memory address of write block.
     // This will be in two parts if the block wraps around.
-    if (DSERR_BUFFERLOST == (hr = dsbSecondary->Lock(soundNextPosition, soundBufferLen, &lpvPtr1,
+    if (DSERR_BUFFERLOST == (hr = dsbSecondary->Lock(soundNextPosition, length, &lpvPtr1,
                                                      &dwBytes1, &lpvPtr2, &dwBytes2, 0))) {
         // If DSERR_BUFFERLOST is returned, restore and retry lock.
         dsbSecondary->Restore();
-        hr = dsbSecondary->Lock(soundNextPosition, soundBufferLen, &lpvPtr1, &dwBytes1, &lpvPtr2,
+        hr = dsbSecondary->Lock(soundNextPosition, length, &lpvPtr1, &dwBytes1, &lpvPtr2,
                                 &dwBytes2, 0);
     }
 
-    soundNextPosition += soundBufferLen;
+    soundNextPosition += length;
     soundNextPosition = soundNextPosition % soundBufferTotalLen;
 
     if (SUCCEEDED(hr)) {
@@ -319,7 +324,7 @@ void DirectSound::write(uint16_t* finalWave, int) {
         CopyMemory(lpvPtr1, finalWave, dwBytes1);
 
         if (lpvPtr2) {
-            CopyMemory(lpvPtr2, finalWave + dwBytes1, dwBytes2);
+            CopyMemory(lpvPtr2, (BYTE*)finalWave + dwBytes1, dwBytes2);
         }
 
         // Release the data back to DirectSound.
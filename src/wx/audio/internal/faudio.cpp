@@ -131,13 +131,15 @@ private:
     void resume() override;
     void write(uint16_t* finalWave, int length) override;
     void setThrottle(unsigned short throttle_) override;
+    double bufferFill() override;
 
     bool failed;
     bool initialized;
     bool playing;
     uint32_t freq_;
     const uint32_t buffer_count_;
-    std::vector<uint8_t> buffers_;
+    // One per buffer, each one grows to the longest write.
+    std::vector<std::vector<uint8_t>> buffers_;
     int currentBuffer;
     int sound_buffer_len_;
 
@@ -222,7 +224,7 @@ bool FAudio_Output::init(long sampleRate) {
     // create own buffers to store sound data because it must not be
     // manipulated while the voice plays from it.
     // +1 because we need one temporary buffer when all others are in use.
-    buffers_.resize((buffer_count_ + 1) * sound_buffer_len_);
+    buffers_.assign(buffer_count_ + 1, std::vector<uint8_t>(sound_buffer_len_));
     static const uint16_t kNumChannels = 2;
     static const uint16_t kBitsPerSample = 16;
     static const uint16_t kBlockAlign = kNumChannels * (kBitsPerSample / 8);
@@ -365,7 +367,7 @@ bool FAudio_Output::init(long sampleRate) {
     return true;
 }
 
-void FAudio_Output::write(uint16_t* finalWave, int) {
+void FAudio_Output::write(uint16_t* finalWave, int length) {
     uint32_t flags = 0;
     if (!initialized || failed)
         return;
@@ -407,9 +409,11 @@ void FAudio_Output::write(uint16_t* finalWave, int) {
     }
 
     // copy & protect the audio data in own memory area while playing it
-    memcpy(&buffers_[currentBuffer * sound_buffer_len_], finalWave, sound_buffer_len_);
-    buf.AudioBytes = sound_buffer_len_;
-    buf.pAudioData = &buffers_[currentBuffer * sound_buffer_len_];
+    std::vector<uint8_t>& data = buffers_[currentBuffer];
+    const uint8_t* wave = reinterpret_cast<const uint8_t*>(finalWave);
+    data.assign(wave, wave + length);
+    buf.AudioBytes = length;
+    buf.pAudioData = data.data();
     currentBuffer++;
     currentBuffer %= (buffer_count_ + 1);  // + 1 because we need one temporary buffer
     [[maybe_unused]] uint32_t hr = FAudioSourceVoice_SubmitSourceBuffer(sVoice, &buf, nullptr);
@@ -464,6 +468,14 @@ void FAudio_Output::setThrottle(unsigned short throttle_) {
     VBAM_CHECK(hr == 0);
 }
 
+double FAudio_Output::bufferFill() {
+    if (!initialized || failed)
+        return -1.0;
+
+    FAudioSourceVoice_GetState(sVoice, &vState, 0);
+    return (double)vState.BuffersQueued / buffer_count_;
+}
+
 }  // namespace
 
 std::vector<AudioDevice> GetFAudioDevices() {
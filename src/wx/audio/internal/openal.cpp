@@ -74,6 +74,7 @@ public:
     void resume() override;  // play/resume the secondary sound buffer
     void write(uint16_t* finalWave,
                int length) override;  // write the emulated sound to a sound buffer
+    double bufferFill() override;     // part of the queued buffers left to play
 
 private:
     bool initialized;
@@ -283,7 +284,6 @@ void OpenAL::reset() {
 }
 
 void OpenAL::write(uint16_t* finalWave, int length) {
-    (void)length;  // unused param
     if (!initialized)
         return;
 
@@ -299,7 +299,7 @@ void OpenAL::write(uint16_t* finalWave, int length) {
         for (int i = 0; i < OPTION(kSoundBuffers); i++) {
             // Filling the buffers explicitly with silence would be cleaner,
             // but the very first sample is usually silence anyway.
-            alBufferData(buffer[i], AL_FORMAT_STEREO16, finalWave, soundBufferLen, freq);
+            alBufferData(buffer[i], AL_FORMAT_STEREO16, finalWave, length, freq);
             ASSERT_SUCCESS;
         }
 
@@ -344,7 +344,7 @@ void OpenAL::write(uint16_t* finalWave, int length) {
         alSourceUnqueueBuffers(source, 1, &tempBuffer);
         ASSERT_SUCCESS;
         // refill buffer
-        alBufferData(tempBuffer, AL_FORMAT_STEREO16, finalWave, soundBufferLen, freq);
+        alBufferData(tempBuffer, AL_FORMAT_STEREO16, finalWave, length, freq);
         ASSERT_SUCCESS;
         // requeue buffer
         alSourceQueueBuffers(source, 1, &tempBuffer);
@@ -361,6 +361,16 @@ void OpenAL::write(uint16_t* finalWave, int length) {
     }
 }
 
+double OpenAL::bufferFill() {
+    if (!initialized || !buffersLoaded)
+        return -1.0;
+
+    ALint nBuffersProcessed = 0;
+    alGetSourcei(source, AL_BUFFERS_PROCESSED, &nBuffersProcessed);
+    ASSERT_SUCCESS;
+    return 1.0 - (double)nBuffersProcessed / OPTION(kSoundBuffers);
+}
+
 }  // namespace
 
 std::vector<AudioDevice> GetOpenALDevices() {
@@ -209,13 +209,15 @@ private:
     void resume() override;
     void write(uint16_t* finalWave, int length) override;
     void setThrottle(unsigned short throttle_) override;
+    double bufferFill() override;
 
     bool failed;
     bool initialized;
     bool playing;
     UINT32 freq;
     UINT32 bufferCount;
-    BYTE* buffers;
+    // One per buffer, each one grows to the longest write.
+    std::vector<std::vector<BYTE>> buffers;
     int currentBuffer;
     int soundBufferLen;
 
@@ -236,7 +238,6 @@ XAudio2_Output::XAudio2_Output() {
     playing = false;
     freq = 0;
     bufferCount = OPTION(kSoundBuffers);
-    buffers = NULL;
     currentBuffer = 0;
     device_changed = false;
     xaud = NULL;
@@ -265,10 +266,7 @@ void XAudio2_Output::close() {
         sVoice = NULL;
     }
 
-    if (buffers) {
-        free(buffers);
-        buffers = NULL;
-    }
+    buffers.clear();
 
     if (mVoice) {
         mVoice->DestroyVoice();
@@ -305,7 +303,7 @@ bool XAudio2_Output::init(long sampleRate) {
     soundBufferLen = (freq / 60) * 4;
     // create own buffers to store sound data because it must not be
     // manipulated while the voice plays from it
-    buffers = (BYTE*)malloc((bufferCount + 1) * soundBufferLen);
+    buffers.assign(bufferCount + 1, std::vector<BYTE>(soundBufferLen));
     // + 1 because we need one temporary buffer when all others are in use
     WAVEFORMATEX wfx;
     ZeroMemory(&wfx, sizeof(wfx));
@@ -452,7 +450,7 @@ bool XAudio2_Output::init(long sampleRate) {
     return true;
 }
 
-void XAudio2_Output::write(uint16_t* finalWave, int) {
+void XAudio2_Output::write(uint16_t* finalWave, int length) {
     if (!initialized || failed)
         return;
 
@@ -493,9 +491,11 @@ void XAudio2_Output::write(uint16_t* finalWave, int) {
     }
 
     // copy & protect the audio data in own memory area while playing it
-    CopyMemory(&buffers[currentBuffer * soundBufferLen], finalWave, soundBufferLen);
-    buf.AudioBytes = soundBufferLen;
-    buf.pAudioData = &buffers[currentBuffer * soundBufferLen];
+    std::vector<BYTE>& data = buffers[currentBuffer];
+    const BYTE* wave = reinterpret_cast<const BYTE*>(finalWave);
+    data.assign(wave, wave + length);
+    buf.AudioBytes = length;
+    buf.pAudioData = data.data();
     currentBuffer++;
     currentBuffer %= (bufferCount + 1);             // + 1 because we need one temporary buffer
     HRESULT hr = sVoice->SubmitSourceBuffer(&buf);  // send buffer to queue
@@ -549,6 +549,14 @@ void XAudio2_Output::setThrottle(unsigned short throttle_) {
     assert(hr == S_OK);
 }
 
+double XAudio2_Output::bufferFill() {
+    if (!initialized || failed)
+        return -1.0;
+
+    sVoice->GetState(&vState);
+    return (double)vState.BuffersQueued / bufferCount;
+}
+
 void xaudio2_device_changed(XAudio2_Output* instance) {
     instance->device_change();
 }
@@ -1410,21 +1410,22 @@ EVT_HANDLER_MASK(IncrGameSlotSave, "Increase state slot number and save", CMDEN_
 
 EVT_HANDLER_MASK(Rewind, "Rewind", CMDEN_REWIND)
 {
-    int rew_st = (panel->next_rewind_state + NUM_REWINDS - 1) % NUM_REWINDS;
+    RewindBuffer& states = panel->rewind_states;
 
     // if within 5 seconds of last one, and > 1 state, delete last state & move back
     // FIXME: 5 should actually be user-configurable
     // maybe instead of 5, 10% of rewind_interval
-    if (panel->num_rewind_states > 1 && (gopts.rewind_interval <= 5 || (int)panel->rewind_time / 6 > gopts.rewind_interval - 5)) {
-        --panel->num_rewind_states;
-        panel->next_rewind_state = rew_st;
+    bool drop = states.count() > 1 && (gopts.rewind_interval <= 5 || (int)panel->rewind_time / 6 > gopts.rewind_interval - 5);
 
-        if (gopts.rewind_interval > 5)
-            rew_st = (rew_st + NUM_REWINDS - 1) % NUM_REWINDS;
+    if (drop && gopts.rewind_interval > 5) {
+        states.DropNewest();
+        drop = false;
     }
 
-    panel->emusys->emuReadMemState(&panel->rewind_mem[rew_st * REWIND_SIZE],
-        REWIND_SIZE);
+    panel->emusys->emuReadMemState((char*)states.newest(), states.newest_size());
+
+    if (drop)
+        states.DropNewest();
     InterframeCleanup();
     // FIXME: if(paused) blank screen
     panel->do_rewind = false;
@@ -1906,15 +1907,15 @@ EVT_HANDLER(GeneralConfigure, "General options...")
 
     if (rew != gopts.rewind_interval) {
         if (!gopts.rewind_interval) {
-            if (panel->num_rewind_states) {
+            if (panel->rewind_states.count()) {
                 cmd_enable &= ~CMDEN_REWIND;
                 enable_menus();
             }
 
-            panel->num_rewind_states = 0;
+            panel->rewind_states.Clear();
             panel->do_rewind = false;
         } else {
-            if (!panel->num_rewind_states)
+            if (!panel->rewind_states.count())
                 panel->do_rewind = true;
 
             panel->rewind_time = gopts.rewind_interval * 6;
@@ -2470,6 +2471,7 @@ void SetLinkTypeMenu(const char* type, int value)
     mf->SetMenuOption("LinkType2Wireless", 0);
     mf->SetMenuOption("LinkType3GameCube", 0);
     mf->SetMenuOption("LinkType4Gameboy", 0);
+    mf->SetMenuOption("LinkType5Netplay", 0);
     mf->SetMenuOption(type, 1);
     gopts.gba_link_type = value;
     update_opts();
@@ -2538,6 +2540,13 @@ EVT_HANDLER(LinkType4Gameboy, "Link Gameboy")
 #endif
 }
 
+EVT_HANDLER(LinkType5Netplay, "Link cable with rollback netplay")
+{
+#if defined(VBAM_ENABLE_NETPLAY)
+    SetLinkTypeMenu("LinkType5Netplay", 5);
+#endif
+}
+
 EVT_HANDLER(LinkAuto, "Enable link at boot")
 {
 #ifndef NO_LINK
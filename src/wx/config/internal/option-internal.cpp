@@ -175,6 +175,7 @@ std::array<Option, kNbOptions>& Option::All() {
         int32_t frame_skip = 0;
         bool gdb_break_on_load  = false;
         bool pause_when_inactive = false;
+        int32_t run_ahead = 0;
         uint32_t show_speed = 0;
         bool show_speed_transparent = false;
         bool use_bios_file_gb = false;
@@ -321,6 +322,7 @@ std::array<Option, kNbOptions>& Option::All() {
         Option(OptionID::kPrefMaxScale, &gopts.max_scale, 0, 100),
         Option(OptionID::kPrefPauseWhenInactive, &g_owned_opts.pause_when_inactive),
         Option(OptionID::kPrefRTCEnabled, &coreOptions.rtcEnabled, 0, 1),
+        Option(OptionID::kPrefRunAhead, &g_owned_opts.run_ahead, 0, 4),
         Option(OptionID::kPrefSaveType, &coreOptions.cpuSaveType, 0, 5),
         Option(OptionID::kPrefShowSpeed, &g_owned_opts.show_speed, 0, 2),
         Option(OptionID::kPrefShowSpeedTransparent, &g_owned_opts.show_speed_transparent),
@@ -364,6 +366,7 @@ std::array<Option, kNbOptions>& Option::All() {
         Option(OptionID::kSoundGBSurround, &g_owned_opts.gb_effects_config_surround),
         Option(OptionID::kSoundAudioRate, &g_owned_opts.sound_quality),
         Option(OptionID::kSoundDSoundHWAccel, &g_owned_opts.dsound_hw_accel),
+        Option(OptionID::kSoundRateControl, &coreOptions.audioRateControl),
         Option(OptionID::kSoundUpmix, &g_owned_opts.upmix),
         Option(OptionID::kSoundVolume, &g_owned_opts.volume, 0, 200),
     };
@@ -512,6 +515,9 @@ const std::array<OptionData, kNbOptions + 1> kAllOptionsData = {
                _("Pause game when main window loses focus")},
     OptionData{"preferences/rtcEnabled", "RTC",
                _("Enable RTC (vba-over.ini override is rtcEnabled")},
+    OptionData{"preferences/runAhead", "",
+               _("Number of frames to run ahead of the emulation to reduce the "
+                 "input latency (0 = disabled)")},
     OptionData{"preferences/saveType", "", _("Native save (\"battery\") hardware type")},
     OptionData{"preferences/showSpeed", "", _("Show speed indicator")},
     OptionData{"preferences/showSpeedTransparent", "Transparent",
@@ -569,6 +575,8 @@ const std::array<OptionData, kNbOptions + 1> kAllOptionsData = {
     OptionData{"Sound/GBSurround", "GBSurround", _("Game Boy surround sound effect (%)")},
     OptionData{"Sound/Quality", "", _("Sound sample rate (kHz)")},
     OptionData{"Sound/DSoundHWAccel", "DSoundHWAccel", _("Use DirectSound hardware acceleration")},
+    OptionData{"Sound/RateControl", "RateControl",
+               _("Adjust the sample rate to keep the audio in sync with the video")},
     OptionData{"Sound/Upmix", "Upmix", _("Upmix stereo to surround")},
     OptionData{"Sound/Volume", "", _("Sound volume (%)")},
 
@@ -89,6 +89,7 @@ enum class OptionID {
     kPrefMaxScale,
     kPrefPauseWhenInactive,
     kPrefRTCEnabled,
+    kPrefRunAhead,
     kPrefSaveType,
     kPrefShowSpeed,
     kPrefShowSpeedTransparent,
@@ -132,6 +133,7 @@ enum class OptionID {
     kSoundGBSurround,
     kSoundAudioRate,
     kSoundDSoundHWAccel,
+    kSoundRateControl,
     kSoundUpmix,
     kSoundVolume,
 
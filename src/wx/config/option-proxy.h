@@ -93,6 +93,7 @@ static constexpr std::array<Option::Type, kNbOptions> kOptionsTypes = {
     /*kPrefMaxScale*/ Option::Type::kInt,
     /*kPrefPauseWhenInactive*/ Option::Type::kBool,
     /*kPrefRTCEnabled*/ Option::Type::kInt,
+    /*kPrefRunAhead*/ Option::Type::kInt,
     /*kPrefSaveType*/ Option::Type::kInt,
     /*kPrefShowSpeed*/ Option::Type::kUnsigned,
     /*kPrefShowSpeedTransparent*/ Option::Type::kBool,
@@ -136,6 +137,7 @@ static constexpr std::array<Option::Type, kNbOptions> kOptionsTypes = {
     /*kSoundGBSurround*/ Option::Type::kBool,
     /*kSoundAudioRate*/ Option::Type::kAudioRate,
     /*kSoundDSoundHWAccel*/ Option::Type::kBool,
+    /*kSoundRateControl*/ Option::Type::kBool,
     /*kSoundUpmix*/ Option::Type::kBool,
     /*kSoundVolume*/ Option::Type::kInt,
 };
@@ -205,6 +205,10 @@ SoundConfig::SoundConfig(wxWindow* parent) : BaseDialog(parent, "SoundConfig") {
     hw_accel_checkbox_->Hide();
 #endif
 
+    // Dynamic rate control.
+    GetValidatedChild("RateControl")
+        ->SetValidator(widgets::OptionBoolValidator(config::OptionID::kSoundRateControl));
+
     // Buffers configuration.
     buffers_info_label_ = GetValidatedChild<wxControl>("BuffersInfo");
     buffers_slider_ = GetValidatedChild<wxSlider>("Buffers");
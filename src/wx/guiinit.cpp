@@ -1825,7 +1825,7 @@ bool MainFrame::BindControls()
 #endif
 #ifdef NO_LINK
 
-            if (cmd_item.cmd_id == XRCID("LanLink") || cmd_item.cmd_id == XRCID("LinkType0Nothing") || cmd_item.cmd_id == XRCID("LinkType1Cable") || cmd_item.cmd_id == XRCID("LinkType2Wireless") || cmd_item.cmd_id == XRCID("LinkType3GameCube") || cmd_item.cmd_id == XRCID("LinkType4Gameboy") || cmd_item.cmd_id == XRCID("LinkAuto") || cmd_item.cmd_id == XRCID("SpeedOn") || cmd_item.cmd_id == XRCID("LinkProto") || cmd_item.cmd_id == XRCID("LinkConfigure")) {
+            if (cmd_item.cmd_id == XRCID("LanLink") || cmd_item.cmd_id == XRCID("LinkType0Nothing") || cmd_item.cmd_id == XRCID("LinkType1Cable") || cmd_item.cmd_id == XRCID("LinkType2Wireless") || cmd_item.cmd_id == XRCID("LinkType3GameCube") || cmd_item.cmd_id == XRCID("LinkType4Gameboy") || cmd_item.cmd_id == XRCID("LinkType5Netplay") || cmd_item.cmd_id == XRCID("LinkAuto") || cmd_item.cmd_id == XRCID("SpeedOn") || cmd_item.cmd_id == XRCID("LinkProto") || cmd_item.cmd_id == XRCID("LinkConfigure")) {
                 if (mi)
                     mi->GetMenu()->Remove(mi);
                 cmd_item.mi = NULL;
@@ -1842,6 +1842,16 @@ bool MainFrame::BindControls()
                 continue;
             }
 
+#if !defined(VBAM_ENABLE_NETPLAY)
+
+            if (cmd_item.cmd_id == XRCID("LinkType5Netplay")) {
+                if (mi)
+                    mi->GetMenu()->Remove(mi);
+                cmd_item.mi = NULL;
+                continue;
+            }
+
+#endif
 #endif
 #if !defined(VBAM_ENABLE_DEBUGGER)
 
@@ -1992,6 +2002,7 @@ bool MainFrame::BindControls()
         MenuOptionIntRadioValue("LinkType2Wireless", gopts.gba_link_type, 2);
         MenuOptionIntRadioValue("LinkType3GameCube", gopts.gba_link_type, 3);
         MenuOptionIntRadioValue("LinkType4Gameboy", gopts.gba_link_type, 4);
+        MenuOptionIntRadioValue("LinkType5Netplay", gopts.gba_link_type, 5);
     }
 
     for (size_t i = 0; i < checkable_mi.size(); i++) {
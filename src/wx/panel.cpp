@@ -134,8 +134,7 @@ GameArea::GameArea()
       was_paused(false),
       rewind_time(0),
       do_rewind(false),
-      rewind_mem(0),
-      num_rewind_states(0),
+      rewind_states(REWIND_BUDGET),
       loaded(IMAGE_UNKNOWN),
       basic_width(GBAWidth),
       basic_height(GBAHeight),
@@ -698,8 +697,7 @@ void GameArea::UnloadGame(bool destruct)
     mf->enable_menus();
     mf->ResetCheatSearch();
 
-    if (rewind_mem)
-        num_rewind_states = 0;
+    rewind_states.Clear();
 }
 
 bool GameArea::LoadState()
@@ -724,11 +722,11 @@ bool GameArea::LoadState(const wxFileName& fname)
     // FIXME: first save to backup state if not backup state
     bool ret = emusys->emuReadState(UTF8(fname.GetFullPath()));
 
-    if (ret && num_rewind_states) {
+    if (ret && rewind_states.count()) {
         MainFrame* mf = wxGetApp().frame;
         mf->cmd_enable &= ~CMDEN_REWIND;
         mf->enable_menus();
-        num_rewind_states = 0;
+        rewind_states.Clear();
         // do an immediate rewind save
         // even if loaded from state file: not smart enough yet to just
         // do a reset or load from state file when # rewinds == 0
@@ -1046,9 +1044,6 @@ GameArea::~GameArea()
 {
     UnloadGame(true);
 
-    if (rewind_mem)
-        free(rewind_mem);
-
     if (gopts.fs_mode.w && gopts.fs_mode.h && fullscreen) {
         MainFrame* tlw = wxGetApp().frame;
         int dno = wxDisplay::GetFromWindow(tlw);
@@ -1264,7 +1259,19 @@ void GameArea::OnIdle(wxIdleEvent& event)
         }
 #endif  // defined(VBAM_ENABLE_DEBUGGER)
 
-        emusys->emuMain(emusys->emuCount);
+        int run_ahead_frames = OPTION(kPrefRunAhead);
+        bool link_frame = false;
+#ifndef NO_LINK
+        // The linked instances must see the same frames.
+        if (GetLinkMode() != LINK_DISCONNECTED)
+            run_ahead_frames = 0;
+
+        // Netplay emulates the frames itself.
+        if (loaded == IMAGE_GBA)
+            link_frame = LinkEmulateFrame(*emusys);
+#endif
+        if (!link_frame)
+            run_ahead.EmulateFrame(*emusys, run_ahead_frames);
 #ifndef NO_LINK
 
         if (loaded == IMAGE_GBA && GetLinkMode() != LINK_DISCONNECTED)
@@ -1281,33 +1288,21 @@ void GameArea::OnIdle(wxIdleEvent& event)
     }
 
     if (do_rewind && emusys->emuWriteMemState) {
-        if (!rewind_mem) {
-            rewind_mem = (char*)malloc(NUM_REWINDS * REWIND_SIZE);
-            num_rewind_states = next_rewind_state = 0;
-        }
-
-        if (!rewind_mem) {
-            wxLogError(_("No memory for rewinding"));
-            wxGetApp().frame->Close(true);
-            return;
-        }
+        rewind_scratch.resize(REWIND_SIZE);
 
         long resize;
 
-        if (!emusys->emuWriteMemState(&rewind_mem[REWIND_SIZE * next_rewind_state],
+        if (!emusys->emuWriteMemState(rewind_scratch.data(),
                 REWIND_SIZE, resize /* actual size */))
             // if you see a lot of these, maybe increase REWIND_SIZE
             wxLogInfo(_("Error writing rewind state"));
         else {
-            if (!num_rewind_states) {
+            if (!rewind_states.count()) {
                 mf->cmd_enable |= CMDEN_REWIND;
                 mf->enable_menus();
             }
 
-            if (num_rewind_states < NUM_REWINDS)
-                ++num_rewind_states;
-
-            next_rewind_state = (next_rewind_state + 1) % NUM_REWINDS;
+            rewind_states.Push((const uint8_t*)rewind_scratch.data(), resize);
         }
 
         do_rewind = false;
@@ -373,7 +373,9 @@ uint32_t systemReadJoypad(int joy)
         if (!autofire_state)
             ret &= ~af_but;
 
-        if (!--autofire_trigger) {
+        // The hidden run-ahead frames reuse the state of the real frame, or
+        // autofire would toggle once per emulated frame instead.
+        if (!RunAhead::IsHiddenFrame() && !--autofire_trigger) {
             autofire_trigger = gopts.autofire_rate;
             autofire_state = !autofire_state;
         }
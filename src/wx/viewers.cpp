@@ -890,6 +890,9 @@ public:
             CPUWriteMemoryQuick(mv->writeaddr, mv->writeval);
             break;
         }
+
+        // the quick writes bypass the decoded tile cache invalidation
+        gfxMemoryChanged();
     }
 
     void MemLoad(wxString& name, uint32_t addr, uint32_t len)
@@ -912,6 +915,8 @@ public:
             len -= wlen;
             addr += wlen;
         }
+
+        gfxMemoryChanged();
     }
 
     void MemSave(wxString& name, uint32_t addr, uint32_t len)
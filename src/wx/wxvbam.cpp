@@ -1249,6 +1249,12 @@ LinkMode MainFrame::GetConfiguredLinkMode()
 
         break;
 
+#if defined(VBAM_ENABLE_NETPLAY)
+    case 5:
+        return LINK_CABLE_NETPLAY;
+        break;
+#endif
+
     default:
         return LINK_DISCONNECTED;
         break;
@@ -11,6 +11,8 @@
 #include <wx/propdlg.h>
 #include <wx/datetime.h>
 
+#include "core/base/rewind.h"
+#include "core/base/run_ahead.h"
 #include "core/base/system.h"
 #include "wx/config/bindings.h"
 #include "wx/config/emulated-gamepad.h"
@@ -473,9 +475,11 @@ public:
     // Rewind: flag to OnIdle to do a rewind
     bool do_rewind;
     // Rewind: rewind states
-    char* rewind_mem; // should be uint8_t, really
-    int num_rewind_states;
-    int next_rewind_state;
+    RewindBuffer rewind_states;
+    // Rewind: space to write a state before it is recorded
+    std::vector<char> rewind_scratch;
+    // Emulates the frames presented ahead of the real one
+    RunAhead run_ahead;
 
     // Loaded rom information
     IMAGE_TYPE loaded;
@@ -487,8 +491,9 @@ public:
     uint32_t rom_size;
 
 // FIXME: size this properly
-#define NUM_REWINDS 8
-#define REWIND_SIZE 1024 * 512 * NUM_REWINDS
+#define REWIND_SIZE 1024 * 1024
+// Memory for the older rewind states, on top of the newest one
+#define REWIND_BUDGET 1024 * 1024 * 16
 
     // Resets the panel, it will be re-created on the next frame.
     void ResetPanel();